@@ -1,18 +1,40 @@
 #ifndef AFINA_THREADPOOL_H
 #define AFINA_THREADPOOL_H
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <queue>
 #include <string>
 #include <thread>
+#include <utility>
+#include <vector>
+
+#include <afina/executor/Histogram.h>
+#include <afina/executor/Task.h>
 
 namespace Afina {
 
 /**
  * # Thread pool
+ * In shared queue mode all threads take tasks from the single queue guarded by the mutex.
+ *
+ * In work stealing mode each thread has its own deque: tasks submitted from the pool threads are pushed
+ * to the deque of the submitter without any locks, tasks submitted from outside go to the global injection
+ * queue, which threads drain by batches. Thread that runs out of tasks steals from the others, spins for a
+ * while and only then parks on the condition variable, so submitters wake anybody only if some thread is
+ * actually parked
+ *
+ * Pool keeps at least low_watermark threads. Once there are more queued tasks than free threads, new thread
+ * is started unless there are high_watermark of them already. Threads above low_watermark exit after being
+ * idle for idle_time. Tasks are rejected once max_queue_size of them are waiting
+ *
+ * Each task records time it waited in the queue and time it ran into histograms, so it could be seen
+ * whether latency comes from the lack of threads or from the tasks themselves
  */
 class Executor {
     enum class State {
@@ -26,9 +48,35 @@ class Executor {
         // Threadppol is stopped
         kStopped
     };
-    
+
 public:
-    Executor(std::string name, int size);
+    enum class Mode {
+        // Single queue guarded by the mutex
+        kSharedQueue,
+
+        // Per thread deques with work stealing
+        kWorkStealing
+    };
+
+    /**
+     * Fixed size pool with unbounded queue
+     */
+    Executor(std::string name, int size, Mode mode = Mode::kSharedQueue);
+
+    /**
+     * Elastic pool
+     *
+     * @param low_watermark number of threads kept even if there is nothing to do
+     * @param high_watermark maximum number of threads
+     * @param max_queue_size maximum number of tasks waiting for execution, 0 means unbounded
+     * @param idle_time how long thread above low_watermark waits for a task before it exits
+     */
+    Executor(std::string name, size_t low_watermark, size_t high_watermark, size_t max_queue_size,
+             std::chrono::milliseconds idle_time, Mode mode = Mode::kSharedQueue);
+
+    /**
+     * Stops pool if it is still running and waits for all threads to exit
+     */
     ~Executor();
 
     /**
@@ -48,18 +96,44 @@ public:
      */
     template <typename F, typename... Types> bool Execute(F &&func, Types... args) {
         // Prepare "task"
-        auto exec = std::bind(std::forward<F>(func), std::forward<Types>(args)...);
+        return Submit(Task(std::bind(std::forward<F>(func), std::forward<Types>(args)...)));
+    }
 
-        std::unique_lock<std::mutex> lock(this->mutex);
-        if (state != State::kRun) {
-            return false;
-        }
+    /**
+     * Number of threads running now
+     */
+    size_t Threads() const { return threads_count.load(); }
 
-        // Enqueue new task
-        tasks.push_back(exec);
-        empty_condition.notify_one();
-        return true;
-    }
+    /**
+     * Counters for monitoring, times are in nanoseconds. Utilisation over some interval is the difference
+     * of busy_time divided by the difference of thread_time
+     */
+    struct Metrics {
+        size_t threads;
+        size_t busy_threads;
+        size_t queue_depth;
+        uint64_t completed;
+        uint64_t rejected;
+
+        // Time spent running tasks, summed over all threads
+        uint64_t busy_time;
+
+        // Time threads existed, summed over all threads
+        uint64_t thread_time;
+    };
+
+    void GetMetrics(Metrics &metrics);
+
+    /**
+     * Time from submit to start and from start to finish of each task, nanoseconds
+     */
+    const Histogram &WaitTime() const { return wait_time; }
+    const Histogram &RunTime() const { return run_time; }
+
+    /**
+     * Appends metrics and percentiles of both histograms as a name/value pairs, see Storage::CollectStats
+     */
+    void CollectStats(std::vector<std::pair<std::string, std::string>> &stats);
 
 private:
     // No copy/move/assign allowed
@@ -68,11 +142,83 @@ private:
     Executor &operator=(const Executor &); // = delete;
     Executor &operator=(Executor &&);      // = delete;
 
+    // Forward declaration, see Executor.cpp
+    struct Worker;
+
+    // Task along with the time it was submitted at
+    struct Job {
+        Task task;
+        uint64_t enqueued;
+    };
+
     /**
      * Main function that all pool threads are running. It polls internal task queue and execute tasks
      */
     friend void perform(Executor *executor);
 
+    /**
+     * Main function of the pool threads in work stealing mode
+     */
+    void RunWorker(size_t index);
+
+    /**
+     * Places task into the queue according to the mode
+     */
+    bool Submit(Task &&task);
+
+    /**
+     * Runs task and records metrics
+     */
+    void Run(Job &job);
+
+    /**
+     * Adds time passed since the last call multiplied by the number of threads to thread_time. Called
+     * with the mutex locked before threads_count changes
+     */
+    void AccountThreadTime();
+
+    /**
+     * Starts one more thread unless there are high_watermark of them. Called with the mutex locked
+     */
+    void StartThread();
+
+    /**
+     * Accounts thread exit and completes stop once the last thread is gone. Called with the mutex locked
+     */
+    void OnThreadExit();
+
+    /**
+     * Places task into the deque of the calling thread or into the injection queue
+     */
+    bool Dispatch(Task &&task);
+
+    /**
+     * Checks if there are more queued tasks than threads free to run them in work stealing mode
+     */
+    bool NeedsThread() const;
+
+    /**
+     * Takes task from own deque, injection queue or steals it from another thread. Returned node goes
+     * back with ReleaseNode once task is done
+     */
+    Job *FindTask(size_t index);
+
+    /**
+     * Task nodes pushed to the deques are recycled by the thread which ran them, see Worker
+     */
+    Job *AcquireNode(size_t index);
+    void ReleaseNode(size_t index, Job *node);
+
+    /**
+     * Checks if any task is queued anywhere
+     */
+    bool HasWork() const;
+
+    /**
+     * Wakes up one parked thread if there is any
+     */
+    void WakeOne();
+
     /**
      * Mutex to protect state below from concurrent modification
      */
@@ -84,19 +230,66 @@ private:
     std::condition_variable empty_condition;
 
     /**
-     * Vector of actual threads that perorm execution
+     * Conditional variable to await all threads to exit
      */
-    std::vector<std::thread> threads;
+    std::condition_variable stop_condition;
 
     /**
      * Task queue
      */
-    std::deque<std::function<void()>> tasks;
+    RingQueue<Job> tasks;
+
+    /**
+     * Flag to stop bg threads, changed under the mutex but read by work stealing threads without it
+     */
+    std::atomic<State> state;
+
+    Mode mode;
+
+    // Pool limits, see class description
+    size_t low_watermark;
+    size_t high_watermark;
+    size_t max_queue_size;
+    std::chrono::milliseconds idle_time;
+
+    /**
+     * Number of running threads, changed under the mutex. Threads are detached and report exit through
+     * that counter
+     */
+    std::atomic<size_t> threads_count;
+
+    /**
+     * Shared queue mode: number of threads waiting for a task on empty_condition, guarded by the mutex
+     */
+    size_t idle_threads;
+
+    /**
+     * Work stealing mode: deque per each of high_watermark slots, slots not taken by any thread, global
+     * injection queue guarded by the mutex and number of threads parked on empty_condition. Number of queued
+     * tasks and threads running a task are used to decide when to grow
+     */
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<size_t> free_slots;
+    RingQueue<Job> injected;
+    std::atomic<size_t> injected_size;
+    std::atomic<int> sleepers;
+    std::atomic<size_t> queued;
+
+    /**
+     * Number of threads running a task
+     */
+    std::atomic<size_t> busy;
 
     /**
-     * Flag to stop bg threads
+     * Metrics, see Metrics. Thread time is guarded by the mutex
      */
-    State state;
+    Histogram wait_time;
+    Histogram run_time;
+    std::atomic<uint64_t> completed;
+    std::atomic<uint64_t> rejected;
+    std::atomic<uint64_t> busy_time;
+    uint64_t thread_time;
+    uint64_t thread_time_updated;
 };
 
 } // namespace Afina
@@ -1,7 +1,14 @@
 #ifndef AFINA_STORAGE_H
 #define AFINA_STORAGE_H
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include <afina/Value.h>
 
 namespace Afina {
 
@@ -56,6 +63,30 @@ public:
      */
     virtual bool Set(const std::string &key, const std::string &value) = 0;
 
+    /**
+     * Same as Put, but association expires once given number of seconds passed. Expired association
+     * is never visible to any subsequent access. Zero ttl means association never expires.
+     *
+     * Default implementation ignores ttl
+     *
+     * @param key to be associated with value
+     * @param value to be assigned for the key
+     * @param ttl number of seconds association lives
+     */
+    virtual bool Put(const std::string &key, const std::string &value, uint32_t ttl) { return Put(key, value); }
+
+    /**
+     * Same as PutIfAbsent, but association expires once given number of seconds passed, see Put
+     */
+    virtual bool PutIfAbsent(const std::string &key, const std::string &value, uint32_t ttl) {
+        return PutIfAbsent(key, value);
+    }
+
+    /**
+     * Same as Set, but association expires once given number of seconds passed, see Put
+     */
+    virtual bool Set(const std::string &key, const std::string &value, uint32_t ttl) { return Set(key, value); }
+
     /**
      * Removes association for the given key
      * If requested key doesn't present in storage method returns false and
@@ -72,6 +103,57 @@ public:
      */
     virtual bool Delete(const std::string &key) = 0;
 
+    /**
+     * Decision of the Modify callback about the association it was given
+     */
+    enum class Action {
+        // Association is left as is
+        kKeep,
+
+        // Association gets value and ttl set by the callback
+        kStore,
+
+        // Association is removed
+        kRemove
+    };
+
+    /**
+     * Callback of Modify, gets copy of the value and number of seconds the association has left to live,
+     * zero if it never expires. Both could be changed to be stored
+     */
+    typedef std::function<Action(std::string &value, uint32_t &ttl)> Modifier;
+
+    /**
+     * Atomically reads and changes association for the given key: no other operation could change the
+     * association between the moment callback is given the current value and the moment decision of the
+     * callback is applied. Callback is called under storage lock, so it must be short and must not access
+     * the storage
+     *
+     * Default implementation is NOT atomic and doesn't know remaining ttl, storages must override it
+     *
+     * @param key to modify association for
+     * @param modify callback deciding what to do with the association
+     * @return false if there is no association for the key, callback isn't called in such case, or if new
+     * value couldn't be stored
+     */
+    virtual bool Modify(const std::string &key, const Modifier &modify) {
+        std::string value;
+        if (!Get(key, value)) {
+            return false;
+        }
+
+        uint32_t ttl = 0;
+        switch (modify(value, ttl)) {
+        case Action::kStore:
+            return Set(key, value, ttl);
+        case Action::kRemove:
+            Delete(key);
+            return true;
+        default:
+            return true;
+        }
+    }
+
     /**
      * Retrive key for the given value
      * If there is an association for the given key then method copies value
@@ -84,6 +166,57 @@ public:
      * @param value output parameter to copy value to
      */
     virtual bool Get(const std::string &key, std::string &value) const = 0;
+
+    /**
+     * Retrive value for the given key without copying it
+     * If there is an association for the given key then method stores handle to the value bytes
+     * into given output parameter and return true. Bytes stays valid and unchanged while handle
+     * exists, even if association gets updated or deleted meanwhile
+     *
+     * Default implementation copies value once, storages that could share their own memory
+     * should override it
+     *
+     * @param key to retrive value for
+     * @param value output parameter to store handle to
+     */
+    virtual bool GetValue(const std::string &key, Value &value) const {
+        std::string bytes;
+        if (!Get(key, bytes)) {
+            return false;
+        }
+        value = Value::Copy(std::move(bytes));
+        return true;
+    }
+
+    /**
+     * Retrive values for the given set of keys without copying them, see GetValue
+     * Output parameter gets one handle per key in the same order, handles of keys not found are empty
+     *
+     * Default implementation looks keys up one by one, storages should override it so that lookup
+     * of many keys costs close to a single one: locks taken once per batch, memory accesses overlapped
+     *
+     * @param keys to retrive values for, could have duplicates
+     * @param values output parameter to store handles to
+     * @return number of keys found
+     */
+    virtual size_t MultiGet(const std::vector<std::string> &keys, std::vector<Value> &values) const {
+        values.clear();
+        values.resize(keys.size());
+
+        size_t found = 0;
+        for (size_t i = 0; i < keys.size(); i++) {
+            found += GetValue(keys[i], values[i]);
+        }
+        return found;
+    }
+
+    /**
+     * Appends storage statistics as a name/value pairs. Names follows memcached "stats" command
+     * conventions where possible, e.g "curr_items", "bytes", "limit_maxbytes"
+     *
+     * @param stats output parameter to append statistics to
+     */
+    virtual void CollectStats(std::vector<std::pair<std::string, std::string>> &stats) const {}
 };
 
 } // namespace Afina
@@ -0,0 +1,138 @@
+#ifndef AFINA_VALUE_H
+#define AFINA_VALUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace Afina {
+
+/**
+ * # Handle to immutable value bytes
+ * Bytes stay valid and unchanged for as long as at least one handle exists, even if association
+ * gets updated or removed from the storage meanwhile. Copy of the handle only increments reference
+ * counter, so value could be passed all the way down to the socket without copying bytes
+ */
+class Value {
+public:
+    /**
+     * Owner of the bytes. Storage implementations extends it to attach counter to their own entries,
+     * owner is released once the last reference is dropped
+     */
+    class Holder {
+    public:
+        Holder() : _refs(1) {}
+
+        void Ref() { _refs.fetch_add(1, std::memory_order_relaxed); }
+
+        void Unref() {
+            if (_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                Release();
+            }
+        }
+
+        /**
+         * True if there is the only reference. Once it returns true for the owner that is able to
+         * create new references, nobody else could observe the bytes
+         */
+        bool Unique() const { return _refs.load(std::memory_order_acquire) == 1; }
+
+    protected:
+        virtual ~Holder() {}
+
+        /**
+         * Called once the last reference is dropped
+         */
+        virtual void Release() = 0;
+
+    private:
+        std::atomic<uint32_t> _refs;
+    };
+
+    Value() : _holder(nullptr), _data(nullptr), _size(0) {}
+
+    /**
+     * Creates handle taking a new reference on the given holder
+     */
+    Value(Holder *holder, const char *data, size_t size) : _holder(holder), _data(data), _size(size) {
+        if (_holder != nullptr) {
+            _holder->Ref();
+        }
+    }
+
+    Value(const Value &other) : Value(other._holder, other._data, other._size) {}
+
+    Value(Value &&other) : _holder(other._holder), _data(other._data), _size(other._size) {
+        other._holder = nullptr;
+        other._data = nullptr;
+        other._size = 0;
+    }
+
+    ~Value() { Reset(); }
+
+    Value &operator=(Value other) {
+        std::swap(_holder, other._holder);
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+        return *this;
+    }
+
+    /**
+     * Creates handle owning copy of the given bytes
+     */
+    static Value Copy(std::string bytes);
+
+    /**
+     * Drops reference, handle becomes empty
+     */
+    void Reset() {
+        if (_holder != nullptr) {
+            _holder->Unref();
+        }
+        _holder = nullptr;
+        _data = nullptr;
+        _size = 0;
+    }
+
+    const char *data() const { return _data; }
+    size_t size() const { return _size; }
+    bool empty() const { return _holder == nullptr; }
+
+    std::string str() const { return std::string(_data, _size); }
+
+private:
+    Holder *_holder;
+    const char *_data;
+    size_t _size;
+};
+
+/**
+ * Holder that owns bytes in std::string, used when storage can't share its own memory
+ */
+class StringHolder : public Value::Holder {
+public:
+    StringHolder(std::string bytes) : _bytes(std::move(bytes)) {}
+
+    const std::string &bytes() const { return _bytes; }
+
+protected:
+    void Release() override { delete this; }
+
+private:
+    std::string _bytes;
+};
+
+inline Value Value::Copy(std::string bytes) {
+    StringHolder *holder = new StringHolder(std::move(bytes));
+    Value result(holder, holder->bytes().data(), holder->bytes().size());
+
+    // Handle took its own reference, the initial one isn't needed anymore
+    holder->Unref();
+    return result;
+}
+
+} // namespace Afina
+
+#endif // AFINA_VALUE_H
@@ -0,0 +1,89 @@
+#ifndef AFINA_ALLOCATOR_CONCURRENT_H
+#define AFINA_ALLOCATOR_CONCURRENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <afina/allocator/Slab.h>
+
+namespace Afina {
+namespace Allocator {
+
+/**
+ * # Thread safe size class allocator
+ * Front-end over the shared SlabAllocator arena. Every thread keeps a magazine of free blocks for
+ * each size class it uses, so Alloc and Free are served from the calling thread's magazine in O(1)
+ * and without any synchronization. Empty magazine is refilled from the arena by a batch of blocks
+ * under a single lock acquisition, overfilled one returns a batch back the same way. So the arena
+ * lock is taken at most once per magazine size operations.
+ *
+ * Blocks could be freed by any thread, not only the one allocated them. Magazines are flushed back
+ * to the arena once their thread exits. Large blocks are always served by the arena directly.
+ *
+ * Blocks cached in magazines are accounted as used, so with quota set Alloc could fail while other
+ * threads hold some free blocks; each thread caches at most two magazines per class
+ */
+class Concurrent {
+public:
+    /**
+     * @param slab_size size of arena slabs, must be a power of 2
+     * @param quota maximum number of bytes to take from the system, zero if unlimited
+     * @param magazine number of blocks moved between thread and arena at once
+     */
+    Concurrent(size_t slab_size = 1024 * 1024, size_t quota = 0, size_t magazine = 32);
+    ~Concurrent();
+
+    /**
+     * Returns memory block at least of the given size or nullptr if quota is exhausted
+     */
+    void *Alloc(size_t size);
+
+    /**
+     * Frees block, size must be the same as was given to Alloc or its RealSize
+     */
+    void Free(void *ptr, size_t size);
+
+    /**
+     * Actual number of bytes occupied by the allocation of given size
+     */
+    size_t RealSize(size_t size) const;
+
+    /**
+     * Returns all blocks cached by the calling thread to the arena
+     */
+    void Flush();
+
+    /**
+     * Number of bytes taken from the system
+     */
+    size_t Total() const;
+
+    /**
+     * Adds usage of every arena class to the output, blocks cached in magazines are counted as used
+     */
+    void CollectStats(std::vector<SlabAllocator::ClassStats> &stats) const;
+
+private:
+    Concurrent(const Concurrent &);            // = delete;
+    Concurrent &operator=(const Concurrent &); // = delete;
+
+    struct Arena;
+    struct Local;
+
+    /**
+     * Magazines of the calling thread, created on first use
+     */
+    Local &LocalCache();
+
+    // Shared with magazines of all threads, so they could be flushed even after allocator is gone
+    std::shared_ptr<Arena> _arena;
+
+    size_t _magazine;
+};
+
+} // namespace Allocator
+} // namespace Afina
+
+#endif // AFINA_ALLOCATOR_CONCURRENT_H
@@ -1,6 +1,7 @@
 #ifndef AFINA_ALLOCATOR_SIMPLE_H
 #define AFINA_ALLOCATOR_SIMPLE_H
 
+#include <chrono>
 #include <string>
 #include <cstring>
 #include <cstddef>
@@ -8,10 +9,6 @@
 namespace Afina {
 namespace Allocator {
     
-// TODO
-// проверка минимального размера аллокации - done!
-// проверка не занята ли память под нновый дескриптор, если занята - делать дефрагментацию
-
 // Forward declaration. Do not include real class definition
 // to avoid expensive macros calculations and increase compile speed
 class Pointer;
@@ -23,58 +20,132 @@ class Pointer;
  * Allocator instance doesn't take ownership of wrapped memmory and do not delete it
  * on destruction. So caller must take care of resource cleaup after allocator stop
  * being needs
+ *
+ * Blocks are placed from the start of area, table of descriptors grows down from its end. Free
+ * blocks are kept in segregated lists indexed by two level bitmap (TLSF), so alloc takes a block
+ * that surely fits without any search and free merges neighbours found by boundary tags: both are
+ * O(1). Free descriptors are kept in a stack linked through the descriptors themselves
+ *
+ * Compaction could be done incrementally by defragStep, each step has bounded cost, so it could be
+ * called from idle hook without causing latency spikes. Once defrag budget is set, alloc never
+ * compacts the whole area itself
  */
 // TODO: Implements interface to allow usage as C++ allocators
 class Simple {
-private:
-    void* base;
-    size_t size;
-    struct FreeBlock {
-        size_t size;
-        FreeBlock* next; // next free block
-    };
-    FreeBlock* freeBlocksHead;
-    static const size_t lastBlockSize = 0;
-    void* descriptor;
-    size_t nDescriptors;
-    void updateDescriptor(void* old_ptr, void* new_ptr);
-    void findSurroundingBlocks(void* ptr, void* before, void* after);
-
 public:
     Simple(void *base, const size_t size);
 
     /**
-     * TODO: semantics
+     * Allocates block of at least N bytes, throws AllocError if there is no free block large
+     * enough. If descriptors table has to grow and there is no room for it, memory is compacted:
+     * completely if defrag budget is not set, by a single step otherwise
      * @param N size_t
      */
     Pointer alloc(size_t N);
 
     /**
-     * TODO: semantics
+     * Changes size of the block keeping its content, block is moved only if it can't be
+     * resized in place. Pointer stays the same, so all its copies remain valid
      * @param p Pointer
      * @param N size_t
      */
     void realloc(Pointer &p, size_t N);
 
     /**
-     * TODO: semantics
+     * Frees block and resets given pointer, its copies become invalid
      * @param p Pointer
      */
     void free(Pointer &p);
 
     /**
-     * TODO: semantics
+     * Moves all used blocks to the start of area, so all free memory becomes a single block
      */
     void defrag();
 
+    /**
+     * Continues compaction from the point previous step stopped at. Moves used blocks until
+     * max_bytes are moved or max_time passes, at least one block is moved per step. Zero time means
+     * no time limit. Returns true if there is more work to do, false once pass over the whole area
+     * is finished, the next call starts a new pass then
+     * @param max_bytes size_t
+     * @param max_time std::chrono::nanoseconds
+     */
+    bool defragStep(size_t max_bytes, std::chrono::nanoseconds max_time = std::chrono::nanoseconds::zero());
+
+    /**
+     * Sets number of bytes alloc could move when it needs room for descriptors, zero means alloc
+     * compacts the whole area
+     * @param max_bytes size_t
+     */
+    void setDefragBudget(size_t max_bytes) { _defrag_budget = max_bytes; }
+
     /**
      * TODO: semantics
      */
     std::string dump() const;
 
 private:
-    void *_base;
-//    const size_t _base_len;
+    /**
+     * Header of every block. Free blocks keep links of their list right after the header
+     */
+    struct Block {
+        // Size of the previous block, valid only if it is free
+        size_t prev_size;
+
+        // Size of the block including header, low bits are flags
+        size_t size;
+
+        // Descriptor pointing to the used block
+        void **descriptor;
+    };
+
+    struct FreeLinks {
+        Block *prev;
+        Block *next;
+    };
+
+    // Number of first level classes and log2 of number of second level classes in each of them
+    static const size_t FirstLevels = sizeof(size_t) * 8;
+    static const size_t SecondBits = 4;
+    static const size_t SecondLevels = 1 << SecondBits;
+
+    void *payload(Block *block) const { return block + 1; }
+    Block *blockOf(void *ptr) const { return static_cast<Block *>(ptr) - 1; }
+    Block *next(Block *block) const;
+    FreeLinks *links(Block *block) const { return reinterpret_cast<FreeLinks *>(block + 1); }
+
+    static void mapping(size_t size, size_t &fl, size_t &sl);
+    void insertFree(Block *block);
+    void removeFree(Block *block);
+    Block *findFree(size_t size);
+    void split(Block *block, size_t size);
+    Block *merge(Block *block);
+    void markUsed(Block *block, bool used);
+
+    void **takeDescriptor();
+    void putDescriptor(void **desc);
+    bool growTable();
+
+    char *_base;
+    char *_end;
+
+    // Lowest descriptor in the table, table occupies [_table, _end)
+    void **_table;
+
+    // Physically last block, the one table grows into
+    Block *_last;
+
+    // Stack of free descriptors
+    void **_free_descriptors;
+
+    // Block incremental compaction continues from, everything before it is already compacted
+    Block *_cursor;
+    size_t _defrag_budget;
+
+    // Bitmaps of non empty lists
+    size_t _first_bitmap;
+    size_t _second_bitmap[FirstLevels];
+    Block *_lists[FirstLevels][SecondLevels];
 };
 
 } // namespace Allocator
@@ -0,0 +1,268 @@
+#ifndef AFINA_ALLOCATOR_SLAB_H
+#define AFINA_ALLOCATOR_SLAB_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Afina {
+namespace Allocator {
+
+/**
+ * # Source of fixed size memory blocks
+ * Slabs are aligned by their size, so the slab that owns any object could be found by masking
+ * object address. Slabs returned to the cache are kept for reuse instead of being given back to
+ * the system, so memory footprint stays stable under churn.
+ *
+ * Cache could be limited by quota: total number of bytes taken from the system, including large
+ * allocations that doesn't fit into slab. Zero quota means no limit.
+ *
+ * That is NOT thread safe implementation!!
+ */
+class SlabCache {
+public:
+    /**
+     * @param slab_size size of the slab, must be a power of 2
+     * @param quota maximum number of bytes to take from the system, zero if unlimited
+     */
+    SlabCache(size_t slab_size = 1024 * 1024, size_t quota = 0);
+    ~SlabCache();
+
+    /**
+     * Returns new slab or nullptr if quota is exhausted
+     */
+    void *Get();
+
+    /**
+     * Returns slab to the cache
+     */
+    void Put(void *slab);
+
+    /**
+     * Allocates memory block that is too large to fit into slab, returns nullptr if quota is
+     * exhausted. Cached slabs are released to the system if that helps to fit into quota
+     */
+    void *AllocLarge(size_t size);
+    void FreeLarge(void *ptr, size_t size);
+
+    /**
+     * Releases all cached slabs to the system
+     */
+    void Trim();
+
+    size_t SlabSize() const { return _slab_size; }
+    size_t Quota() const { return _quota; }
+
+    /**
+     * Number of bytes taken from the system
+     */
+    size_t Total() const { return _total; }
+
+    /**
+     * Number of bytes in slabs and large blocks that are in use
+     */
+    size_t Used() const { return _used; }
+
+private:
+    SlabCache(const SlabCache &);            // = delete;
+    SlabCache &operator=(const SlabCache &); // = delete;
+
+    bool Fits(size_t size) const { return _quota == 0 || _total + size <= _quota; }
+
+    size_t _slab_size;
+    size_t _quota;
+    size_t _total;
+    size_t _used;
+
+    // Cached slabs, linked through their first word
+    void *_free;
+};
+
+/**
+ * # Pool of objects of the same size
+ * Objects are carved from slabs taken from the cache. Each slab tracks its live objects, so slab
+ * is given back to the cache as soon as the last object in it is freed, and it is possible to find
+ * all objects living in the slab in order to free it on purpose.
+ *
+ * That is NOT thread safe implementation!!
+ */
+class Mempool {
+public:
+    /**
+     * Header placed at the start of each slab, followed by bitmap of live objects
+     */
+    struct Slab {
+        Mempool *pool;
+
+        // Neighbours in the list of partial or full slabs
+        Slab *prev;
+        Slab *next;
+
+        // Objects freed in this slab
+        void *free;
+
+        // Number of objects never allocated yet, they are taken from the end of slab
+        size_t untouched;
+
+        // Number of live objects
+        size_t used;
+
+        uint64_t *bitmap() { return reinterpret_cast<uint64_t *>(this + 1); }
+    };
+
+    Mempool(SlabCache &cache, size_t object_size);
+    ~Mempool();
+
+    /**
+     * Returns new object or nullptr if cache can't give a new slab
+     */
+    void *Alloc();
+
+    /**
+     * Frees object allocated by this pool
+     */
+    void Free(void *ptr);
+
+    /**
+     * Slab holding the given object
+     */
+    Slab *SlabOf(void *ptr) const {
+        return reinterpret_cast<Slab *>(reinterpret_cast<uintptr_t>(ptr) & ~(_cache.SlabSize() - 1));
+    }
+
+    /**
+     * Partially used slab with the least number of live objects, nullptr if there is no such
+     */
+    Slab *Sparsest() const;
+
+    /**
+     * Appends all live objects of the given slab to the output
+     */
+    void Objects(Slab *slab, std::vector<void *> &out) const;
+
+    size_t ObjectSize() const { return _object_size; }
+
+    /**
+     * Number of slabs owned by the pool
+     */
+    size_t Slabs() const { return _slabs; }
+
+    /**
+     * Number of live objects
+     */
+    size_t Used() const { return _used; }
+
+    /**
+     * Number of objects that could be allocated without taking a new slab
+     */
+    size_t Available() const { return _slabs * _objects_per_slab - _used; }
+
+private:
+    Mempool(const Mempool &);            // = delete;
+    Mempool &operator=(const Mempool &); // = delete;
+
+    char *ObjectAt(Slab *slab, size_t i) const { return reinterpret_cast<char *>(slab) + _offset + i * _object_size; }
+    size_t IndexOf(Slab *slab, void *ptr) const {
+        return (static_cast<char *>(ptr) - reinterpret_cast<char *>(slab) - _offset) / _object_size;
+    }
+
+    static void Link(Slab *&head, Slab *slab);
+    static void Unlink(Slab *&head, Slab *slab);
+
+    SlabCache &_cache;
+    size_t _object_size;
+
+    // Offset of the first object in slab, right after header and bitmap
+    size_t _offset;
+    size_t _objects_per_slab;
+
+    size_t _slabs;
+    size_t _used;
+
+    // Slabs having free objects and full ones, empty slabs are given back to cache right away
+    Slab *_partial;
+    Slab *_full;
+};
+
+/**
+ * # Size class allocator
+ * Set of pools with object sizes growing in geometric progression. Request is served by the pool
+ * with the smallest objects it fits in, so internal fragmentation is bounded by the progression factor.
+ * Requests larger than the biggest class are forwarded to the cache as large blocks.
+ *
+ * That is NOT thread safe implementation!!
+ */
+class SlabAllocator {
+public:
+    /**
+     * Per class usage
+     */
+    struct ClassStats {
+        size_t size;
+        size_t slabs;
+        size_t used;
+        size_t free;
+    };
+
+    /**
+     * @param cache to take slabs from
+     * @param min_size size of the smallest class
+     * @param factor ratio between sizes of neighbour classes
+     */
+    SlabAllocator(SlabCache &cache, size_t min_size = 64, double factor = 1.25);
+    ~SlabAllocator();
+
+    /**
+     * Returns memory block at least of the given size or nullptr if cache quota is exhausted
+     */
+    void *Alloc(size_t size);
+
+    /**
+     * Frees block, size must be the same as was given to Alloc or its RealSize
+     */
+    void Free(void *ptr, size_t size);
+
+    /**
+     * Index of the class serving given size or Classes() if allocation is large
+     */
+    size_t ClassOf(size_t size) const;
+
+    /**
+     * Actual number of bytes occupied by the allocation of given size
+     */
+    size_t RealSize(size_t size) const;
+
+    size_t Classes() const { return _pools.size(); }
+    Mempool &Pool(size_t i) { return *_pools[i]; }
+    const Mempool &Pool(size_t i) const { return *_pools[i]; }
+
+    /**
+     * Number of live large blocks and bytes in them
+     */
+    size_t LargeCount() const { return _large_count; }
+    size_t LargeSize() const { return _large_size; }
+
+    /**
+     * Adds usage of every class to the output, which is resized to the number of classes if needed
+     */
+    void CollectStats(std::vector<ClassStats> &stats) const;
+
+    SlabCache &Cache() { return _cache; }
+
+private:
+    SlabAllocator(const SlabAllocator &);            // = delete;
+    SlabAllocator &operator=(const SlabAllocator &); // = delete;
+
+    SlabCache &_cache;
+
+    // Sorted by object size
+    std::vector<Mempool *> _pools;
+
+    size_t _large_count;
+    size_t _large_size;
+};
+
+} // namespace Allocator
+} // namespace Afina
+
+#endif // AFINA_ALLOCATOR_SLAB_H
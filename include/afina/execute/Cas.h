@@ -0,0 +1,46 @@
+#ifndef AFINA_EXECUTE_CAS_H
+#define AFINA_EXECUTE_CAS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "InsertCommand.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Check and set
+ * Store this data, but only if no one else has updated it since client last fetched it. Storage
+ * doesn't version items, so unique value "gets" returns is a digest of the value bytes: update
+ * that leaves value the same isn't seen as a change
+ *
+ * Command must write result to the output, which could be:
+ * - "STORED", to indicate success.
+ * - "EXISTS" to indicate that the item has been modified since it was fetched
+ * - "NOT_FOUND" to indicate that the item with this key was not found
+ */
+class Cas : public InsertCommand {
+public:
+    Cas(const std::string &key, uint32_t flags, int32_t expire, uint64_t unique)
+        : InsertCommand(key, flags, expire), _unique(unique) {}
+    ~Cas() {}
+
+    inline uint64_t unique() const { return _unique; }
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+    /**
+     * Unique value of the item with given bytes
+     */
+    static uint64_t Unique(const char *data, size_t size);
+
+private:
+    const uint64_t _unique;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_CAS_H
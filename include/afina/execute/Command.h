@@ -9,16 +9,35 @@ class Storage;
 
 namespace Execute {
 
+class Response;
+
 /**
  *
  *
  */
 class Command {
 public:
-    Command() {}
+    Command() : _noreply(false) {}
     virtual ~Command() {}
 
+    /**
+     * Client asked not to send response back, command is executed but default Execute below appends
+     * nothing to the output
+     */
+    inline bool noreply() const { return _noreply; }
+    inline void noreply(bool value) { _noreply = value; }
+
     virtual void Execute(Storage &storage, const std::string &args, std::string &out) = 0;
+
+    /**
+     * Executes command and appends complete protocol response, including the trailing \r\n, to the
+     * given output. Default implementation wraps string based Execute, commands that return values
+     * should override it to pass values without copying
+     */
+    virtual void Execute(Storage &storage, const std::string &args, Response &out);
+
+protected:
+    bool _noreply;
 };
 
 } // namespace Execute
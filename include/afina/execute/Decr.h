@@ -0,0 +1,28 @@
+#ifndef AFINA_EXECUTE_DECR_H
+#define AFINA_EXECUTE_DECR_H
+
+#include <cstdint>
+#include <string>
+
+#include "ArithmeticCommand.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Decrement value for the key
+ * Subtracts delta from the value, result never goes below zero
+ */
+class Decr : public ArithmeticCommand {
+public:
+    Decr(const std::string &key, uint64_t delta) : ArithmeticCommand(key, delta) {}
+    ~Decr() {}
+
+protected:
+    uint64_t Apply(uint64_t value) const override;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_DECR_H
@@ -24,7 +24,8 @@ namespace Execute {
  * END
  *
  * Where <key> is the key for the value, <bytes> is the number of bytes in the
- * value and <data> is the value text
+ * value and <data> is the value text. Command built for "gets" adds unique value
+ * of the item after <bytes>, see Cas
  *
  * If some of the keys appearing in a retrieval request are not sent back
  * by the server in the item list this means that the server does not
@@ -34,15 +35,20 @@ namespace Execute {
  */
 class Get : public Command {
 public:
-    Get(const std::vector<std::string> &keys) : _keys(keys) {}
+    Get(const std::vector<std::string> &keys, bool cas = false) : _keys(keys), _cas(cas) {}
     ~Get() {}
 
     inline const std::vector<std::string> &keys() const { return _keys; }
+    inline bool cas() const { return _cas; }
 
     void Execute(Storage &storage, const std::string &args, std::string &out) override;
 
+    // Values are passed to the output by reference, without copying
+    void Execute(Storage &storage, const std::string &args, Response &out) override;
+
 private:
     std::vector<std::string> _keys;
+    bool _cas;
 };
 
 } // namespace Execute
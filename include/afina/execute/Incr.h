@@ -0,0 +1,28 @@
+#ifndef AFINA_EXECUTE_INCR_H
+#define AFINA_EXECUTE_INCR_H
+
+#include <cstdint>
+#include <string>
+
+#include "ArithmeticCommand.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Increment value for the key
+ * Adds delta to the value, result wraps around at 64 bits
+ */
+class Incr : public ArithmeticCommand {
+public:
+    Incr(const std::string &key, uint64_t delta) : ArithmeticCommand(key, delta) {}
+    ~Incr() {}
+
+protected:
+    uint64_t Apply(uint64_t value) const override;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_INCR_H
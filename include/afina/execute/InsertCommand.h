@@ -22,6 +22,14 @@ public:
     inline const uint32_t flags() const { return _flags; }
     inline const int32_t expire() const { return _expire; }
 
+    /**
+     * Converts memcached expiration time into number of seconds item should live, zero if item never
+     * expires. Time up to 30 days is relative, larger one is an absolute unix time. Returns false if item
+     * is expired already, i.e time is negative or in the past
+     */
+    bool TimeToLive(uint32_t &ttl) const { return TimeToLive(_expire, ttl); }
+    static bool TimeToLive(int32_t expire, uint32_t &ttl);
+
 protected:
     const std::string _key;
     const uint32_t _flags;
@@ -0,0 +1,87 @@
+#ifndef AFINA_EXECUTE_RESPONSE_H
+#define AFINA_EXECUTE_RESPONSE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <afina/Value.h>
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Command output as a sequence of chunks
+ * Protocol text is accumulated in the internal buffer while values are referenced by handles, so
+ * their bytes reach the socket without being copied. Chunks are laid out in order they were appended
+ * and could be passed directly to writev/uv_write
+ */
+class Response {
+public:
+    // Values shorter than that are copied into text buffer: for small values pinning and extra
+    // iovec entry cost more than copy itself
+    static const size_t InlineThreshold = 64;
+
+    Response() : _size(0) {}
+
+    /**
+     * Appends protocol text
+     */
+    void Append(const char *data, size_t size);
+    void Append(const std::string &text) { Append(text.data(), text.size()); }
+
+    /**
+     * Appends value bytes, the value is kept referenced until response is cleared
+     */
+    void Append(const Value &value);
+
+    /**
+     * Number of chunks in response
+     */
+    size_t Chunks() const { return _chunks.size(); }
+
+    /**
+     * Returns address and size of the chunk with the given index. Address stays valid until
+     * response gets changed
+     */
+    void Chunk(size_t i, const char *&data, size_t &size) const;
+
+    /**
+     * Total number of bytes in all chunks
+     */
+    size_t Size() const { return _size; }
+
+    bool Empty() const { return _size == 0; }
+
+    /**
+     * Drops all chunks and releases referenced values
+     */
+    void Clear();
+
+    /**
+     * Copies all chunks into the single string
+     */
+    std::string ToString() const;
+
+private:
+    /**
+     * Either range of text buffer or a referenced value, if value handle is empty
+     */
+    struct Part {
+        size_t offset;
+        size_t size;
+        Value value;
+    };
+
+    // Text chunks, referenced by offset as buffer could be reallocated
+    std::string _text;
+
+    std::vector<Part> _chunks;
+
+    size_t _size;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_RESPONSE_H
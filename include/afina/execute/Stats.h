@@ -1,7 +1,10 @@
 #ifndef AFINA_EXECUTE_STATS_H
 #define AFINA_EXECUTE_STATS_H
 
+#include <functional>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "Command.h"
 
@@ -13,6 +16,19 @@ public:
     Stats() {}
     ~Stats() {}
     void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+    typedef std::function<void(std::vector<std::pair<std::string, std::string>> &)> Source;
+
+    /**
+     * Registers process wide source of statistics reported after the storage ones, such as thread pool of
+     * the network layer. Returns id to unregister source with
+     */
+    static size_t AddSource(Source source);
+
+    /**
+     * Unregisters source, once method returns source is not called anymore
+     */
+    static void RemoveSource(size_t id);
 };
 
 } // namespace Execute
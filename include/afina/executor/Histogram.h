@@ -0,0 +1,58 @@
+#ifndef AFINA_EXECUTOR_HISTOGRAM_H
+#define AFINA_EXECUTOR_HISTOGRAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Afina {
+
+/**
+ * # Histogram of non-negative values
+ * Buckets are HDR style: each power of two range is split into SubBuckets linear buckets, so any value is
+ * reported with relative error below 1/SubBuckets while all 64 bit values fit into the fixed array.
+ *
+ * Record is wait-free and could be called from any number of threads, readers see a consistent enough
+ * picture without stopping writers
+ */
+class Histogram {
+public:
+    static const size_t SubBucketBits = 4;
+    static const size_t SubBuckets = size_t(1) << SubBucketBits;
+    static const size_t Buckets = (64 - SubBucketBits + 1) * SubBuckets;
+
+    Histogram();
+
+    void Record(uint64_t value);
+
+    uint64_t Count() const { return _count.load(std::memory_order_relaxed); }
+
+    uint64_t Sum() const { return _sum.load(std::memory_order_relaxed); }
+
+    uint64_t Max() const { return _max.load(std::memory_order_relaxed); }
+
+    /**
+     * Returns upper bound of the bucket containing given percentile (0..100) of recorded values, 0 if
+     * nothing was recorded
+     */
+    uint64_t Percentile(double percentile) const;
+
+    /**
+     * Bucket the value goes to and the largest value of the bucket
+     */
+    static size_t BucketOf(uint64_t value);
+    static uint64_t UpperBound(size_t bucket);
+
+private:
+    Histogram(const Histogram &);            // = delete;
+    Histogram &operator=(const Histogram &); // = delete;
+
+    std::atomic<uint64_t> _buckets[Buckets];
+    std::atomic<uint64_t> _count;
+    std::atomic<uint64_t> _sum;
+    std::atomic<uint64_t> _max;
+};
+
+} // namespace Afina
+
+#endif // AFINA_EXECUTOR_HISTOGRAM_H
@@ -0,0 +1,184 @@
+#ifndef AFINA_EXECUTOR_TASK_H
+#define AFINA_EXECUTOR_TASK_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Afina {
+
+/**
+ * # Move-only callable without arguments
+ * Callables up to InlineSize bytes which could be moved without exceptions are stored right in the task,
+ * so unlike std::function creating a task for a lambda with a few captures doesn't touch the heap. Larger
+ * ones are allocated as std::function would do
+ */
+class Task {
+public:
+    static const size_t InlineSize = 64;
+
+    Task() : _ops(nullptr) {}
+
+    template <typename F, typename = typename std::enable_if<
+                              !std::is_same<typename std::decay<F>::type, Task>::value>::type>
+    Task(F &&func) {
+        typedef typename std::decay<F>::type Callable;
+        Init<Callable>(std::forward<F>(func), std::integral_constant<bool, IsInline<Callable>()>());
+    }
+
+    Task(Task &&other) : _ops(other._ops) {
+        if (_ops != nullptr) {
+            _ops->move(_storage, other._storage);
+            other._ops = nullptr;
+        }
+    }
+
+    Task &operator=(Task &&other) {
+        if (this != &other) {
+            Reset();
+            if (other._ops != nullptr) {
+                other._ops->move(_storage, other._storage);
+                _ops = other._ops;
+                other._ops = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    ~Task() { Reset(); }
+
+    /**
+     * Runs the callable, task must not be empty
+     */
+    void operator()() { _ops->invoke(_storage); }
+
+    explicit operator bool() const { return _ops != nullptr; }
+
+    /**
+     * Destroys the callable, task becomes empty
+     */
+    void Reset() {
+        if (_ops != nullptr) {
+            _ops->destroy(_storage);
+            _ops = nullptr;
+        }
+    }
+
+private:
+    Task(const Task &);            // = delete;
+    Task &operator=(const Task &); // = delete;
+
+    /**
+     * Type erased operations on the stored callable, one static table per callable type
+     */
+    struct Ops {
+        void (*invoke)(void *storage);
+        void (*move)(void *to, void *from);
+        void (*destroy)(void *storage);
+    };
+
+    template <typename F> static constexpr bool IsInline() {
+        return sizeof(F) <= InlineSize && alignof(F) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible<F>::value;
+    }
+
+    template <typename F> struct InlineOps {
+        static void Invoke(void *storage) { (*static_cast<F *>(storage))(); }
+        static void Move(void *to, void *from) {
+            new (to) F(std::move(*static_cast<F *>(from)));
+            static_cast<F *>(from)->~F();
+        }
+        static void Destroy(void *storage) { static_cast<F *>(storage)->~F(); }
+        static const Ops ops;
+    };
+
+    // Storage keeps the pointer to the callable
+    template <typename F> struct HeapOps {
+        static void Invoke(void *storage) { (**static_cast<F **>(storage))(); }
+        static void Move(void *to, void *from) { *static_cast<F **>(to) = *static_cast<F **>(from); }
+        static void Destroy(void *storage) { delete *static_cast<F **>(storage); }
+        static const Ops ops;
+    };
+
+    template <typename F, typename A> void Init(A &&func, std::true_type) {
+        new (_storage) F(std::forward<A>(func));
+        _ops = &InlineOps<F>::ops;
+    }
+
+    template <typename F, typename A> void Init(A &&func, std::false_type) {
+        *reinterpret_cast<F **>(_storage) = new F(std::forward<A>(func));
+        _ops = &HeapOps<F>::ops;
+    }
+
+    alignas(std::max_align_t) char _storage[InlineSize];
+    const Ops *_ops;
+};
+
+template <typename F> const Task::Ops Task::InlineOps<F>::ops = {&Invoke, &Move, &Destroy};
+template <typename F> const Task::Ops Task::HeapOps<F>::ops = {&Invoke, &Move, &Destroy};
+
+/**
+ * # FIFO queue in a ring buffer
+ * Buffer doubles once full and is never shrunk, so after queue reached its working size push and pop
+ * don't allocate, unlike std::deque which allocates and frees blocks as the queue moves along. Items
+ * must be default constructible and movable
+ */
+template <typename T> class RingQueue {
+public:
+    RingQueue(size_t capacity = 64) : _capacity(1), _head(0), _size(0) {
+        while (_capacity < capacity) {
+            _capacity <<= 1;
+        }
+        _items.reset(new T[_capacity]);
+    }
+
+    bool Empty() const { return _size == 0; }
+
+    size_t Size() const { return _size; }
+
+    void Push(T &&item) {
+        if (_size == _capacity) {
+            Grow();
+        }
+        _items[(_head + _size) & (_capacity - 1)] = std::move(item);
+        _size++;
+    }
+
+    /**
+     * Takes the oldest item, queue must not be empty
+     */
+    T Pop() {
+        T item(std::move(_items[_head]));
+        _head = (_head + 1) & (_capacity - 1);
+        _size--;
+        return item;
+    }
+
+private:
+    RingQueue(const RingQueue &);            // = delete;
+    RingQueue &operator=(const RingQueue &); // = delete;
+
+    void Grow() {
+        std::unique_ptr<T[]> grown(new T[_capacity * 2]);
+        for (size_t i = 0; i < _size; i++) {
+            grown[i] = std::move(_items[(_head + i) & (_capacity - 1)]);
+        }
+
+        _items.swap(grown);
+        _capacity *= 2;
+        _head = 0;
+    }
+
+    std::unique_ptr<T[]> _items;
+    size_t _capacity;
+    size_t _head;
+    size_t _size;
+};
+
+typedef RingQueue<Task> TaskQueue;
+
+} // namespace Afina
+
+#endif // AFINA_EXECUTOR_TASK_H
@@ -2,6 +2,8 @@
 #define AFINA_NETWORK_SERVER_H
 
 #include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 namespace Afina {
@@ -40,6 +42,11 @@ public:
      */
     virtual void Join() = 0;
 
+    /**
+     * Appends server statistics as a name/value pairs, see Storage::CollectStats
+     */
+    virtual void CollectStats(std::vector<std::pair<std::string, std::string>> &stats) const {}
+
 protected:
     /**
      * Instance of backing storeage on which current server should execute
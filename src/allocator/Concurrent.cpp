@@ -0,0 +1,152 @@
+#include <afina/allocator/Concurrent.h>
+
+#include <atomic>
+#include <mutex>
+
+namespace Afina {
+namespace Allocator {
+
+/**
+ * Shared part of the allocator, every access is serialized by the lock
+ */
+struct Concurrent::Arena {
+    std::mutex lock;
+
+    // Cache must outlive allocator that returns slabs into it
+    SlabCache cache;
+    SlabAllocator allocator;
+
+    // Cleared once allocator is destroyed, magazines of dead arena are flushed on the next lookup
+    std::atomic<bool> alive;
+
+    Arena(size_t slab_size, size_t quota) : cache(slab_size, quota), allocator(cache), alive(true) {}
+};
+
+/**
+ * Magazines of one thread for one allocator, indexed by size class
+ */
+struct Concurrent::Local {
+    std::shared_ptr<Arena> arena;
+    std::vector<std::vector<void *>> magazines;
+
+    Local(const std::shared_ptr<Arena> &arena) : arena(arena), magazines(arena->allocator.Classes()) {}
+    ~Local() { Flush(); }
+
+    void Flush() {
+        std::unique_lock<std::mutex> guard(arena->lock);
+        for (size_t i = 0; i < magazines.size(); i++) {
+            Mempool &pool = arena->allocator.Pool(i);
+            for (void *ptr : magazines[i]) {
+                pool.Free(ptr);
+            }
+            magazines[i].clear();
+        }
+    }
+};
+
+// See Concurrent.h
+Concurrent::Concurrent(size_t slab_size, size_t quota, size_t magazine)
+    : _arena(std::make_shared<Arena>(slab_size, quota)), _magazine(magazine > 0 ? magazine : 1) {}
+
+// Magazines of other threads can't be touched from here, they keep arena alive until flushed
+// See Concurrent.h
+Concurrent::~Concurrent() {
+    Flush();
+    _arena->alive.store(false, std::memory_order_release);
+}
+
+// See Concurrent.h
+void *Concurrent::Alloc(size_t size) {
+    // Classes are never changed after construction, so they could be inspected without lock
+    size_t i = _arena->allocator.ClassOf(size);
+    if (i == _arena->allocator.Classes()) {
+        std::unique_lock<std::mutex> guard(_arena->lock);
+        return _arena->allocator.Alloc(size);
+    }
+
+    std::vector<void *> &magazine = LocalCache().magazines[i];
+    if (magazine.empty()) {
+        std::unique_lock<std::mutex> guard(_arena->lock);
+        Mempool &pool = _arena->allocator.Pool(i);
+        while (magazine.size() < _magazine) {
+            void *ptr = pool.Alloc();
+            if (ptr == nullptr) {
+                break;
+            }
+            magazine.push_back(ptr);
+        }
+
+        if (magazine.empty()) {
+            return nullptr;
+        }
+    }
+
+    void *ptr = magazine.back();
+    magazine.pop_back();
+    return ptr;
+}
+
+// Magazine holds up to two batches, so thread that alternates Alloc and Free at the batch boundary
+// doesn't go to the arena every time. Most recently freed blocks are kept as they are likely in cache
+// See Concurrent.h
+void Concurrent::Free(void *ptr, size_t size) {
+    size_t i = _arena->allocator.ClassOf(size);
+    if (i == _arena->allocator.Classes()) {
+        std::unique_lock<std::mutex> guard(_arena->lock);
+        _arena->allocator.Free(ptr, size);
+        return;
+    }
+
+    std::vector<void *> &magazine = LocalCache().magazines[i];
+    magazine.push_back(ptr);
+    if (magazine.size() >= 2 * _magazine) {
+        std::unique_lock<std::mutex> guard(_arena->lock);
+        Mempool &pool = _arena->allocator.Pool(i);
+        for (size_t n = 0; n < _magazine; n++) {
+            pool.Free(magazine[n]);
+        }
+        magazine.erase(magazine.begin(), magazine.begin() + _magazine);
+    }
+}
+
+// See Concurrent.h
+size_t Concurrent::RealSize(size_t size) const { return _arena->allocator.RealSize(size); }
+
+// See Concurrent.h
+void Concurrent::Flush() { LocalCache().Flush(); }
+
+// See Concurrent.h
+size_t Concurrent::Total() const {
+    std::unique_lock<std::mutex> guard(_arena->lock);
+    return _arena->cache.Total();
+}
+
+// See Concurrent.h
+void Concurrent::CollectStats(std::vector<SlabAllocator::ClassStats> &stats) const {
+    std::unique_lock<std::mutex> guard(_arena->lock);
+    _arena->allocator.CollectStats(stats);
+}
+
+// Thread usually works with one or two allocators, so plain list is scanned. Magazines of destroyed
+// allocators are released along the way
+// See Concurrent.h
+Concurrent::Local &Concurrent::LocalCache() {
+    static thread_local std::vector<std::unique_ptr<Local>> locals;
+    for (auto it = locals.begin(); it != locals.end();) {
+        if ((*it)->arena == _arena) {
+            return **it;
+        }
+
+        if (!(*it)->arena->alive.load(std::memory_order_acquire)) {
+            it = locals.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    locals.emplace_back(new Local(_arena));
+    return *locals.back();
+}
+
+} // namespace Allocator
+} // namespace Afina
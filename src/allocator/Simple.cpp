@@ -2,128 +2,75 @@
 #include <afina/allocator/Error.h>
 #include <afina/allocator/Pointer.h>
 
+#include <cstdint>
+
 namespace Afina {
 namespace Allocator {
 
-Simple::Simple(void *base, size_t size) : 
-    base(base),
-    size(size),
-    nDescriptors(0)
+// Flags kept in the low bits of the block size
+static const size_t UsedFlag = 1;
+static const size_t PrevFreeFlag = 2;
+static const size_t FlagsMask = 7;
+
+// Free descriptors are linked through themselves, link is tagged to never look like a block address
+static const uintptr_t FreeDescriptorTag = 1;
+
+static size_t sizeOf(const void *block) { return *(reinterpret_cast<const size_t *>(block) + 1) & ~FlagsMask; }
+
+static size_t highestBit(size_t value) { return sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(value); }
+
+static size_t lowestBit(size_t value) { return __builtin_ctzll(value); }
+
+Simple::Simple(void *base, size_t size) :
+    _base(reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(base) + 7) & ~uintptr_t(7))),
+    _end(reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(base) + size) & ~uintptr_t(7))),
+    _free_descriptors(nullptr),
+    _cursor(reinterpret_cast<Block *>(_base)),
+    _defrag_budget(0),
+    _first_bitmap(0)
 {
-    // create table of descriptors
-    nDescriptors ++;
-    // first descriptor
-    descriptor = (void*)((char*)base + size - lastBlockSize - sizeof(void*));
-    *((void**)descriptor) = base;
-    // whole memory is one free block
-    freeBlocksHead = (FreeBlock*)base;
-    freeBlocksHead->size = size - lastBlockSize - nDescriptors * sizeof(void*);
-    freeBlocksHead->next = nullptr;
+    if( _end < _base || size_t(_end - _base) < sizeof(Block) + sizeof(FreeLinks) )
+        throw AllocError(AllocErrorType::NoMemory, "Memory area is too small");
+
+    for(size_t fl = 0; fl < FirstLevels; ++fl) {
+        _second_bitmap[fl] = 0;
+        for(size_t sl = 0; sl < SecondLevels; ++sl)
+            _lists[fl][sl] = nullptr;
+    }
+
+    // table is empty, whole memory is one free block
+    _table = reinterpret_cast<void **>(_end);
+    _last = reinterpret_cast<Block *>(_base);
+    _last->prev_size = 0;
+    _last->size = _end - _base;
+    insertFree(_last);
 }
-//Simple::Simple(void *base, size_t size) : _base(base), _base_len(size) {}
 
 /**
  * @param N size_t
  */
 Pointer Simple::alloc(size_t N) {
     // check minimal allocation size - after dealloc we should be able
-    // to create a FreeBlock struct in this memory
-    if( N < sizeof(FreeBlock) )
-        N = sizeof(FreeBlock);
-    FreeBlock* prevBlock = nullptr;
-    FreeBlock* curBlock = freeBlocksHead;
-    // searching among free blocks for the one with proper size
-    while( curBlock != nullptr )
-    {
-        if( curBlock->size >= N ) {
-            break;
-        } else {
-            prevBlock = curBlock;
-            curBlock = curBlock->next;
-        }
-    }
-    if( curBlock == nullptr ) {
-        // perform defrag and check again
-        // warning: seems to ruin some defrag tests by defragmentating data while allocating
-        /* defrag();
-        prevBlock = nullptr;
-        curBlock = freeBlocksHead;
-        while( curBlock != nullptr ) {
-            if( curBlock->size >= N ) {
-                break;
-            } else {
-                prevBlock = curBlock;
-                curBlock = curBlock->next;
-            }
-        }
-        if( curBlock == nullptr )*/
+    // to keep free list links in this memory
+    if( N < sizeof(FreeLinks) )
+        N = sizeof(FreeLinks);
+    size_t blockSize = sizeof(Block) + ((N + 7) & ~size_t(7));
+
+    // descriptor goes first: table growth may move blocks
+    void **desc = takeDescriptor();
+    Block *block = findFree(blockSize);
+    if( block == nullptr ) {
+        putDescriptor(desc);
         throw AllocError(AllocErrorType::NoMemory, "No memory");
-    } else {
-        // try to add new descriptor
-        static int defragDone = 0;
-        // find free cell among descriptors
-        void* new_desc = descriptor;  // start from last descriptor
-        bool enlargeTable = false;
-        for(size_t i = 0; i < nDescriptors; ++i)
-        {
-            if( *(void**)new_desc == nullptr )
-                break;
-            else
-                new_desc = (void*)((char*)new_desc - sizeof(void*));
-            if( i == nDescriptors - 1 )
-                enlargeTable = true;
-        }
-        FreeBlock* lastBlock;
-        if( enlargeTable ) {
-            // find the last free block
-            FreeBlock* lastBlock = freeBlocksHead;
-            while( lastBlock->next != nullptr )
-                lastBlock = lastBlock->next;
-            // check if there is no occupied blocks between lastBlock and desc table
-            if( (char*)lastBlock + lastBlock->size < (char*)new_desc ) {
-                if( defragDone % 2 == 0 ) {
-                    defrag();
-                    defragDone = (defragDone + 1) % 2;
-                    return alloc(N);
-                } else {
-                    throw AllocError(AllocErrorType::NoMemory, "No memory");
-                }
-            }
-        }
+    }
 
-        if( prevBlock == nullptr ) {
-            // first free block is getting allocated
-            if( curBlock->next != nullptr ) {
-                freeBlocksHead = curBlock->next; 
-            } else {
-                freeBlocksHead = (FreeBlock*)((char*)curBlock + N);
-                freeBlocksHead->size = curBlock->size - N;
-                freeBlocksHead->next = nullptr;  // here curBlock->next == nullptr
-            }
-        } else {
-            if( curBlock->size == N ) {
-                prevBlock->next = curBlock->next;
-            } else {
-                FreeBlock* newBlock = (FreeBlock*)((char*)curBlock + N);
-                newBlock->size = curBlock->size - N;
-                newBlock->next = curBlock->next;
-                prevBlock->next = newBlock;
-            }
-        }
+    removeFree(block);
+    split(block, blockSize);
+    markUsed(block, true);
 
-        nDescriptors++;
-        *((void**)new_desc) = (void*)((char**)curBlock);
-        if( enlargeTable ) {
-            // find the last free block
-            FreeBlock* lastBlock = freeBlocksHead;
-            while( lastBlock->next != nullptr )
-            lastBlock = lastBlock->next;
-            // decrease last block size by size of one descriptor
-            lastBlock->size -= sizeof(void*);
-        }
-        // return Pointer containing pointer to descriptor inside
-        return Pointer((void**)new_desc);
-    }
+    block->descriptor = desc;
+    *desc = payload(block);
+    return Pointer(desc);
 }
 
 /**
@@ -132,123 +79,54 @@ Pointer Simple::alloc(size_t N) {
  */
 void Simple::realloc(Pointer &p, size_t N)
 {
-    void* block_start = p.get();
-    if( block_start == nullptr )
-    {
-        // realloc from epty is just an alloc
+    if( p.get() == nullptr ) {
+        // realloc from empty is just an alloc
         p = alloc(N);
         return;
     }
-    void* block_end = nullptr;
-    FreeBlock* prevprevBlock = nullptr;
-    FreeBlock* prevBlock = nullptr;
-    FreeBlock* curBlock = freeBlocksHead;
-    // find free block before the block pointed by p
-    while( curBlock != nullptr )
-    {
-		if( (char*)curBlock >= (char*)block_start )
-            break;
-        prevprevBlock = prevBlock;
-		prevBlock = curBlock;
-		curBlock = curBlock->next;
-    }
-    // now we know that p is between prevBlock and curBlock
-    // check if there are occupied blocks between them
-    void* desc = descriptor;
-    void* occupiedBefore = (void*)prevBlock; //nullptr;
-    void* occupiedAfter = (void*)curBlock; //nullptr;
-    void* pdesc = nullptr;
-    for(int i = 0; i < nDescriptors; ++i)
-    {
-        if( occupiedBefore < (char*)(*(void**)desc)
-            && (char*)(*(void**)desc) < (char*)block_start ) {
-            occupiedBefore = *(void**)desc;
-        } else if( (char*)block_start < (char*)(*(void**)desc) 
-            && (char*)(*(void**)desc) < occupiedAfter ) {
-            occupiedAfter = *(void**)desc;
-        }
-        if( *(void**)desc == p.get() )
-            pdesc = desc;  // BTW find descriptor with which we are going to work
-        desc = (void*)((char*)desc - sizeof(void*));
+
+    if( N < sizeof(FreeLinks) )
+        N = sizeof(FreeLinks);
+    size_t blockSize = sizeof(Block) + ((N + 7) & ~size_t(7));
+
+    Block *block = blockOf(p.get());
+    size_t oldSize = sizeOf(block);
+    if( blockSize <= oldSize ) {
+        // shrink, tail is given back right away
+        split(block, blockSize);
+        return;
     }
-    block_end = occupiedAfter ? occupiedAfter : (void*)((char*)base + size - nDescriptors * sizeof(void*));
-    size_t occupiedSize = (char*)block_end - (char*)block_start;
-    if( N < occupiedSize )  // shrink block
-    {
-        if( occupiedAfter == (void*)curBlock ) {
-            // if the next block is free, expand it to the left
-            size_t blockSize = curBlock->size;
-            FreeBlock* nextBlock = curBlock->next;
-            curBlock = (FreeBlock*)((char*)curBlock - occupiedSize + N);
-            curBlock->next = nextBlock;
-            curBlock->size = blockSize + occupiedSize - N;
-            if( prevBlock)
-                prevBlock->next = curBlock;
-            else
-                freeBlocksHead = curBlock;
-        } else {
-            // if the next block is occupied, add new free block
-            FreeBlock* newBlock = (FreeBlock*)((char*)block_start + N);
-            newBlock->size = occupiedSize - N;
-            if( prevBlock ) {
-                newBlock->next = prevBlock->next;
-                prevBlock->next = newBlock;
-            } else {
-                newBlock->next = freeBlocksHead;
-                freeBlocksHead = newBlock;
-            }
-        }
-    } else {
-        // try to expand memory
-        size_t availN = 0;
-        bool availAfter = occupiedAfter == (void*)curBlock;
-        bool availBefore = occupiedBefore == (void*)prevBlock;
-        if( occupiedBefore && occupiedBefore == (void*)prevBlock )
-            availN += prevBlock->size * availBefore;
-        if( occupiedAfter && occupiedAfter == (void*)curBlock )
-            availN += curBlock->size * availAfter;
-        if( availN > N ) {
-            bool flag = true;  // is it needed to move memory backward
-            size_t dSize = 0;
-            if( availAfter ) {
-                // resize forward
-                flag = curBlock->size < N - occupiedSize;
-                dSize = flag ? curBlock->size : N - occupiedSize;
-                FreeBlock* nextBlock = curBlock->next;
-                size_t blockSize = curBlock->size;
-                if( !flag ) {
-                    curBlock = (FreeBlock*)((char*)curBlock + dSize);
-                    curBlock->size = blockSize - N + dSize;
-                    curBlock->next = nextBlock;
-                    if( prevBlock )
-                        prevBlock->next = curBlock;
-                    else
-                        freeBlocksHead = curBlock;
-                } else {
-                    // delete curBlock completely
-                    if( prevBlock )
-                        prevBlock->next = nextBlock;
-                    else
-                        freeBlocksHead = nextBlock;
-                }
-            }
-            if( availBefore && flag ) {
-                // move allocated memory backward
-                size_t dSize_1 = N - occupiedSize - dSize;
-                prevBlock->size -= dSize_1;
-                void* old_start = block_start;
-                block_start = memmove((char*)prevBlock + prevBlock->size - dSize_1, block_start, occupiedSize + dSize);
-                // update descriptor
-                updateDescriptor(old_start, block_start);
-            }
-        } else {
-            Pointer p_dest = alloc(N);
-            memcpy(p_dest.get(), p.get(), occupiedSize);
-            free(p);
-            p = p_dest;
-        }
+
+    // try to grow into the next block
+    Block *after = next(block);
+    if( after != nullptr && !(after->size & UsedFlag) && oldSize + sizeOf(after) >= blockSize ) {
+        removeFree(after);
+        block->size += sizeOf(after);
+        if( after == _last )
+            _last = block;
+        if( after == _cursor )
+            _cursor = block;
+        if( next(block) != nullptr )
+            next(block)->size &= ~PrevFreeFlag;
+        split(block, blockSize);
+        return;
     }
-    return;
+
+    // move to another place, descriptor stays the same so all copies of pointer remain valid
+    Block *moved = findFree(blockSize);
+    if( moved == nullptr )
+        throw AllocError(AllocErrorType::NoMemory, "No memory");
+
+    removeFree(moved);
+    split(moved, blockSize);
+    markUsed(moved, true);
+    std::memcpy(payload(moved), payload(block), oldSize - sizeof(Block));
+
+    moved->descriptor = block->descriptor;
+    *moved->descriptor = payload(moved);
+
+    markUsed(block, false);
+    insertFree(merge(block));
 }
 
 /**
@@ -256,130 +134,125 @@ void Simple::realloc(Pointer &p, size_t N)
  */
 void Simple::free(Pointer &p)
 {
-    void* block_start = p.get();
-    if( block_start == nullptr )
+    void* ptr = p.get();
+    if( ptr == nullptr )
         return;
 
-    void* block_end = nullptr;
-    // loop over all blocks and merge with existing free blocks
-    FreeBlock* prevBlock = nullptr;
-    FreeBlock* curBlock = freeBlocksHead;
-    // find free block before the block pointed by p
-    while( curBlock != nullptr )
-    {
-		if( (char*)curBlock >= (char*)block_start )
-    		break;
-		prevBlock = curBlock;
-		curBlock = curBlock->next;
-    }
-    // now we know that p is between prevBlock and curBlock
-    // check if there are occupied blocks between them
-    void* desc = descriptor;
-    void* occupiedBefore = nullptr;
-    void* occupiedAfter = nullptr;
-    void* pdesc = nullptr;
-    for(int i = 0; i < nDescriptors; ++i)
+    Block *block = blockOf(ptr);
+    void **desc = block->descriptor;
+
+    markUsed(block, false);
+    insertFree(merge(block));
+
+    putDescriptor(desc);
+    p = Pointer();
+}
+
+/**
+ */
+void Simple::defrag()
+{
+    // slide all used blocks to the start of memory, free blocks are just dropped
+    char *dst = _base;
+    Block *lastUsed = nullptr;
+    Block *block = reinterpret_cast<Block *>(_base);
+    while( block != nullptr )
     {
-        if( (occupiedBefore != nullptr ? occupiedBefore : (char*)prevBlock) < (char*)(*(void**)desc)
-            && (char*)(*(void**)desc) < (char*)block_start ) {
-            occupiedBefore = *(void**)desc;
-        } else if( (char*)block_start < (char*)(*(void**)desc) 
-            && (char*)(*(void**)desc) < (occupiedAfter != nullptr ? occupiedAfter : (char*)curBlock) ) {
-            occupiedAfter = *(void**)desc;
-            block_end = occupiedAfter;
+        Block *following = next(block);
+        if( block->size & UsedFlag ) {
+            size_t blockSize = sizeOf(block);
+            if( reinterpret_cast<char *>(block) != dst )
+                memmove(dst, block, blockSize);
+
+            lastUsed = reinterpret_cast<Block *>(dst);
+            lastUsed->size = blockSize | UsedFlag;
+            *lastUsed->descriptor = payload(lastUsed);
+            dst += blockSize;
         }
-        if( *(void**)desc == p.get() )
-            pdesc = desc;  // BTW find descriptor with which we are going to work
-        desc = (void*)((char*)desc - sizeof(void*));
+        block = following;
     }
 
+    _first_bitmap = 0;
+    for(size_t fl = 0; fl < FirstLevels; ++fl) {
+        _second_bitmap[fl] = 0;
+        for(size_t sl = 0; sl < SecondLevels; ++sl)
+            _lists[fl][sl] = nullptr;
+    }
 
-    // now we know which blocks surrond the block pointed by p
-    // we should either merge it with free blocks or mark as new free block
-    bool mergeBefore = (prevBlock != nullptr) && (occupiedBefore == nullptr);
-    bool mergeAfter = (curBlock != nullptr) && (occupiedAfter == nullptr);
-    if( mergeBefore && mergeAfter ) {
-        // this block is among two free ones
-        prevBlock->next = curBlock->next;
-        prevBlock->size = prevBlock->size + ((char*)curBlock - (char*)block_start) + curBlock->size;
-    } else if( mergeBefore ) {
-        // enlarge prevBlock until occupiedAfter
-        prevBlock->size = prevBlock->size + ((char*)curBlock - (char*)block_start);
-    } else if( mergeAfter ) {
-       size_t newSize = curBlock->size + ((char*)curBlock - (char*)block_start);
-       FreeBlock* curBlockNext = curBlock->next;
-       curBlock = (FreeBlock*)block_start;
-       curBlock->size = newSize;
-       curBlock->next = curBlockNext;
+    // everything else is a single free block, too small tail is attached to the last used block
+    size_t rest = reinterpret_cast<char *>(_table) - dst;
+    if( rest >= sizeof(Block) + sizeof(FreeLinks) || lastUsed == nullptr ) {
+        _last = reinterpret_cast<Block *>(dst);
+        _last->prev_size = 0;
+        _last->size = rest;
+        insertFree(_last);
     } else {
-        // mark this block as free and paste into freelist
-        FreeBlock* newBlock = (FreeBlock*)block_start;
-        newBlock->size = (block_end == nullptr) ?
-            (char*)base + size - nDescriptors*sizeof(void*) - (char*)block_start
-            : (char*)block_end - (char*)block_start;
-        newBlock->next = curBlock;
-        if( prevBlock != nullptr ) {
-            prevBlock->next = newBlock;
-        } else {
-            freeBlocksHead = newBlock;
-        }
+        lastUsed->size += rest;
+        _last = lastUsed;
     }
-    // delete corresponding descriptor
-    *(void**)pdesc = nullptr;
-    // if it was the last descriptor, shrink table
-    if( pdesc == (void*)((char*)descriptor - (nDescriptors - 1) * sizeof(void*)) )
-        nDescriptors--;
-    // otherwise just mark place as free, length of the table doesn't change
+    _cursor = reinterpret_cast<Block *>(_base);
 }
 
-/**
- */
-void Simple::defrag()
+// Free block found at the cursor swaps places with the used block that follows it, so free space
+// bubbles up to the end of area one block at a time. Each move changes a constant number of list
+// entries. Used blocks skipped are accounted as header size
+bool Simple::defragStep(size_t max_bytes, std::chrono::nanoseconds max_time)
 {
-    // loop over all free blocks and swap them with consequent occupied
-    FreeBlock* curBlock = freeBlocksHead;
-    while( curBlock->next != nullptr )
+    auto deadline = std::chrono::steady_clock::now() + max_time;
+    size_t work = 0;
+
+    Block *block = _cursor;
+    while( true )
     {
-        void* occupiedAfter = (void*)((char*)curBlock + curBlock->size);
-        if( occupiedAfter == (void*)(curBlock->next) ){
-            // all data moved, need to merge free blocks
-            curBlock->size += curBlock->next->size;
-            curBlock->next = curBlock->next->next;
+        if( work > 0 && max_time.count() > 0 && std::chrono::steady_clock::now() >= deadline ) {
+            _cursor = block;
+            return true;
+        }
+
+        if( block->size & UsedFlag ) {
+            block = next(block);
+            if( block == nullptr )
+                break;
+            work += sizeof(Block);
             continue;
-        } else {
-            // find corresponding descriptor and occupied block size
-            void* desc = descriptor;
-            for(int i = 0; i < nDescriptors; ++i) {
-                if( *(void**)desc == occupiedAfter ) {
-                    break;
-                } else {
-                    desc = (void*)((char*)desc - sizeof(void*));
-                }
-            }
-            void* next = curBlock->next == nullptr ? (void*)((char*)base + size) : curBlock->next; // either free or occupied block, which goes after this block
-            void* temp_desc = descriptor;
-            for(int i = 0; i < nDescriptors; ++i) {
-                if( *(void**)temp_desc != nullptr
-                        && *(void**)temp_desc < (void*)next
-                        && *(void**)temp_desc > occupiedAfter )
-                    next = *(void**)temp_desc;
-                    temp_desc = (void*)((char*)temp_desc - sizeof(void*));
-            }
-            size_t occupiedSize = (char*)next - (char*)occupiedAfter;
-            // store in local memory parameters of free block
-            FreeBlock* nextBlock = curBlock->next;
-            size_t blockSize = curBlock->size;
-            // memmove ocupied data
-            occupiedAfter = memcpy((void*)curBlock, occupiedAfter, occupiedSize);
-            // store new values in descriptor
-            *((void**)desc) = occupiedAfter;
-            // re-create FreeBlock at new location
-            curBlock = (FreeBlock*)((char*)occupiedAfter + occupiedSize);
-            curBlock->size = blockSize;
-            curBlock->next = nextBlock;
-            freeBlocksHead = curBlock;
+        }
+
+        Block *used = next(block);
+        if( used == nullptr )
+            break;
+
+        size_t usedSize = sizeOf(used);
+        if( work > 0 && work + usedSize > max_bytes ) {
+            _cursor = block;
+            return true;
+        }
+
+        size_t freeSize = sizeOf(block);
+        removeFree(block);
+        memmove(block, used, usedSize);
+
+        // prev of the free block is always used, so none of both has PrevFree flag
+        Block *moved = block;
+        moved->size = usedSize | UsedFlag;
+        *moved->descriptor = payload(moved);
+
+        block = reinterpret_cast<Block *>(reinterpret_cast<char *>(moved) + usedSize);
+        block->size = freeSize;
+        if( used == _last )
+            _last = block;
+        block = merge(block);
+        insertFree(block);
+
+        work += usedSize;
+        if( work >= max_bytes ) {
+            _cursor = block;
+            return true;
         }
     }
+
+    // pass is finished, the next one starts over to collect holes made meanwhile
+    _cursor = reinterpret_cast<Block *>(_base);
+    return false;
 }
 
 /**
@@ -387,18 +260,183 @@ void Simple::defrag()
  */
 std::string Simple::dump() const { return ""; }
 
-void Simple::updateDescriptor(void* old_ptr, void* new_ptr)
+Simple::Block *Simple::next(Block *block) const
 {
-    // make descriptro which pointed on old_ptr point on new_ptr
-    void* desc = descriptor;
-    for(int i = 0; i < nDescriptors; ++i) {
-        if( *(void**)desc == old_ptr ) {
-            break;
-        } else {
-            desc = (void*)((char*)desc - sizeof(void*));
+    char *following = reinterpret_cast<char *>(block) + sizeOf(block);
+    return following < reinterpret_cast<char *>(_table) ? reinterpret_cast<Block *>(following) : nullptr;
+}
+
+// Two level index: first level is power of 2 the size falls into, second one divides that range
+// into equal parts
+void Simple::mapping(size_t size, size_t &fl, size_t &sl)
+{
+    fl = highestBit(size);
+    sl = (size >> (fl - SecondBits)) & (SecondLevels - 1);
+}
+
+void Simple::insertFree(Block *block)
+{
+    size_t fl, sl;
+    mapping(sizeOf(block), fl, sl);
+
+    FreeLinks *l = links(block);
+    l->prev = nullptr;
+    l->next = _lists[fl][sl];
+    if( l->next != nullptr )
+        links(l->next)->prev = block;
+    _lists[fl][sl] = block;
+
+    _first_bitmap |= size_t(1) << fl;
+    _second_bitmap[fl] |= size_t(1) << sl;
+}
+
+void Simple::removeFree(Block *block)
+{
+    size_t fl, sl;
+    mapping(sizeOf(block), fl, sl);
+
+    FreeLinks *l = links(block);
+    if( l->prev != nullptr )
+        links(l->prev)->next = l->next;
+    else
+        _lists[fl][sl] = l->next;
+    if( l->next != nullptr )
+        links(l->next)->prev = l->prev;
+
+    if( _lists[fl][sl] == nullptr ) {
+        _second_bitmap[fl] &= ~(size_t(1) << sl);
+        if( _second_bitmap[fl] == 0 )
+            _first_bitmap &= ~(size_t(1) << fl);
+    }
+}
+
+// Size is rounded up to the next class, so any block of the found list fits without search.
+// Only if there is no such block the list of the exact class is scanned
+Simple::Block *Simple::findFree(size_t size)
+{
+    size_t fl, sl;
+    mapping(size + (size_t(1) << (highestBit(size) - SecondBits)) - 1, fl, sl);
+
+    size_t second = _second_bitmap[fl] & (~size_t(0) << sl);
+    if( second == 0 ) {
+        size_t first = fl + 1 < FirstLevels ? _first_bitmap & (~size_t(0) << (fl + 1)) : 0;
+        if( first != 0 ) {
+            fl = lowestBit(first);
+            second = _second_bitmap[fl];
+        }
+    }
+    if( second != 0 )
+        return _lists[fl][lowestBit(second)];
+
+    mapping(size, fl, sl);
+    for(Block *block = _lists[fl][sl]; block != nullptr; block = links(block)->next) {
+        if( sizeOf(block) >= size )
+            return block;
+    }
+    return nullptr;
+}
+
+// Cuts tail of the block that is used or about to be used, the tail is merged with the next block if it is free
+void Simple::split(Block *block, size_t size)
+{
+    size_t blockSize = sizeOf(block);
+    if( blockSize - size < sizeof(Block) + sizeof(FreeLinks) )
+        return;
+
+    block->size -= blockSize - size;
+
+    Block *rest = reinterpret_cast<Block *>(reinterpret_cast<char *>(block) + size);
+    rest->size = blockSize - size;
+    if( block == _last )
+        _last = rest;
+
+    insertFree(merge(rest));
+}
+
+// Merges free block that is not in lists with its free neighbours, returns resulting block
+Simple::Block *Simple::merge(Block *block)
+{
+    if( block->size & PrevFreeFlag ) {
+        Block *before = reinterpret_cast<Block *>(reinterpret_cast<char *>(block) - block->prev_size);
+        removeFree(before);
+        before->size += sizeOf(block);
+        if( block == _last )
+            _last = before;
+        if( block == _cursor )
+            _cursor = before;
+        block = before;
+    }
+
+    Block *after = next(block);
+    if( after != nullptr && !(after->size & UsedFlag) ) {
+        removeFree(after);
+        block->size += sizeOf(after);
+        if( after == _last )
+            _last = block;
+        if( after == _cursor )
+            _cursor = block;
+    }
+
+    after = next(block);
+    if( after != nullptr ) {
+        after->size |= PrevFreeFlag;
+        after->prev_size = sizeOf(block);
+    }
+    return block;
+}
+
+void Simple::markUsed(Block *block, bool used)
+{
+    Block *after = next(block);
+    if( used ) {
+        block->size |= UsedFlag;
+        if( after != nullptr )
+            after->size &= ~PrevFreeFlag;
+    } else {
+        block->size &= ~UsedFlag;
+        if( after != nullptr ) {
+            after->size |= PrevFreeFlag;
+            after->prev_size = sizeOf(block);
         }
     }
-    *(void**)desc = new_ptr;
+}
+
+void **Simple::takeDescriptor()
+{
+    if( _free_descriptors == nullptr && !growTable() ) {
+        // the last block is used, compact memory to move free space under the table
+        if( _defrag_budget == 0 )
+            defrag();
+        else
+            defragStep(_defrag_budget);
+        if( !growTable() )
+            throw AllocError(AllocErrorType::NoMemory, "No memory");
+    }
+
+    void **desc = _free_descriptors;
+    _free_descriptors = reinterpret_cast<void **>(reinterpret_cast<uintptr_t>(*desc) & ~FreeDescriptorTag);
+    return desc;
+}
+
+void Simple::putDescriptor(void **desc)
+{
+    *desc = reinterpret_cast<void *>(reinterpret_cast<uintptr_t>(_free_descriptors) | FreeDescriptorTag);
+    _free_descriptors = desc;
+}
+
+// Table grows down by one descriptor taken from the last block, if it is free and large enough
+bool Simple::growTable()
+{
+    if( (_last->size & UsedFlag) || sizeOf(_last) < sizeof(Block) + sizeof(FreeLinks) + sizeof(void *) )
+        return false;
+
+    removeFree(_last);
+    _last->size -= sizeof(void *);
+    _table--;
+    insertFree(_last);
+
+    putDescriptor(_table);
+    return true;
 }
 
 } // namespace Allocator
@@ -0,0 +1,289 @@
+#include <afina/allocator/Slab.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <new>
+
+namespace Afina {
+namespace Allocator {
+
+// See Slab.h
+SlabCache::SlabCache(size_t slab_size, size_t quota)
+    : _slab_size(slab_size), _quota(quota), _total(0), _used(0), _free(nullptr) {}
+
+// Slabs still used by pools are not tracked, pools must be destroyed before the cache
+// See Slab.h
+SlabCache::~SlabCache() { Trim(); }
+
+// See Slab.h
+void *SlabCache::Get() {
+    void *slab = _free;
+    if (slab != nullptr) {
+        _free = *static_cast<void **>(slab);
+    } else {
+        if (!Fits(_slab_size) || posix_memalign(&slab, _slab_size, _slab_size) != 0) {
+            return nullptr;
+        }
+        _total += _slab_size;
+    }
+
+    _used += _slab_size;
+    return slab;
+}
+
+// See Slab.h
+void SlabCache::Put(void *slab) {
+    *static_cast<void **>(slab) = _free;
+    _free = slab;
+    _used -= _slab_size;
+}
+
+// See Slab.h
+void *SlabCache::AllocLarge(size_t size) {
+    if (!Fits(size)) {
+        Trim();
+        if (!Fits(size)) {
+            return nullptr;
+        }
+    }
+
+    void *ptr = std::malloc(size);
+    if (ptr == nullptr) {
+        return nullptr;
+    }
+
+    _total += size;
+    _used += size;
+    return ptr;
+}
+
+// See Slab.h
+void SlabCache::FreeLarge(void *ptr, size_t size) {
+    std::free(ptr);
+    _total -= size;
+    _used -= size;
+}
+
+// See Slab.h
+void SlabCache::Trim() {
+    while (_free != nullptr) {
+        void *slab = _free;
+        _free = *static_cast<void **>(slab);
+        std::free(slab);
+        _total -= _slab_size;
+    }
+}
+
+// Number of objects is chosen so that header, bitmap and objects all fit into the slab
+// See Slab.h
+Mempool::Mempool(SlabCache &cache, size_t object_size)
+    : _cache(cache), _object_size(object_size), _slabs(0), _used(0), _partial(nullptr), _full(nullptr) {
+    size_t space = cache.SlabSize() - sizeof(Slab);
+    _objects_per_slab = space * 8 / (object_size * 8 + 1) + 1;
+    do {
+        _objects_per_slab--;
+        size_t words = (_objects_per_slab + 63) / 64;
+        _offset = (sizeof(Slab) + words * sizeof(uint64_t) + 15) & ~size_t(15);
+    } while (_offset + _objects_per_slab * object_size > cache.SlabSize());
+}
+
+// See Slab.h
+Mempool::~Mempool() {
+    for (Slab *list : {_partial, _full}) {
+        while (list != nullptr) {
+            Slab *next = list->next;
+            _cache.Put(list);
+            list = next;
+        }
+    }
+}
+
+// New slab is initialized lazily: objects are taken from its untouched tail, so slab memory is
+// touched only when really used
+// See Slab.h
+void *Mempool::Alloc() {
+    if (_partial == nullptr) {
+        void *memory = _cache.Get();
+        if (memory == nullptr) {
+            return nullptr;
+        }
+
+        Slab *slab = new (memory) Slab;
+        slab->pool = this;
+        slab->free = nullptr;
+        slab->untouched = _objects_per_slab;
+        slab->used = 0;
+        std::memset(slab->bitmap(), 0, (_objects_per_slab + 63) / 64 * sizeof(uint64_t));
+
+        Link(_partial, slab);
+        _slabs++;
+    }
+
+    Slab *slab = _partial;
+    void *ptr;
+    if (slab->free != nullptr) {
+        ptr = slab->free;
+        slab->free = *static_cast<void **>(ptr);
+    } else {
+        ptr = ObjectAt(slab, _objects_per_slab - slab->untouched);
+        slab->untouched--;
+    }
+
+    size_t i = IndexOf(slab, ptr);
+    slab->bitmap()[i / 64] |= uint64_t(1) << (i % 64);
+    slab->used++;
+    _used++;
+
+    if (slab->used == _objects_per_slab) {
+        Unlink(_partial, slab);
+        Link(_full, slab);
+    }
+    return ptr;
+}
+
+// See Slab.h
+void Mempool::Free(void *ptr) {
+    Slab *slab = SlabOf(ptr);
+    size_t i = IndexOf(slab, ptr);
+    slab->bitmap()[i / 64] &= ~(uint64_t(1) << (i % 64));
+
+    *static_cast<void **>(ptr) = slab->free;
+    slab->free = ptr;
+
+    if (slab->used == _objects_per_slab) {
+        Unlink(_full, slab);
+        Link(_partial, slab);
+    }
+    slab->used--;
+    _used--;
+
+    if (slab->used == 0) {
+        Unlink(_partial, slab);
+        _cache.Put(slab);
+        _slabs--;
+    }
+}
+
+// See Slab.h
+Mempool::Slab *Mempool::Sparsest() const {
+    Slab *result = nullptr;
+    for (Slab *slab = _partial; slab != nullptr; slab = slab->next) {
+        if (result == nullptr || slab->used < result->used) {
+            result = slab;
+        }
+    }
+    return result;
+}
+
+// See Slab.h
+void Mempool::Objects(Slab *slab, std::vector<void *> &out) const {
+    uint64_t *bitmap = slab->bitmap();
+    for (size_t w = 0; w * 64 < _objects_per_slab; w++) {
+        for (uint64_t bits = bitmap[w]; bits != 0; bits &= bits - 1) {
+            out.push_back(ObjectAt(slab, w * 64 + __builtin_ctzll(bits)));
+        }
+    }
+}
+
+// See Slab.h
+void Mempool::Link(Slab *&head, Slab *slab) {
+    slab->prev = nullptr;
+    slab->next = head;
+    if (head != nullptr) {
+        head->prev = slab;
+    }
+    head = slab;
+}
+
+// See Slab.h
+void Mempool::Unlink(Slab *&head, Slab *slab) {
+    if (slab->prev != nullptr) {
+        slab->prev->next = slab->next;
+    } else {
+        head = slab->next;
+    }
+    if (slab->next != nullptr) {
+        slab->next->prev = slab->prev;
+    }
+}
+
+// Class sizes are multiple of 8 and each one is at least 8 bytes larger than previous. The largest
+// class still holds two objects per slab
+// See Slab.h
+SlabAllocator::SlabAllocator(SlabCache &cache, size_t min_size, double factor)
+    : _cache(cache), _large_count(0), _large_size(0) {
+    size_t max_size = (cache.SlabSize() - 256) / 2 & ~size_t(7);
+    for (size_t size = (min_size + 7) & ~size_t(7); size <= max_size;) {
+        _pools.push_back(new Mempool(cache, size));
+
+        size_t next = (static_cast<size_t>(size * factor) + 7) & ~size_t(7);
+        size = std::max(next, size + 8);
+    }
+}
+
+// See Slab.h
+SlabAllocator::~SlabAllocator() {
+    for (Mempool *pool : _pools) {
+        delete pool;
+    }
+}
+
+// See Slab.h
+void *SlabAllocator::Alloc(size_t size) {
+    size_t i = ClassOf(size);
+    if (i < _pools.size()) {
+        return _pools[i]->Alloc();
+    }
+
+    void *ptr = _cache.AllocLarge(size);
+    if (ptr != nullptr) {
+        _large_count++;
+        _large_size += size;
+    }
+    return ptr;
+}
+
+// See Slab.h
+void SlabAllocator::Free(void *ptr, size_t size) {
+    size_t i = ClassOf(size);
+    if (i < _pools.size()) {
+        _pools[i]->Free(ptr);
+        return;
+    }
+
+    _cache.FreeLarge(ptr, size);
+    _large_count--;
+    _large_size -= size;
+}
+
+// See Slab.h
+size_t SlabAllocator::ClassOf(size_t size) const {
+    auto it = std::lower_bound(_pools.begin(), _pools.end(), size,
+                               [](const Mempool *pool, size_t size) { return pool->ObjectSize() < size; });
+    return it - _pools.begin();
+}
+
+// See Slab.h
+size_t SlabAllocator::RealSize(size_t size) const {
+    size_t i = ClassOf(size);
+    return i < _pools.size() ? _pools[i]->ObjectSize() : size;
+}
+
+// See Slab.h
+void SlabAllocator::CollectStats(std::vector<ClassStats> &stats) const {
+    if (stats.size() < _pools.size()) {
+        stats.resize(_pools.size(), ClassStats{0, 0, 0, 0});
+    }
+
+    for (size_t i = 0; i < _pools.size(); i++) {
+        stats[i].size = _pools[i]->ObjectSize();
+        stats[i].slabs += _pools[i]->Slabs();
+        stats[i].used += _pools[i]->Used();
+        stats[i].free += _pools[i]->Available();
+    }
+}
+
+} // namespace Allocator
+} // namespace Afina
@@ -10,7 +10,17 @@ namespace Execute {
 // hold data for this key".
 void Add::Execute(Storage &storage, const std::string &args, std::string &out) {
     std::cout << "Add(" << _key << ")" << args << std::endl;
-    out = storage.PutIfAbsent(_key, args) ? "STORED" : "NOT_STORED";
+
+    // Item that is expired already is never stored, only the answer depends on the key presence
+    uint32_t ttl = 0;
+    bool stored;
+    if (TimeToLive(ttl)) {
+        stored = storage.PutIfAbsent(_key, args, ttl);
+    } else {
+        Value value;
+        stored = !storage.GetValue(_key, value);
+    }
+    out = stored ? "STORED" : "NOT_STORED";
 }
 
 } // namespace Execute
@@ -9,13 +9,11 @@ namespace Execute {
 // memcached protocol: "append" means "add this data to an existing key after existing data".
 void Append::Execute(Storage &storage, const std::string &args, std::string &out) {
     std::cout << "Append(" << _key << ")" << args << std::endl;
-    std::string value;
-    if (!storage.Get(_key, value)) {
-        out.assign("NOT_STORED");
-        return;
-    }
-    storage.Put(_key, value + args);
-    out.assign("STORED");
+    bool stored = storage.Modify(_key, [&args](std::string &value, uint32_t &ttl) {
+        value = value + args;
+        return Storage::Action::kStore;
+    });
+    out.assign(stored ? "STORED" : "NOT_STORED");
 }
 
 } // namespace Execute
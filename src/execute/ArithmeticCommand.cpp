@@ -0,0 +1,52 @@
+#include <afina/Storage.h>
+#include <afina/execute/ArithmeticCommand.h>
+
+namespace Afina {
+namespace Execute {
+
+// Strict decimal conversion, false if there is anything besides digits or value doesn't fit 64 bits
+static bool ParseValue(const std::string &text, uint64_t &value) {
+    if (text.empty()) {
+        return false;
+    }
+
+    value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+
+        uint64_t digit = c - '0';
+        if (value > (UINT64_MAX - digit) / 10) {
+            return false;
+        }
+        value = value * 10 + digit;
+    }
+    return true;
+}
+
+// See ArithmeticCommand.h
+void ArithmeticCommand::Execute(Storage &storage, const std::string &args, std::string &out) {
+    // Value is replaced under storage lock keeping its ttl, so concurrent updates are never lost
+    bool numeric = true;
+    bool found = storage.Modify(_key, [this, &numeric, &out](std::string &value, uint32_t &ttl) {
+        uint64_t number;
+        if (!ParseValue(value, number)) {
+            numeric = false;
+            return Storage::Action::kKeep;
+        }
+
+        value = std::to_string(Apply(number));
+        out = value;
+        return Storage::Action::kStore;
+    });
+
+    if (!found) {
+        out = "NOT_FOUND";
+    } else if (!numeric) {
+        out = "CLIENT_ERROR cannot increment or decrement non-numeric value";
+    }
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -0,0 +1,44 @@
+#include <afina/Storage.h>
+#include <afina/execute/Cas.h>
+
+namespace Afina {
+namespace Execute {
+
+// FNV-1a, 64 bits
+uint64_t Cas::Unique(const char *data, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// memcached protocol: "cas" is a check and set operation which means "store this data but
+// only if no one else has updated since I last fetched it."
+void Cas::Execute(Storage &storage, const std::string &args, std::string &out) {
+    // Value is compared and replaced under storage lock, so nothing could be written in between. Item that
+    // is expired already is stored and gone right away
+    uint32_t store_ttl = 0;
+    bool alive = TimeToLive(store_ttl);
+    bool changed = false;
+    bool found = storage.Modify(_key, [&](std::string &value, uint32_t &ttl) {
+        if (Unique(value.data(), value.size()) != _unique) {
+            changed = true;
+            return Storage::Action::kKeep;
+        }
+
+        value = args;
+        ttl = store_ttl;
+        return alive ? Storage::Action::kStore : Storage::Action::kRemove;
+    });
+
+    if (!found) {
+        out = "NOT_FOUND";
+    } else {
+        out = changed ? "EXISTS" : "STORED";
+    }
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -1 +1,20 @@
 #include <afina/execute/Command.h>
+#include <afina/execute/Response.h>
+
+namespace Afina {
+namespace Execute {
+
+// See Command.h
+void Command::Execute(Storage &storage, const std::string &args, Response &out) {
+    std::string result;
+    Execute(storage, args, result);
+    if (_noreply) {
+        return;
+    }
+
+    out.Append(result);
+    out.Append("\r\n", 2);
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -0,0 +1,10 @@
+#include <afina/execute/Decr.h>
+
+namespace Afina {
+namespace Execute {
+
+// memcached protocol: "decr" subtracts delta from the item value, underflow results in 0.
+uint64_t Decr::Apply(uint64_t value) const { return value < _delta ? 0 : value - _delta; }
+
+} // namespace Execute
+} // namespace Afina
@@ -1,9 +1,11 @@
 #include <afina/Storage.h>
+#include <afina/execute/Cas.h>
 #include <afina/execute/Get.h>
+#include <afina/execute/Response.h>
 
-#include <iostream>
-#include <iterator>
-#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <vector>
 
 namespace Afina {
 namespace Execute {
@@ -12,7 +14,7 @@ namespace Execute {
 
 Each item sent by the server looks like this:
 
-VALUE <key> <flags> <bytes>\r\n
+VALUE <key> <flags> <bytes> [<cas unique>]\r\n
 <data block>\r\n
 
 After all the items have been transmitted, the server sends the string
@@ -22,22 +24,53 @@ to indicate the end of response.
 */
 
 void Get::Execute(Storage &storage, const std::string &args, std::string &out) {
-    std::stringstream keyStream;
-    copy(_keys.begin(), _keys.end(), std::ostream_iterator<std::string>(keyStream, " "));
-    std::cout << "Get(" << keyStream.str() << ")" << std::endl;
+    Response response;
+    Execute(storage, args, response);
 
-    std::stringstream outStream;
+    out = response.ToString();
+    out.resize(out.size() - 2); // networking layer should add the last \r\n
+}
+
+// Writes decimal digits of the number backward, so that they end right before the given position
+static char *FormatBackward(uint64_t number, char *end) {
+    do {
+        *--end = char('0' + number % 10);
+        number /= 10;
+    } while (number != 0);
+    return end;
+}
+
+// All keys are looked up in one batch, item headers are formatted right into the response text
+void Get::Execute(Storage &storage, const std::string &args, Response &out) {
+    std::vector<Value> values;
+    storage.MultiGet(_keys, values);
 
-    std::string value;
-    for (auto &key : _keys) {
-        if (!storage.Get(key, value))
+    // Header tail " 0 <bytes> [<cas unique>]\r\n" is written from the end of the buffer
+    char tail[64];
+    char *end = tail + sizeof(tail);
+    for (size_t i = 0; i < _keys.size(); i++) {
+        const Value &value = values[i];
+        if (value.empty()) {
             continue;
-        outStream << "VALUE " << key << " 0 " << value.size() << "\r\n";
-        outStream << value << "\r\n";
-    }
-    outStream << "END"; // networking layer should add the last \r\n
+        }
+
+        char *pos = end - 2;
+        std::memcpy(pos, "\r\n", 2);
+        if (_cas) {
+            pos = FormatBackward(Cas::Unique(value.data(), value.size()), pos);
+            *--pos = ' ';
+        }
+        pos = FormatBackward(value.size(), pos);
+        pos -= 3;
+        std::memcpy(pos, " 0 ", 3);
 
-    out = outStream.str();
+        out.Append("VALUE ", 6);
+        out.Append(_keys[i]);
+        out.Append(pos, end - pos);
+        out.Append(value);
+        out.Append("\r\n", 2);
+    }
+    out.Append("END\r\n", 5);
 }
 
 } // namespace Execute
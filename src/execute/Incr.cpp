@@ -0,0 +1,10 @@
+#include <afina/execute/Incr.h>
+
+namespace Afina {
+namespace Execute {
+
+// memcached protocol: "incr" adds delta to the item value, overflow wraps around.
+uint64_t Incr::Apply(uint64_t value) const { return value + _delta; }
+
+} // namespace Execute
+} // namespace Afina
@@ -0,0 +1,31 @@
+#include <afina/execute/InsertCommand.h>
+
+#include <ctime>
+
+namespace Afina {
+namespace Execute {
+
+// memcached protocol: expiration time larger than that is treated as unix time
+static const int32_t MaxRelativeExpire = 60 * 60 * 24 * 30;
+
+// See InsertCommand.h
+bool InsertCommand::TimeToLive(int32_t expire, uint32_t &ttl) {
+    if (expire < 0) {
+        return false;
+    }
+
+    if (expire <= MaxRelativeExpire) {
+        ttl = expire;
+        return true;
+    }
+
+    time_t now = std::time(nullptr);
+    if (expire <= now) {
+        return false;
+    }
+    ttl = expire - now;
+    return true;
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -0,0 +1,17 @@
+#include <afina/Storage.h>
+#include <afina/execute/Prepend.h>
+
+namespace Afina {
+namespace Execute {
+
+// memcached protocol: "prepend" means "add this data to an existing key before existing data".
+void Prepend::Execute(Storage &storage, const std::string &args, std::string &out) {
+    bool stored = storage.Modify(_key, [&args](std::string &value, uint32_t &ttl) {
+        value = args + value;
+        return Storage::Action::kStore;
+    });
+    out.assign(stored ? "STORED" : "NOT_STORED");
+}
+
+} // namespace Execute
+} // namespace Afina
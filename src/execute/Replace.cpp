@@ -11,13 +11,11 @@ namespace Execute {
 
 void Replace::Execute(Storage &storage, const std::string &args, std::string &out) {
     std::cout << "Replace(" << _key << "): " << args << std::endl;
-    std::string value;
-    if (storage.Get(_key, value)) {
-        storage.Set(_key, args);
-        out = "STORED";
-    } else {
-        out = "NOT_STORED";
-    }
+
+    // Item that is expired already replaces the existing one by removing it
+    uint32_t ttl = 0;
+    bool stored = TimeToLive(ttl) ? storage.Set(_key, args, ttl) : storage.Delete(_key);
+    out = stored ? "STORED" : "NOT_STORED";
 }
 
 } // namespace Execute
@@ -0,0 +1,65 @@
+#include <afina/execute/Response.h>
+
+namespace Afina {
+namespace Execute {
+
+// Consecutive text appends are merged into a single chunk
+// See Response.h
+void Response::Append(const char *data, size_t size) {
+    if (size == 0) {
+        return;
+    }
+
+    if (_chunks.empty() || !_chunks.back().value.empty()) {
+        _chunks.push_back(Part{_text.size(), 0, Value()});
+    }
+
+    _text.append(data, size);
+    _chunks.back().size += size;
+    _size += size;
+}
+
+// See Response.h
+void Response::Append(const Value &value) {
+    if (value.size() < InlineThreshold) {
+        Append(value.data(), value.size());
+        return;
+    }
+
+    _chunks.push_back(Part{0, value.size(), value});
+    _size += value.size();
+}
+
+// See Response.h
+void Response::Chunk(size_t i, const char *&data, size_t &size) const {
+    const Part &part = _chunks[i];
+    if (part.value.empty()) {
+        data = _text.data() + part.offset;
+    } else {
+        data = part.value.data();
+    }
+    size = part.size;
+}
+
+// See Response.h
+void Response::Clear() {
+    _text.clear();
+    _chunks.clear();
+    _size = 0;
+}
+
+// See Response.h
+std::string Response::ToString() const {
+    std::string result;
+    result.reserve(_size);
+    for (size_t i = 0; i < _chunks.size(); i++) {
+        const char *data;
+        size_t size;
+        Chunk(i, data, size);
+        result.append(data, size);
+    }
+    return result;
+}
+
+} // namespace Execute
+} // namespace Afina
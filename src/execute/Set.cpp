@@ -9,7 +9,14 @@ namespace Execute {
 // memcached protocol: "set" means "store this data".
 void Set::Execute(Storage &storage, const std::string &args, std::string &out) {
     std::cout << "Set(" << _key << "): " << args << std::endl;
-    storage.Put(_key, args);
+
+    // Item that is expired already is stored and gone right away
+    uint32_t ttl = 0;
+    if (TimeToLive(ttl)) {
+        storage.Put(_key, args, ttl);
+    } else {
+        storage.Delete(_key);
+    }
     out = "STORED";
 }
 
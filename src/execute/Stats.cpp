@@ -3,12 +3,63 @@
 
 #include <iostream>
 #include <iterator>
+#include <mutex>
 #include <sstream>
 
 namespace Afina {
 namespace Execute {
 
-void Stats::Execute(Storage &storage, const std::string &args, std::string &out) { out.assign("END"); }
+// Sources are called under the mutex, so source being removed is never called concurrently
+static std::mutex &SourcesMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+static std::vector<std::pair<size_t, Stats::Source>> &Sources() {
+    static std::vector<std::pair<size_t, Stats::Source>> sources;
+    return sources;
+}
+
+// See Stats.h
+size_t Stats::AddSource(Source source) {
+    static size_t last_id = 0;
+    std::lock_guard<std::mutex> lock(SourcesMutex());
+    Sources().emplace_back(++last_id, std::move(source));
+    return last_id;
+}
+
+// See Stats.h
+void Stats::RemoveSource(size_t id) {
+    std::lock_guard<std::mutex> lock(SourcesMutex());
+    auto &sources = Sources();
+    for (auto it = sources.begin(); it != sources.end(); it++) {
+        if (it->first == id) {
+            sources.erase(it);
+            break;
+        }
+    }
+}
+
+// memcached protocol: each statistic is sent as "STAT <name> <value>\r\n", after all of them
+// server sends "END\r\n"
+void Stats::Execute(Storage &storage, const std::string &args, std::string &out) {
+    std::vector<std::pair<std::string, std::string>> stats;
+    storage.CollectStats(stats);
+    {
+        std::lock_guard<std::mutex> lock(SourcesMutex());
+        for (auto &source : Sources()) {
+            source.second(stats);
+        }
+    }
+
+    std::stringstream outStream;
+    for (auto &stat : stats) {
+        outStream << "STAT " << stat.first << " " << stat.second << "\r\n";
+    }
+    outStream << "END"; // networking layer should add the last \r\n
+
+    out = outStream.str();
+}
 
 } // namespace Execute
 } // namespace Afina
@@ -0,0 +1,22 @@
+#include <afina/Storage.h>
+#include <afina/execute/InsertCommand.h>
+#include <afina/execute/Touch.h>
+
+namespace Afina {
+namespace Execute {
+
+// memcached protocol: "touch" is used to update the expiration time of an existing item without
+// fetching it.
+void Touch::Execute(Storage &storage, const std::string &args, std::string &out) {
+    // Item touched with the time in the past is gone right away
+    uint32_t expire_ttl = 0;
+    bool alive = InsertCommand::TimeToLive(_expire, expire_ttl);
+    bool touched = storage.Modify(_key, [alive, expire_ttl](std::string &value, uint32_t &ttl) {
+        ttl = expire_ttl;
+        return alive ? Storage::Action::kStore : Storage::Action::kRemove;
+    });
+    out = touched ? "TOUCHED" : "NOT_FOUND";
+}
+
+} // namespace Execute
+} // namespace Afina
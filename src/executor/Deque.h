@@ -0,0 +1,148 @@
+#ifndef AFINA_EXECUTOR_DEQUE_H
+#define AFINA_EXECUTOR_DEQUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Afina {
+
+/**
+ * # Chase-Lev work stealing deque
+ * Owner thread pushes and pops on the bottom end without any locks, other threads steal from the top end
+ * with a single CAS. Only the last element is contended between owner and thieves.
+ *
+ * Items must be trivially copyable, pointers are expected. Buffer grows on demand, replaced buffers are kept
+ * until deque is destroyed as thieves could still read from them
+ */
+template <typename T> class WorkStealingDeque {
+public:
+    WorkStealingDeque(size_t capacity = 256) : _top(0), _bottom(0) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        _buffers.push_back(new Buffer(size));
+        _buffer.store(_buffers.back(), std::memory_order_relaxed);
+    }
+
+    ~WorkStealingDeque() {
+        for (auto buffer : _buffers) {
+            delete buffer;
+        }
+    }
+
+    /**
+     * Called by owner only
+     */
+    void Push(T item) {
+        int64_t bottom = _bottom.load(std::memory_order_relaxed);
+        int64_t top = _top.load(std::memory_order_acquire);
+        Buffer *buffer = _buffer.load(std::memory_order_relaxed);
+        if (bottom - top >= int64_t(buffer->capacity)) {
+            buffer = Grow(buffer, top, bottom);
+        }
+
+        buffer->Put(bottom, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        _bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Called by owner only, takes the most recently pushed item. Returns false if deque is empty
+     */
+    bool Pop(T &item) {
+        int64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+        Buffer *buffer = _buffer.load(std::memory_order_relaxed);
+        _bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        int64_t top = _top.load(std::memory_order_relaxed);
+        if (top > bottom) {
+            _bottom.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        item = buffer->Get(bottom);
+        if (top == bottom) {
+            // Last item, race with thieves for it
+            bool won = _top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                                    std::memory_order_relaxed);
+            _bottom.store(bottom + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    /**
+     * Could be called by any thread, takes the oldest item. Returns false if deque is empty or
+     * another thread took the item first
+     */
+    bool Steal(T &item) {
+        int64_t top = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = _bottom.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return false;
+        }
+
+        Buffer *buffer = _buffer.load(std::memory_order_acquire);
+        item = buffer->Get(top);
+        return _top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    /**
+     * Approximate number of items, exact if called by owner while nobody steals
+     */
+    size_t Size() const {
+        int64_t bottom = _bottom.load(std::memory_order_relaxed);
+        int64_t top = _top.load(std::memory_order_relaxed);
+        return bottom > top ? size_t(bottom - top) : 0;
+    }
+
+private:
+    WorkStealingDeque(const WorkStealingDeque &);            // = delete;
+    WorkStealingDeque &operator=(const WorkStealingDeque &); // = delete;
+
+    /**
+     * Circular array, indices grow monotonically and are wrapped by mask
+     */
+    struct Buffer {
+        Buffer(size_t capacity) : capacity(capacity), items(new std::atomic<T>[capacity]) {}
+        ~Buffer() { delete[] items; }
+
+        T Get(int64_t i) const { return items[i & (capacity - 1)].load(std::memory_order_relaxed); }
+        void Put(int64_t i, T item) { items[i & (capacity - 1)].store(item, std::memory_order_relaxed); }
+
+        size_t capacity;
+        std::atomic<T> *items;
+    };
+
+    /**
+     * Replaces buffer by one twice as large, called by owner only
+     */
+    Buffer *Grow(Buffer *buffer, int64_t top, int64_t bottom) {
+        Buffer *grown = new Buffer(buffer->capacity * 2);
+        for (int64_t i = top; i < bottom; i++) {
+            grown->Put(i, buffer->Get(i));
+        }
+
+        _buffers.push_back(grown);
+        _buffer.store(grown, std::memory_order_release);
+        return grown;
+    }
+
+    char _pad0[64];
+    std::atomic<int64_t> _top;
+    char _pad1[64];
+    std::atomic<int64_t> _bottom;
+    std::atomic<Buffer *> _buffer;
+
+    // All buffers ever allocated, accessed by owner only
+    std::vector<Buffer *> _buffers;
+};
+
+} // namespace Afina
+
+#endif // AFINA_EXECUTOR_DEQUE_H
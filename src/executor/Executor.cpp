@@ -1,44 +1,413 @@
 #include "../../include/afina/Executor.h"
 //#include <afina/Executor.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+
+#include "Deque.h"
+
 namespace Afina
 {
+
+// Maximum number of tasks moved from the injection queue to the own deque at once
+static const size_t InjectBatch = 32;
+
+// Number of rounds thread looks for a task before it parks
+static const size_t SpinRounds = 64;
+
+// Maximum number of spare task nodes kept by each thread
+static const size_t NodeCacheSize = 1024;
+
+// Pool thread of the work stealing executor. Deque holds pointers, so tasks pushed there live in the nodes
+// which are taken from and returned to the cache of the thread that is running, owner only touches it
+struct Executor::Worker {
+    WorkStealingDeque<Job *> deque;
+    std::vector<Job *> cache;
+};
+
+// Executor and index of the worker the current thread belongs to
+static thread_local Executor *current_executor = nullptr;
+static thread_local size_t current_index = 0;
+
+// Seed for picking steal victims
+static thread_local uint32_t steal_seed = 0;
+
+// Timestamps for metrics, nanoseconds
+static uint64_t Now() {
+    return uint64_t(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
 void perform(Executor *executor) {
+    std::unique_lock<std::mutex> lock(executor->mutex);
     while( true ) {
-        std::unique_lock<std::mutex> lock(executor->mutex);
-        while( executor->tasks.empty() && executor->state == Executor::State::kRun )
-            executor->empty_condition.wait(lock);
-
-        if( executor->tasks.empty() || executor->state == Executor::State::kStopped )
-            break;
+        if( executor->tasks.Empty() ) {
+            // Stopping pool exits once the queue is drained
+            if( executor->state != Executor::State::kRun )
+                break;
 
-        if( executor->state != Executor::State::kStopped ) {
-            std::function<void()> exec = executor->tasks.front();
-            executor->tasks.pop_front();
-            lock.unlock();
-            exec();
+            executor->idle_threads++;
+            if( executor->threads_count > executor->low_watermark ) {
+                std::cv_status status = executor->empty_condition.wait_for(lock, executor->idle_time);
+                executor->idle_threads--;
+                if( status == std::cv_status::timeout && executor->tasks.Empty() &&
+                    executor->threads_count > executor->low_watermark )
+                    break;
+            } else {
+                executor->empty_condition.wait(lock);
+                executor->idle_threads--;
+            }
+            continue;
         }
+
+        Executor::Job job = executor->tasks.Pop();
+        lock.unlock();
+        executor->Run(job);
+        lock.lock();
     }
+    executor->OnThreadExit();
 }
 
-Executor::Executor(std::string name, int size) {
+Executor::Executor(std::string name, int size, Mode mode)
+    : Executor(name, size_t(size), size_t(size), 0, std::chrono::milliseconds(0), mode) {}
+
+Executor::Executor(std::string name, size_t low_watermark, size_t high_watermark, size_t max_queue_size,
+                   std::chrono::milliseconds idle_time, Mode mode)
+    : mode(mode), low_watermark(low_watermark), high_watermark(std::max(high_watermark, low_watermark)),
+      max_queue_size(max_queue_size), idle_time(idle_time), threads_count(0), idle_threads(0), injected_size(0),
+      sleepers(0), queued(0), busy(0), completed(0), rejected(0), busy_time(0), thread_time(0),
+      thread_time_updated(Now()) {
     state = State::kRun;
-    for(int i = 0; i < size; ++i)
-        threads.emplace_back(perform, this);
+    if( mode == Mode::kWorkStealing ) {
+        // Deques must exist before any thread could steal from them, threads take free slots starting from 0
+        for(size_t i = 0; i < this->high_watermark; ++i)
+            workers.emplace_back(new Worker());
+        for(size_t i = this->high_watermark; i > 0; --i)
+            free_slots.push_back(i - 1);
+    }
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    for(size_t i = 0; i < low_watermark; ++i)
+        StartThread();
 }
 
-Executor::~Executor() {}
+// Threads are detached, so pool must outlive all of them
+Executor::~Executor() {
+    Stop(true);
+
+    Job *task;
+    for( auto& worker : workers ) {
+        while( worker->deque.Pop(task) )
+            delete task;
+        for( auto node : worker->cache )
+            delete node;
+    }
+}
+
+bool Executor::Submit(Task &&task) {
+    if( mode == Mode::kWorkStealing )
+        return Dispatch(std::move(task));
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    if( state != State::kRun || (max_queue_size > 0 && tasks.Size() >= max_queue_size) ) {
+        rejected++;
+        return false;
+    }
+
+    // Enqueue new task
+    Job job;
+    job.task = std::move(task);
+    job.enqueued = Now();
+    tasks.Push(std::move(job));
+    if( tasks.Size() > idle_threads )
+        StartThread();
+    empty_condition.notify_one();
+    return true;
+}
 
 void Executor::Stop(bool await) {
     std::unique_lock<std::mutex> lock(this->mutex);
-    state = State::kStopping;
+    if( state == State::kRun ) {
+        state = State::kStopping;
+        if( threads_count == 0 )
+            state = State::kStopped;
+        empty_condition.notify_all();
+    }
+
     if( await ) {
+        while( state != State::kStopped )
+            stop_condition.wait(lock);
+    }
+}
+
+void Executor::StartThread() {
+    if( threads_count >= high_watermark )
+        return;
+
+    AccountThreadTime();
+    threads_count++;
+    if( mode == Mode::kWorkStealing ) {
+        size_t slot = free_slots.back();
+        free_slots.pop_back();
+        std::thread(&Executor::RunWorker, this, slot).detach();
+    } else {
+        std::thread(perform, this).detach();
+    }
+}
+
+void Executor::OnThreadExit() {
+    AccountThreadTime();
+    threads_count--;
+    if( threads_count == 0 && state == State::kStopping ) {
         state = State::kStopped;
+        stop_condition.notify_all();
+    }
+}
+
+// Pool threads push to their own deque, everybody else goes through the injection queue
+bool Executor::Dispatch(Task &&task) {
+    if( current_executor == this ) {
+        if( state != State::kRun || (max_queue_size > 0 && queued >= max_queue_size) ) {
+            rejected++;
+            return false;
+        }
+
+        queued++;
+        Job *node = AcquireNode(current_index);
+        node->task = std::move(task);
+        node->enqueued = Now();
+        workers[current_index]->deque.Push(node);
+        if( NeedsThread() ) {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            StartThread();
+        }
+        WakeOne();
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    if( state != State::kRun || (max_queue_size > 0 && queued >= max_queue_size) ) {
+        rejected++;
+        return false;
+    }
+
+    queued++;
+    Job job;
+    job.task = std::move(task);
+    job.enqueued = Now();
+    injected.Push(std::move(job));
+    injected_size++;
+    if( NeedsThread() )
+        StartThread();
+    if( sleepers > 0 )
+        empty_condition.notify_one();
+    return true;
+}
+
+// Threads which aren't running a task are either looking for one or parked, each of them takes one task
+bool Executor::NeedsThread() const {
+    size_t running = threads_count.load();
+    size_t working = busy.load();
+    return running < high_watermark && queued.load() > (running > working ? running - working : 0);
+}
+
+// Parking thread increments sleepers and checks for work under the mutex, so either it sees the task
+// pushed or the pusher sees it parking and notifies after it started to wait
+void Executor::WakeOne() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if( sleepers.load() > 0 ) {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        empty_condition.notify_one();
     }
-    empty_condition.notify_all();
+}
+
+Executor::Job *Executor::FindTask(size_t index) {
+    Job *task = nullptr;
+    Worker &self = *workers[index];
+    if( self.deque.Pop(task) )
+        return task;
+
+    // Take a fair share of the injection queue, all but one task become available for stealing
+    if( injected_size.load() > 0 ) {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        size_t batch = std::min(InjectBatch, injected.Size() / workers.size() + 1);
+        for(size_t i = 0; i < batch && !injected.Empty(); ++i) {
+            if( task != nullptr )
+                self.deque.Push(task);
+            task = AcquireNode(index);
+            *task = injected.Pop();
+            injected_size--;
+        }
+        lock.unlock();
+
+        if( task != nullptr ) {
+            if( self.deque.Size() > 0 )
+                WakeOne();
+            return task;
+        }
+    }
+
+    // Victims are visited starting from the random one, so thieves don't pile up on the same deque
+    steal_seed = steal_seed * 1103515245 + 12345;
+    size_t start = (steal_seed >> 16) % workers.size();
+    for(size_t i = 0; i < workers.size(); ++i) {
+        size_t victim = (start + i) % workers.size();
+        if( victim != index && workers[victim]->deque.Steal(task) )
+            return task;
+    }
+    return nullptr;
+}
+
+Executor::Job *Executor::AcquireNode(size_t index) {
+    std::vector<Job *> &cache = workers[index]->cache;
+    if( cache.empty() )
+        return new Job();
+
+    Job *node = cache.back();
+    cache.pop_back();
+    return node;
+}
+
+// Thieves collect nodes of the threads they steal from, cache is bounded so that doesn't grow forever
+void Executor::ReleaseNode(size_t index, Job *node) {
+    std::vector<Job *> &cache = workers[index]->cache;
+    if( cache.size() >= NodeCacheSize ) {
+        delete node;
+        return;
+    }
+
+    node->task.Reset();
+    cache.push_back(node);
+}
+
+void Executor::Run(Job &job) {
+    busy++;
+    uint64_t start = Now();
+    wait_time.Record(start > job.enqueued ? start - job.enqueued : 0);
+
+    job.task();
+    job.task.Reset();
+
+    uint64_t finish = Now();
+    run_time.Record(finish - start);
+    busy_time += finish - start;
+    completed++;
+    busy--;
+}
+
+void Executor::AccountThreadTime() {
+    uint64_t now = Now();
+    thread_time += threads_count * (now - thread_time_updated);
+    thread_time_updated = now;
+}
+
+void Executor::GetMetrics(Metrics &metrics) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    AccountThreadTime();
+    metrics.threads = threads_count;
+    metrics.thread_time = thread_time;
+    metrics.queue_depth = mode == Mode::kWorkStealing ? queued.load() : tasks.Size();
     lock.unlock();
-    for( auto& t : threads )
-        t.join();
+
+    metrics.busy_threads = busy;
+    metrics.completed = completed;
+    metrics.rejected = rejected;
+    metrics.busy_time = busy_time;
+}
+
+// Names follow memcached "stats" command, times are in nanoseconds
+void Executor::CollectStats(std::vector<std::pair<std::string, std::string>> &stats) {
+    Metrics metrics;
+    GetMetrics(metrics);
+    stats.emplace_back("executor_threads", std::to_string(metrics.threads));
+    stats.emplace_back("executor_busy_threads", std::to_string(metrics.busy_threads));
+    stats.emplace_back("executor_queue_depth", std::to_string(metrics.queue_depth));
+    stats.emplace_back("executor_completed", std::to_string(metrics.completed));
+    stats.emplace_back("executor_rejected", std::to_string(metrics.rejected));
+    stats.emplace_back("executor_busy_time", std::to_string(metrics.busy_time));
+    stats.emplace_back("executor_thread_time", std::to_string(metrics.thread_time));
+
+    std::stringstream utilisation;
+    utilisation.precision(3);
+    utilisation << std::fixed << (metrics.thread_time > 0 ? double(metrics.busy_time) / metrics.thread_time : 0.0);
+    stats.emplace_back("executor_utilisation", utilisation.str());
+
+    const std::pair<const char *, const Histogram *> histograms[] = {{"wait", &wait_time}, {"run", &run_time}};
+    for( auto& h : histograms ) {
+        std::string prefix = std::string("executor_") + h.first + "_";
+        uint64_t count = h.second->Count();
+        stats.emplace_back(prefix + "avg", std::to_string(count > 0 ? h.second->Sum() / count : 0));
+        stats.emplace_back(prefix + "p50", std::to_string(h.second->Percentile(50)));
+        stats.emplace_back(prefix + "p90", std::to_string(h.second->Percentile(90)));
+        stats.emplace_back(prefix + "p99", std::to_string(h.second->Percentile(99)));
+        stats.emplace_back(prefix + "max", std::to_string(h.second->Max()));
+    }
+}
+
+bool Executor::HasWork() const {
+    if( injected_size.load() > 0 )
+        return true;
+    for( auto& worker : workers ) {
+        if( worker->deque.Size() > 0 )
+            return true;
+    }
+    return false;
+}
+
+void Executor::RunWorker(size_t index) {
+    current_executor = this;
+    current_index = index;
+    steal_seed = uint32_t(index) + 1;
+
+    size_t rounds = 0;
+    while( true ) {
+        Job *task = FindTask(index);
+        if( task != nullptr ) {
+            queued--;
+            Run(*task);
+            ReleaseNode(index, task);
+            rounds = 0;
+            continue;
+        }
+
+        if( ++rounds < SpinRounds ) {
+            std::this_thread::yield();
+            continue;
+        }
+        rounds = 0;
+
+        std::unique_lock<std::mutex> lock(this->mutex);
+        sleepers++;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if( HasWork() ) {
+            sleepers--;
+            continue;
+        }
+
+        // Stopping pool exits once no task is left anywhere
+        if( state != State::kRun ) {
+            sleepers--;
+            break;
+        }
+
+        // Own deque is empty and only owner pushes there, so retired slot could be handed to a new thread
+        if( threads_count > low_watermark ) {
+            std::cv_status status = empty_condition.wait_for(lock, idle_time);
+            sleepers--;
+            if( status == std::cv_status::timeout && threads_count > low_watermark && !HasWork() )
+                break;
+        } else {
+            empty_condition.wait(lock);
+            sleepers--;
+        }
+    }
+
+    current_executor = nullptr;
+    std::unique_lock<std::mutex> lock(this->mutex);
+    free_slots.push_back(index);
+    OnThreadExit();
 }
 
-} // namespace Afina
\ No newline at end of file
+} // namespace Afina
@@ -0,0 +1,70 @@
+#include <afina/executor/Histogram.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Afina
+{
+
+const size_t Histogram::SubBucketBits;
+const size_t Histogram::SubBuckets;
+const size_t Histogram::Buckets;
+
+// See Histogram.h
+Histogram::Histogram() : _count(0), _sum(0), _max(0) {
+    for( auto& bucket : _buckets )
+        bucket.store(0, std::memory_order_relaxed);
+}
+
+// See Histogram.h
+void Histogram::Record(uint64_t value) {
+    _buckets[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t max = _max.load(std::memory_order_relaxed);
+    while( value > max && !_max.compare_exchange_weak(max, value, std::memory_order_relaxed) ) {
+    }
+}
+
+// See Histogram.h
+uint64_t Histogram::Percentile(double percentile) const {
+    uint64_t count = Count();
+    if( count == 0 )
+        return 0;
+
+    // Buckets are read one by one while writers go on, so rank is clamped by what was actually seen
+    uint64_t rank = uint64_t(std::ceil(count * percentile / 100.0));
+    if( rank == 0 )
+        rank = 1;
+
+    uint64_t seen = 0;
+    for(size_t i = 0; i < Buckets; ++i) {
+        seen += _buckets[i].load(std::memory_order_relaxed);
+        if( seen >= rank )
+            return std::min(UpperBound(i), Max());
+    }
+    return Max();
+}
+
+// Values below SubBuckets map one to one, larger ones are bucketed by the highest bit and SubBucketBits
+// bits right after it
+size_t Histogram::BucketOf(uint64_t value) {
+    if( value < SubBuckets )
+        return size_t(value);
+
+    size_t shift = size_t(63 - __builtin_clzll(value)) - SubBucketBits;
+    return (shift + 1) * SubBuckets + size_t((value >> shift) - SubBuckets);
+}
+
+// See Histogram.h
+uint64_t Histogram::UpperBound(size_t bucket) {
+    if( bucket < SubBuckets )
+        return uint64_t(bucket);
+
+    size_t shift = bucket / SubBuckets - 1;
+    uint64_t base = uint64_t(SubBuckets + bucket % SubBuckets) << shift;
+    return base + ((uint64_t(1) << shift) - 1);
+}
+
+} // namespace Afina
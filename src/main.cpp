@@ -1,5 +1,7 @@
 #include <chrono>
+#include <cstdint>
 #include <iostream>
+#include <map>
 #include <memory>
 //#include <uv.h>
 #include <fstream>
@@ -18,12 +20,65 @@
 #include "network/nonblocking/ServerImpl.h"
 #include "network/uv/ServerImpl.h"
 #include "storage/MapBasedGlobalLockImpl.h"
+#include "storage/RCUHashImpl.h"
+#include "storage/StripedLockImpl.h"
+#include "storage/ThreadSafeSimpleLRU.h"
 
 typedef struct {
     std::shared_ptr<Afina::Storage> storage;
     std::shared_ptr<Afina::Network::Server> server;
 } Application;
 
+// Print server statistics collected by the metrics loop. Executor utilisation is reported for the interval
+// since the previous call, counters it is computed from are kept in previous
+static void report_stats(const std::vector<std::pair<std::string, std::string>> &stats,
+                         std::map<std::string, uint64_t> &previous) {
+    std::map<std::string, uint64_t> current;
+    for (auto &stat : stats) {
+        std::cout << "  " << stat.first << " " << stat.second << std::endl;
+        if (stat.first == "executor_busy_time" || stat.first == "executor_thread_time") {
+            current[stat.first] = std::stoull(stat.second);
+        }
+    }
+
+    if (current.size() == 2) {
+        uint64_t busy = current["executor_busy_time"] - previous["executor_busy_time"];
+        uint64_t threads = current["executor_thread_time"] - previous["executor_thread_time"];
+        if (threads > 0) {
+            std::cout << "  executor_utilisation_interval " << double(busy) / threads << std::endl;
+        }
+        previous.swap(current);
+    }
+}
+
+// Parse size in bytes with optional K, M or G suffix
+static size_t parse_size(const std::string &value) {
+    // stoull accepts negative numbers and wraps them around
+    size_t start = value.find_first_not_of(" \t\n\v\f\r");
+    if (start != std::string::npos && value[start] == '-') {
+        throw std::invalid_argument("Negative size: " + value);
+    }
+
+    size_t pos = 0;
+    unsigned long long size = std::stoull(value, &pos);
+    std::string suffix = value.substr(pos);
+    unsigned shift = 0;
+    if (suffix == "K" || suffix == "k") {
+        shift = 10;
+    } else if (suffix == "M" || suffix == "m") {
+        shift = 20;
+    } else if (suffix == "G" || suffix == "g") {
+        shift = 30;
+    } else if (!suffix.empty()) {
+        throw std::invalid_argument("Unknown size suffix: " + suffix);
+    }
+
+    if (size > (SIZE_MAX >> shift)) {
+        throw std::invalid_argument("Size is too large: " + value);
+    }
+    return size << shift;
+}
+
 int main(int argc, char **argv) {
     // Build version
     // TODO: move into Version.h as a function
@@ -40,6 +95,12 @@ int main(int argc, char **argv) {
         // and simplify validation below
         options.add_options()("s,storage", "Type of storage service to use", cxxopts::value<std::string>());
         options.add_options()("n,network", "Type of network service to use", cxxopts::value<std::string>());
+        options.add_options()("m,memory-limit", "Memory limit for the storage in bytes, K/M/G suffixes allowed",
+                              cxxopts::value<std::string>());
+        options.add_options()("executor", "Executor of the uv network service: shared or stealing",
+                              cxxopts::value<std::string>());
+        options.add_options()("reuseport", "Give each nonblocking worker its own SO_REUSEPORT listener");
+        options.add_options()("backlog", "Length of accept queue of each listener", cxxopts::value<int>());
         options.add_options()("h,help", "Print usage info");
         options.add_options()("d,daemon", "Run server as a daemon");
         options.add_options()("p,pid", "Write PID to file", cxxopts::value<std::string>());
@@ -83,8 +144,19 @@ int main(int argc, char **argv) {
         storage_type = options["storage"].as<std::string>();
     }
 
+    size_t memory_limit = 64 * 1024 * 1024;
+    if (options.count("memory-limit") > 0) {
+        memory_limit = parse_size(options["memory-limit"].as<std::string>());
+    }
+
     if (storage_type == "map_global") {
-        app.storage = std::make_shared<Afina::Backend::MapBasedGlobalLockImpl>();
+        app.storage = std::make_shared<Afina::Backend::MapBasedGlobalLockImpl>(memory_limit);
+    } else if (storage_type == "lru") {
+        app.storage = std::make_shared<Afina::Backend::ThreadSafeSimpleLRU>(memory_limit, memory_limit);
+    } else if (storage_type == "striped") {
+        app.storage = std::make_shared<Afina::Backend::StripedLockImpl>(memory_limit, 16, memory_limit);
+    } else if (storage_type == "rcu") {
+        app.storage = std::make_shared<Afina::Backend::RCUHashImpl>(memory_limit);
     } else {
         throw std::runtime_error("Unknown storage type");
     }
@@ -96,11 +168,25 @@ int main(int argc, char **argv) {
     }
 
     if (network_type == "uv") {
-        app.server = std::make_shared<Afina::Network::UV::ServerImpl>(app.storage);
+        Afina::Executor::Mode executor_mode = Afina::Executor::Mode::kSharedQueue;
+        if (options.count("executor") > 0) {
+            std::string executor_type = options["executor"].as<std::string>();
+            if (executor_type == "stealing") {
+                executor_mode = Afina::Executor::Mode::kWorkStealing;
+            } else if (executor_type != "shared") {
+                throw std::runtime_error("Unknown executor type");
+            }
+        }
+        app.server = std::make_shared<Afina::Network::UV::ServerImpl>(app.storage, 4, executor_mode);
     } else if (network_type == "blocking") {
         app.server = std::make_shared<Afina::Network::Blocking::ServerImpl>(app.storage);
     } else if (network_type == "nonblocking") {
-        app.server = std::make_shared<Afina::Network::NonBlocking::ServerImpl>(app.storage);
+        int backlog = SOMAXCONN;
+        if (options.count("backlog") > 0) {
+            backlog = options["backlog"].as<int>();
+        }
+        app.server = std::make_shared<Afina::Network::NonBlocking::ServerImpl>(app.storage,
+                                                                               options.count("reuseport") > 0, backlog);
     } else {
         throw std::runtime_error("Unknown network type");
     }
@@ -155,6 +241,7 @@ int main(int argc, char **argv) {
         const int MAXEVENTS = 8;
         struct epoll_event *loop_events = (struct epoll_event*)calloc(MAXEVENTS, sizeof(struct epoll_event));
         bool loop_running = true;
+        std::map<std::string, uint64_t> previous_stats;
         while( loop_running )
         {
             int n = epoll_wait(loop_epoll_fd, loop_events, MAXEVENTS, -1);
@@ -170,6 +257,9 @@ int main(int argc, char **argv) {
                         int rval = read(timer_fd, &val, sizeof(uint64_t));
                         if( rval > 0 ) {
                             std::cout << "Start passive metrics collection" << std::endl;
+                            std::vector<std::pair<std::string, std::string>> stats;
+                            app.server->CollectStats(stats);
+                            report_stats(stats, previous_stats);
                     }
                 }
             }
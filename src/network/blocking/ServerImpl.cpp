@@ -1,10 +1,12 @@
 #include "ServerImpl.h"
 
 #include <cassert>
+#include <climits>
 #include <cstring>
 #include <iostream>
 #include <memory>
 #include <stdexcept>
+#include <vector>
 
 #include <pthread.h>
 #include <signal.h>
@@ -15,11 +17,13 @@
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <afina/Storage.h>
 #include <afina/execute/Command.h>
-#include <../src/protocol/Parser.h>
+#include <afina/execute/Response.h>
+#include <../src/protocol/Framing.h>
 
 #include <algorithm>
 
@@ -27,6 +31,41 @@ namespace Afina {
 namespace Network {
 namespace Blocking {
 
+// Size of connection input buffer
+static const size_t InputBufferSize = 16 * 1024;
+
+// Writes all response chunks with as few syscalls as possible, values go to the socket straight
+// from the storage memory. Returns false if socket fails
+static bool WriteResponse(int socket, const Afina::Execute::Response &response) {
+    std::vector<struct iovec> iov(response.Chunks());
+    for (size_t i = 0; i < iov.size(); i++) {
+        const char *data;
+        size_t size;
+        response.Chunk(i, data, size);
+        iov[i].iov_base = const_cast<char *>(data);
+        iov[i].iov_len = size;
+    }
+
+    size_t first = 0;
+    while( first < iov.size() ) {
+        ssize_t written = writev(socket, &iov[first], std::min(iov.size() - first, size_t(IOV_MAX)));
+        if( written <= 0 ) {
+            return false;
+        }
+
+        // Skip fully written chunks and adjust partially written one
+        while( first < iov.size() && size_t(written) >= iov[first].iov_len ) {
+            written -= iov[first].iov_len;
+            first++;
+        }
+        if( first < iov.size() ) {
+            iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + written;
+            iov[first].iov_len -= written;
+        }
+    }
+    return true;
+}
+
 void *ServerImpl::RunAcceptorProxy(void *p) {
     ServerImpl *srv = reinterpret_cast<ServerImpl *>(p);
     try {
@@ -223,62 +262,57 @@ void ServerImpl::RunConnection(int client_socket) {
     }
 
     // TODO: All connection work is here
-    size_t buf_size = 256;
-    char msg_buf[buf_size];
-    memset(msg_buf, 0, buf_size);
-    int rval;
-    size_t parsed = 0;
-    Afina::Protocol::Parser parser;
-    std::string command = "";
-    while( running.load() && ((rval = read(client_socket, msg_buf, buf_size)) != 0 || command.size() > 0) )
+    // Socket is read right into the free space of the ring buffer and framer takes commands out of it,
+    // so commands pipelined or split between reads are handled without moving the stream around
+    Afina::Protocol::RingBuffer input(InputBufferSize);
+    Afina::Protocol::Framer framer;
+    bool failed = false;
+    while( running.load() && !failed )
     {
-        if( rval < 0 ) {
-            std::cout << "Reading stream error" << std::endl;
+        size_t free = 0;
+        char *space = input.WriteSpace(free);
+        ssize_t rval = read(client_socket, space, free);
+        if( rval == 0 ) {
             break;
-        }
-        command += msg_buf;
-        bool parse_finished = false;
-        try {
-            parse_finished = parser.Parse(command, parsed);
-        } catch(...) {
-            std::string result = "ERROR\r\n";
-            if( send(client_socket, result.data(), result.size(), 0) <= 0 ) {
-                close(client_socket);
-                throw std::runtime_error("Socket send() failed");
-            }
+        } else if( rval < 0 ) {
+            std::cout << "Reading stream error" << std::endl;
             break;
         }
-        command.erase(0, parsed);
-        parsed = 0;
-        if( parse_finished ) {
-            uint32_t body_size;
-            std::unique_ptr<Afina::Execute::Command> com_ptr = parser.Build(body_size);
-            std::string args;
-            if( body_size > 0 ) {
-                while( body_size + 2 > command.size() ) {
-                    rval = read(client_socket, msg_buf, buf_size);
-                    command += msg_buf;
-                    memset(msg_buf, 0, buf_size);
+        input.Produce(rval);
+
+        while( !input.Empty() ) {
+            size_t available = 0, consumed = 0;
+            const char *data = input.ReadSpace(available);
+            bool complete = false;
+            try {
+                complete = framer.Feed(data, available, consumed);
+            } catch(...) {
+                std::string result = "ERROR\r\n";
+                if( send(client_socket, result.data(), result.size(), 0) <= 0 ) {
+                    close(client_socket);
+                    throw std::runtime_error("Socket send() failed");
                 }
-                // get command argument
-                args = command.substr(0, body_size);
-                command.erase(0, body_size + 2); // including /r/n
+                failed = true;
+                break;
             }
-            std::string result;
+            input.Consume(consumed);
+            if( !complete ) {
+                continue;
+            }
+
+            Afina::Execute::Response result;
             try {
-                com_ptr->Execute(*pStorage, args, result);
+                framer.Command()->Execute(*pStorage, framer.Body(), result);
             } catch(...) {
-                result = "SERVER_ERROR";
+                result.Clear();
+                result.Append("SERVER_ERROR\r\n");
             }
-            result += "\r\n";
-            if ( result.size() && send(client_socket, result.data(), result.size(), 0) <= 0 ) {
+            if( !result.Empty() && !WriteResponse(client_socket, result) ) {
                 close(client_socket);
                 throw std::runtime_error("Socket send() failed");
             }
-            parser.Reset();
-            parsed = 0;
+            framer.Reset();
         }
-        memset(msg_buf, 0, buf_size);
     }
     close(client_socket);
 
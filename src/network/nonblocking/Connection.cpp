@@ -0,0 +1,164 @@
+#include "Connection.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <afina/Storage.h>
+#include <afina/execute/Command.h>
+
+namespace Afina {
+namespace Network {
+namespace NonBlocking {
+
+// Maximum number of chunks passed to a single writev
+static const size_t MaxWriteChunks = 64;
+
+// See Connection.h
+Connection::Connection(int socket, std::shared_ptr<Afina::Storage> ps)
+    : _socket(socket), pStorage(ps), _input(InputBufferSize), _output_offset(0), _pending(0), _traffic(0), _eof(false),
+      _closing(false) {}
+
+// See Connection.h
+Connection::~Connection() { close(_socket); }
+
+// Output is flushed before more input is read, so memory held by connection is bounded by the
+// watermark plus a single input buffer. Peer EOF doesn't cancel commands already received
+// See Connection.h
+bool Connection::Resume() {
+    while (true) {
+        bool drained = Process();
+        if (!Flush()) {
+            return false;
+        }
+
+        // Wait until socket becomes writable again
+        if (_pending >= OutputHighWatermark) {
+            return true;
+        }
+
+        // Output is flushed, continue with commands that are already buffered
+        if (!drained) {
+            continue;
+        }
+
+        if (_eof || _closing) {
+            _closing = true;
+            return true;
+        }
+
+        size_t free = 0;
+        char *space = _input.WriteSpace(free);
+        ssize_t n = read(_socket, space, free);
+        if (n > 0) {
+            _input.Produce(n);
+            _traffic += n;
+        } else if (n == 0) {
+            _eof = true;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return true;
+        } else if (errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+// See Connection.h
+bool Connection::Process() {
+    try {
+        while (!_closing && !_input.Empty()) {
+            if (_pending >= OutputHighWatermark) {
+                return false;
+            }
+
+            size_t available = 0, consumed = 0;
+            const char *data = _input.ReadSpace(available);
+            bool complete = _framer.Feed(data, available, consumed);
+            _input.Consume(consumed);
+            if (complete) {
+                RunCommand();
+            }
+        }
+    } catch (std::runtime_error &ex) {
+        // Input stream can't be synchronized anymore, connection gets closed once error is sent
+        Afina::Execute::Response result;
+        result.Append(std::string("CLIENT_ERROR ") + ex.what() + "\r\n");
+        _pending += result.Size();
+        _output.push_back(std::move(result));
+        _closing = true;
+    }
+    return true;
+}
+
+// See Connection.h
+void Connection::RunCommand() {
+    Afina::Execute::Response result;
+    try {
+        _framer.Command()->Execute(*pStorage, _framer.Body(), result);
+    } catch (std::runtime_error &ex) {
+        result.Clear();
+        result.Append(std::string("SERVER_ERROR ") + ex.what() + "\r\n");
+    }
+
+    // Commands sent with noreply have nothing to queue
+    if (!result.Empty()) {
+        _pending += result.Size();
+        _output.push_back(std::move(result));
+    }
+
+    _framer.Reset();
+}
+
+// Chunks of several queued responses are written by a single call
+// See Connection.h
+bool Connection::Flush() {
+    while (!_output.empty()) {
+        struct iovec iov[MaxWriteChunks];
+        size_t count = 0;
+        size_t skip = _output_offset;
+        for (auto it = _output.begin(); it != _output.end() && count < MaxWriteChunks; it++) {
+            for (size_t i = 0; i < it->Chunks() && count < MaxWriteChunks; i++) {
+                const char *data;
+                size_t size;
+                it->Chunk(i, data, size);
+                if (skip >= size) {
+                    skip -= size;
+                    continue;
+                }
+
+                iov[count].iov_base = const_cast<char *>(data + skip);
+                iov[count].iov_len = size - skip;
+                skip = 0;
+                count++;
+            }
+        }
+
+        ssize_t written = count > 0 ? writev(_socket, iov, count) : 0;
+        if (written < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;
+            } else if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        _pending -= written;
+        _traffic += written;
+        _output_offset += written;
+        while (!_output.empty() && _output_offset >= _output.front().Size()) {
+            _output_offset -= _output.front().Size();
+            _output.pop_front();
+        }
+    }
+    return true;
+}
+
+} // namespace NonBlocking
+} // namespace Network
+} // namespace Afina
@@ -0,0 +1,126 @@
+#ifndef AFINA_NETWORK_NONBLOCKING_CONNECTION_H
+#define AFINA_NETWORK_NONBLOCKING_CONNECTION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+
+#include <afina/execute/Response.h>
+#include <protocol/Framing.h>
+
+namespace Afina {
+
+// Forward declaration, see afina/Storage.h
+class Storage;
+
+namespace Execute {
+class Command;
+} // namespace Execute
+
+namespace Network {
+namespace NonBlocking {
+
+/**
+ * # Client connection served by epoll worker
+ * Keeps everything needed to resume processing at any byte boundary: input buffer, framer state and
+ * queue of responses not yet written out. Socket is non blocking and is expected to be registered in
+ * edge triggered mode, so every handler drains the socket until it would block.
+ *
+ * Once too much output is queued for a client that doesn't read it, connection stops to execute new
+ * commands until output is flushed, so slow client can't make server buffer unlimited amount of data
+ */
+class Connection {
+public:
+    // Size of input buffer, that is how many bytes are read from socket at once
+    static const size_t InputBufferSize = 64 * 1024;
+
+    // Connection stops processing input once that many bytes are queued for output
+    static const size_t OutputHighWatermark = 1024 * 1024;
+
+    Connection(int socket, std::shared_ptr<Afina::Storage> ps);
+    ~Connection();
+
+    int Socket() const { return _socket; }
+
+    /**
+     * Socket became readable or writable: writes queued output out, executes buffered commands and
+     * reads more input until socket would block or output queue is full. Returns false if connection
+     * must be closed right away
+     */
+    bool Resume();
+
+    /**
+     * Stops reading new commands, connection is closed once queued output is flushed
+     */
+    void Shutdown() { _closing = true; }
+
+    /**
+     * True if connection has nothing more to do and could be closed
+     */
+    bool Done() const { return _closing && _output.empty(); }
+
+    /**
+     * Number of bytes queued for output
+     */
+    size_t Pending() const { return _pending; }
+
+    /**
+     * Total number of bytes read and written so far
+     */
+    uint64_t Traffic() const { return _traffic; }
+
+    /**
+     * True if connection has no buffered input and output, so it could be handed over to another
+     * thread between events
+     */
+    bool Idle() const { return !_closing && _input.Empty() && _output.empty(); }
+
+private:
+    Connection(const Connection &);            // = delete;
+    Connection &operator=(const Connection &); // = delete;
+
+    /**
+     * Parses and executes commands from input buffer, returns false if stopped because output
+     * queue is full
+     */
+    bool Process();
+
+    /**
+     * Runs parsed command and queues its response
+     */
+    void RunCommand();
+
+    /**
+     * Writes queued output until socket would block, returns false on socket error
+     */
+    bool Flush();
+
+    int _socket;
+    std::shared_ptr<Afina::Storage> pStorage;
+
+    // Splits input into commands, keeps partial command between reads
+    Protocol::Framer _framer;
+
+    // Input bytes not processed yet, socket is read right into the free space
+    Protocol::RingBuffer _input;
+
+    // Responses not yet written out, bytes of the first one before _output_offset are already sent
+    std::deque<Execute::Response> _output;
+    size_t _output_offset;
+    size_t _pending;
+    uint64_t _traffic;
+
+    // Peer closed its side of connection
+    bool _eof;
+
+    // No more commands are executed: peer closed connection, protocol error happened or worker is stopping
+    bool _closing;
+};
+
+} // namespace NonBlocking
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_NONBLOCKING_CONNECTION_H
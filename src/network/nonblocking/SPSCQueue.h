@@ -0,0 +1,74 @@
+#ifndef AFINA_NETWORK_NONBLOCKING_SPSC_QUEUE_H
+#define AFINA_NETWORK_NONBLOCKING_SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace Afina {
+namespace Network {
+namespace NonBlocking {
+
+/**
+ * # Bounded single producer single consumer queue
+ * Lock free ring buffer: producer owns tail and consumer owns head, each of them only reads index
+ * of the other side, so neither of operations ever waits. Capacity is rounded up to power of two
+ *
+ * Indices are padded into separate cache lines to avoid false sharing between two threads
+ */
+template <typename T> class SPSCQueue {
+public:
+    SPSCQueue(size_t capacity) : _head(0), _tail(0) {
+        _capacity = 1;
+        while (_capacity < capacity) {
+            _capacity <<= 1;
+        }
+        _items.reset(new T[_capacity]);
+    }
+
+    /**
+     * Called by producer only. Returns false if queue is full
+     */
+    bool Push(const T &item) {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head.load(std::memory_order_acquire) == _capacity) {
+            return false;
+        }
+        _items[tail & (_capacity - 1)] = item;
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Called by consumer only. Returns false if queue is empty
+     */
+    bool Pop(T &item) {
+        size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = _items[head & (_capacity - 1)];
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t Capacity() const { return _capacity; }
+
+private:
+    SPSCQueue(const SPSCQueue &);            // = delete;
+    SPSCQueue &operator=(const SPSCQueue &); // = delete;
+
+    size_t _capacity;
+    std::unique_ptr<T[]> _items;
+
+    char _pad0[64];
+    std::atomic<size_t> _head;
+    char _pad1[64];
+    std::atomic<size_t> _tail;
+};
+
+} // namespace NonBlocking
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_NONBLOCKING_SPSC_QUEUE_H
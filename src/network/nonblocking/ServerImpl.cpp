@@ -23,27 +23,8 @@ namespace Afina {
 namespace Network {
 namespace NonBlocking {
 
-// See Server.h
-ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps) : Server(ps) {}
-
-// See Server.h
-ServerImpl::~ServerImpl() {}
-
-// See Server.h
-void ServerImpl::Start(uint32_t port, uint16_t n_workers) {
-    std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
-
-    // If a client closes a connection, this will generally produce a SIGPIPE
-    // signal that will kill the process. We want to ignore this signal, so send()
-    // just returns -1 when this happens.
-    sigset_t sig_mask;
-    sigemptyset(&sig_mask);
-    sigaddset(&sig_mask, SIGPIPE);
-    if (pthread_sigmask(SIG_BLOCK, &sig_mask, NULL) != 0) {
-        throw std::runtime_error("Unable to mask SIGPIPE");
-    }
-
-    // Create server socket
+// Creates non blocking socket listening on the given port
+static int CreateListener(uint32_t port, bool reuse_port, int backlog) {
     struct sockaddr_in server_addr;
     std::memset(&server_addr, 0, sizeof(server_addr));
     server_addr.sin_family = AF_INET;         // IPv4
@@ -61,21 +42,68 @@ void ServerImpl::Start(uint32_t port, uint16_t n_workers) {
         throw std::runtime_error("Socket setsockopt() failed");
     }
 
+    if (reuse_port && setsockopt(server_socket, SOL_SOCKET, SO_REUSEPORT, &opts, sizeof(opts)) == -1) {
+        close(server_socket);
+        throw std::runtime_error("Socket setsockopt(SO_REUSEPORT) failed");
+    }
+
     if (bind(server_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1) {
         close(server_socket);
         throw std::runtime_error("Socket bind() failed");
     }
 
     make_socket_non_blocking(server_socket);
-    if (listen(server_socket, 5) == -1) {
+    if (listen(server_socket, backlog) == -1) {
         close(server_socket);
         throw std::runtime_error("Socket listen() failed");
     }
+    return server_socket;
+}
+
+// See Server.h
+ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps, bool reuse_port, int backlog)
+    : Server(ps), reuse_port(reuse_port), backlog(backlog) {}
 
+// See Server.h
+ServerImpl::~ServerImpl() {}
+
+// See Server.h
+void ServerImpl::Start(uint32_t port, uint16_t n_workers) {
+    std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
+
+    // If a client closes a connection, this will generally produce a SIGPIPE
+    // signal that will kill the process. We want to ignore this signal, so send()
+    // just returns -1 when this happens.
+    sigset_t sig_mask;
+    sigemptyset(&sig_mask);
+    sigaddset(&sig_mask, SIGPIPE);
+    if (pthread_sigmask(SIG_BLOCK, &sig_mask, NULL) != 0) {
+        throw std::runtime_error("Unable to mask SIGPIPE");
+    }
+
+    listen_port = port;
+
+    // All listeners are created before any worker starts, so failure to bind one of them leaves nothing running
+    try {
+        size_t n_listeners = reuse_port ? n_workers : 1;
+        for (size_t i = 0; i < n_listeners; i++) {
+            server_sockets.push_back(CreateListener(port, reuse_port, backlog));
+        }
+    } catch (std::runtime_error &ex) {
+        for (int server_socket : server_sockets) {
+            close(server_socket);
+        }
+        server_sockets.clear();
+        throw;
+    }
+
+    // Workers refer to each other, so all of them are placed before any starts
     workers.reserve(n_workers);
     for (int i = 0; i < n_workers; i++) {
-        workers.emplace_back(pStorage);
-        workers.back().Start(server_socket);
+        workers.emplace_back(pStorage, i, &workers);
+    }
+    for (int i = 0; i < n_workers; i++) {
+        workers[i].Start(server_sockets[i % server_sockets.size()]);
     }
 }
 
@@ -93,6 +121,21 @@ void ServerImpl::Join() {
     for (auto &worker : workers) {
         worker.Join();
     }
+    workers.clear();
+
+    for (int server_socket : server_sockets) {
+        close(server_socket);
+    }
+    server_sockets.clear();
+}
+
+// See ServerImpl.h
+std::vector<uint32_t> ServerImpl::Connections() const {
+    std::vector<uint32_t> result;
+    for (auto &worker : workers) {
+        result.push_back(worker.GetLoad().connections.load(std::memory_order_relaxed));
+    }
+    return result;
 }
 
 } // namespace NonBlocking
@@ -1,8 +1,11 @@
 #ifndef AFINA_NETWORK_NONBLOCKING_SERVER_H
 #define AFINA_NETWORK_NONBLOCKING_SERVER_H
 
+#include <cstdint>
 #include <vector>
 
+#include <sys/socket.h>
+
 #include <afina/network/Server.h>
 
 namespace Afina {
@@ -15,10 +18,14 @@ class Worker;
 /**
  * # Network resource manager implementation
  * Epoll based server
+ *
+ * By default all workers wait on a single listening socket. With reuse_port each worker gets its own
+ * SO_REUSEPORT listener bound to the same port, so kernel spreads incoming connections across workers
+ * and each of them has its own accept queue of the given backlog
  */
 class ServerImpl : public Server {
 public:
-    ServerImpl(std::shared_ptr<Afina::Storage> ps);
+    ServerImpl(std::shared_ptr<Afina::Storage> ps, bool reuse_port = false, int backlog = SOMAXCONN);
     ~ServerImpl();
 
     // See Server.h
@@ -30,12 +37,26 @@ public:
     // See Server.h
     void Join() override;
 
+    /**
+     * Number of connections each of the workers serves at the moment, in order of workers
+     */
+    std::vector<uint32_t> Connections() const;
+
 private:
     // Port to listen for new connections, permits access only from
     // inside of accept_thread
     // Read-only
     uint32_t listen_port;
 
+    // Listener per worker is created instead of a shared one
+    bool reuse_port;
+
+    // Length of accept queue of each listener
+    int backlog;
+
+    // Listening sockets, closed once workers are joined
+    std::vector<int> server_sockets;
+
     // Thread that is accepting new connections
     std::vector<Worker> workers;
 };
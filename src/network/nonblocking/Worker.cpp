@@ -1,205 +1,373 @@
 #include "Worker.h"
 
+#include <chrono>
 #include <iostream>
+#include <stdexcept>
 
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <netinet/in.h>
 #include <unistd.h>
 
+#include <cerrno>
 #include <cstring>
-#include <string>
-#include <algorithm>
 
+#include "Connection.h"
 #include "Utils.h"
-#include <afina/execute/Command.h>
-#include <../src/protocol/Parser.h>
 
 namespace Afina {
 namespace Network {
 namespace NonBlocking {
-    
+
+// Number of events taken from epoll at once
+static const int MaxEvents = 64;
+
+// How long stopping worker waits for connections to flush their output
+static const std::chrono::milliseconds StopTimeout(1000);
+
+// How often worker updates its traffic rate and checks if connections should be moved
+static const std::chrono::milliseconds BalanceInterval(1000);
+
+// Capacity of the handoff queue between a pair of workers
+static const size_t HandoffQueueSize = 256;
+
+// Maximum number of idle connections moved during a single balance interval
+static const size_t MaxMigrations = 16;
+
 // See Worker.h
-Worker::Worker(std::shared_ptr<Afina::Storage> ps) : pStorage(ps)
-{
-    running.store(false);
+Worker::Worker(std::shared_ptr<Afina::Storage> ps, size_t id, std::vector<Worker> *peers)
+    : pStorage(ps), id(id), peers(peers), server_socket(-1), running(false), epoll_fd(-1), wakeup_fd(-1),
+      traffic(0) {
+    load.connections.store(0);
+    load.rate.store(0);
+    load.pending.store(0);
 }
 
-Worker::Worker(Worker&& w) :
-    pStorage(std::move(w.pStorage))
-    , thread(std::move(w.thread))
-    , server_socket(std::move(w.server_socket))
+// Workers are moved only while being placed into container, before they are started
+// See Worker.h
+Worker::Worker(Worker&& w)
+    : pStorage(std::move(w.pStorage)), id(w.id), peers(w.peers), thread(w.thread), server_socket(w.server_socket),
+      running(w.running.load()), epoll_fd(w.epoll_fd), wakeup_fd(w.wakeup_fd), traffic(0)
 {
-    std::cout << "Entering move constructor\n";
-    running.store(w.running.load());
+    w.epoll_fd = -1;
+    w.wakeup_fd = -1;
+    load.connections.store(0);
+    load.rate.store(0);
+    load.pending.store(0);
 }
 
+// Peers could still push connections while this worker is stopping, these are closed here once
+// all workers are joined
 // See Worker.h
 Worker::~Worker() {
-    // TODO: implementation here
+    for (auto &queue : inbox) {
+        Connection *conn;
+        while (queue->Pop(conn)) {
+            delete conn;
+        }
+    }
+
+    if (epoll_fd != -1) {
+        close(epoll_fd);
+    }
+    if (wakeup_fd != -1) {
+        close(wakeup_fd);
+    }
 }
 
 // See Worker.h
 void Worker::Start(int server_socket) {
     std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
-    // TODO: implementation here
-
     this->server_socket = server_socket;
+
+    epoll_fd = epoll_create1(0);
+    if (epoll_fd == -1) {
+        throw std::runtime_error("Failed to create epoll context");
+    }
+
+    wakeup_fd = eventfd(0, EFD_NONBLOCK);
+    if (wakeup_fd == -1) {
+        throw std::runtime_error("Failed to create eventfd");
+    }
+
+    // Listener could be shared between workers, exclusive wake up avoids thundering herd on accept
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLEXCLUSIVE;
+    event.data.ptr = &this->server_socket;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_socket, &event) == -1) {
+        throw std::runtime_error("Failed to add server socket into epoll");
+    }
+
+    event.events = EPOLLIN;
+    event.data.ptr = &wakeup_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fd, &event) == -1) {
+        throw std::runtime_error("Failed to add eventfd into epoll");
+    }
+
+    size_t n_peers = peers != nullptr ? peers->size() : 0;
+    for (size_t i = 0; i < n_peers; i++) {
+        inbox.emplace_back(new SPSCQueue<Connection *>(HandoffQueueSize));
+    }
+
+    // Peers start to hand connections over once worker is running
     running.store(true);
-    struct args_t *args = (struct args_t*)malloc(sizeof(struct args_t));
-    args->socket = server_socket;
-    args->this_ptr = this;
-    pthread_create(&thread, NULL, OnRunWrapper, (void*)args);
+    if (pthread_create(&thread, NULL, OnRunWrapper, this) != 0) {
+        running.store(false);
+        throw std::runtime_error("Failed to start worker thread");
+    }
 }
 
 // See Worker.h
 void Worker::Stop() {
     std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
-    // TODO: implementation here
     running.store(false);
-    shutdown(server_socket, SHUT_RDWR);
+
+    uint64_t one = 1;
+    if (write(wakeup_fd, &one, sizeof(one)) != sizeof(one)) {
+        std::cerr << "Failed to wake up worker: " << strerror(errno) << std::endl;
+    }
 }
 
 // See Worker.h
 void Worker::Join() {
     std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
-    // TODO: implementation here
     pthread_join(thread, 0);
 }
 
+// See Worker.h
 void *Worker::OnRunWrapper(void *args) {
-    args_t *wa = (args_t*)args;
-    Worker* worker = reinterpret_cast<Worker *>(wa->this_ptr);
-    worker->OnRun(args);
+    Worker *worker = reinterpret_cast<Worker *>(args);
+    try {
+        worker->OnRun();
+    } catch (std::runtime_error &ex) {
+        std::cerr << "Worker fails: " << ex.what() << std::endl;
+    }
+    return nullptr;
 }
 
+// Once stop is requested, listener is removed and every connection gets a chance to flush results
+// of commands it has already received
 // See Worker.h
-void Worker::OnRun(void *args) {
+void Worker::OnRun() {
     std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
-    args_t *wa = (args_t*)args;
-    int server_socket = wa->socket;
-
-    // TODO: implementation here
-    // 1. Create epoll_context here
-    int epoll_fd = epoll_create(200);
-    if (-1 == epoll_fd) {
-        throw std::runtime_error("Failed to create epoll context.");
-    }
-
-    // 2. Add server_socket to context
-    struct epoll_event server_listen_event;
-    server_listen_event.events = EPOLLIN | EPOLLET | EPOLLEXCLUSIVE;
-    server_listen_event.data.ptr = (void*)&server_socket;
-    if (-1 == epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_socket, &server_listen_event)) {
-        throw std::runtime_error("Failed to add an event for server socket.");
-    }
-
-    struct sockaddr_in clientaddr;
-    socklen_t clientlen = sizeof(clientaddr);
-    unsigned int MAXEVENTS = 20;
-    struct epoll_event *events = (epoll_event*)calloc(MAXEVENTS, sizeof(struct epoll_event));
-    while( running.load() )
-    {
-        int n = epoll_wait(epoll_fd, events, MAXEVENTS, -1);
-        if (-1 == n) {
+
+    struct epoll_event events[MaxEvents];
+    auto next_balance = std::chrono::steady_clock::now() + BalanceInterval;
+    while (running.load()) {
+        int n = epoll_wait(epoll_fd, events, MaxEvents, BalanceInterval.count());
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
             throw std::runtime_error("Failed to epoll_wait");
         }
 
         for (int i = 0; i < n; ++i) {
-            if( &server_socket == events[i].data.ptr ) {
-                // 3. Accept new connections, don't forget to call make_socket_nonblocking on
-                //    the client socket descriptor
-                //std::cout << "Processing accept in thread " << thread << std::endl;
-                int client_socket = accept(server_socket, (struct sockaddr *)&clientaddr, &clientlen);
-                if (-1 == client_socket) {
-                    if( errno == EINVAL || errno == EAGAIN || errno == EWOULDBLOCK ) {
-                        std::cout << "Accept returned EINVAL\n";
-                        break;
-                    } else {
-                        throw std::runtime_error("Accept failed");
-                    }
-                }
-                make_socket_non_blocking(client_socket);
-            
-                // 4. Add connections to the local context
-                //
-                // Do not forget to use EPOLLEXCLUSIVE flag when register socket
-                // for events to avoid thundering herd type behavior.
-                struct epoll_event client_conn_event;
-                client_conn_event.events = EPOLLIN | EPOLLOUT;
-                client_conn_event.data.ptr = (void*)&client_socket;
-                if (-1 == epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_socket, &client_conn_event)) {
-                    throw std::runtime_error("Failed to add an EPOLLIN event for client socket.");
+            if (events[i].data.ptr == &server_socket) {
+                OnAccept();
+            } else if (events[i].data.ptr == &wakeup_fd) {
+                uint64_t value;
+                while (read(wakeup_fd, &value, sizeof(value)) > 0) {
                 }
-            } else if( EPOLLHUP & events[i].events || EPOLLERR & events[i].events ) {
-                close(*(int*)events[i].data.ptr);
+                OnHandoff();
             } else {
-                // 5. Process connection events
-                //std::cout << "Processing connection in thread " << thread << std::endl;
-                int client_socket = *(int*)events[i].data.ptr;
-                const size_t buf_size = 256;
-                char msg_buf[buf_size];
-                memset(msg_buf, 0, buf_size);
-                int rval;
-                size_t parsed = 0;
-                Afina::Protocol::Parser parser;
-                std::string command = "";
-                while( (rval = read(client_socket, msg_buf, buf_size)) != 0 || command.size() > 0 )
-                {
-                    command += msg_buf;
-                    //if( rval > 0 )
-                    //    std::cout << "Command string : " << command << "\n";
-                    bool parse_finished = false;
-                    try {
-                        parse_finished = parser.Parse(command, parsed);
-                    } catch(...) {
-                        std::string result = "ERROR\r\n";
-                        if( send(client_socket, result.data(), result.size(), 0) <= 0 ) {
-                            close(client_socket);
-                            throw std::runtime_error("Socket send() failed");
-                        }
-                        break;
-                    }
-                    command.erase(0, parsed);
-                    if( parse_finished ) {
-                        uint32_t body_size;
-                        std::unique_ptr<Afina::Execute::Command> com_ptr = parser.Build(body_size);
-                        std::string args;
-                        if( body_size > 0 ) {
-                            // get command argument
-                            while( body_size + 2 > command.size() ) {
-                                rval = read(client_socket, msg_buf, buf_size);
-                                command += msg_buf;
-                                memset(msg_buf, 0, buf_size);
-                            }
-                            args = command.substr(0, body_size);
-                            command.erase(0, body_size + 2); // including /r/n
-                        }
-                        std::string result;
-                        try {
-                            com_ptr->Execute(*pStorage, args, result);
-                        //    std::cout << "Running command in thread " << thread << std::endl;
-                        } catch(...) {
-                            result = "SERVER_ERROR";
-                        }
-                        result += "\r\n";
-                        if ( result.size() && send(client_socket, result.data(), result.size(), 0) <= 0 ) {
-                            close(client_socket);
-                            throw std::runtime_error("Socket send() failed");
-                        }
-                        //std::cout << "Sent result " << result << "\n";
-                        parser.Reset();
-                        parse_finished = false;
-                        parsed = 0;
-                    }
-                    memset(msg_buf, 0, buf_size);
-                }
-                close(client_socket);
-                //std::cout << "Closing socket and leaving this connection\n";
+                OnEvent(static_cast<Connection *>(events[i].data.ptr), events[i].events);
+            }
+        }
+
+        // Connections are moved only between batches, so no event left refers to them
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_balance) {
+            Rebalance();
+            next_balance = now + BalanceInterval;
+        }
+    }
+
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, server_socket, nullptr);
+    OnHandoff();
+    for (auto it = connections.begin(); it != connections.end();) {
+        Connection *conn = *it++;
+        conn->Shutdown();
+        OnEvent(conn, EPOLLOUT);
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + StopTimeout;
+    while (!connections.empty()) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) {
+            break;
+        }
+
+        int n = epoll_wait(epoll_fd, events, MaxEvents, left.count());
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.ptr != &server_socket && events[i].data.ptr != &wakeup_fd) {
+                OnEvent(static_cast<Connection *>(events[i].data.ptr), events[i].events);
             }
         }
     }
+
+    while (!connections.empty()) {
+        Close(*connections.begin());
+    }
+}
+
+// Listener is level triggered, so it is enough to accept a batch and let other workers take the rest
+// See Worker.h
+void Worker::OnAccept() {
+    for (int i = 0; i < MaxEvents; ++i) {
+        int client_socket = accept4(server_socket, nullptr, nullptr, SOCK_NONBLOCK);
+        if (client_socket == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                std::cerr << "Failed to accept: " << strerror(errno) << std::endl;
+            }
+            return;
+        }
+
+        Connection *conn = new Connection(client_socket, pStorage);
+
+        // Ties stay here, so handoff cost is paid only if it makes load more even
+        Worker *target = LeastLoaded();
+        if (target != nullptr && target->load.connections.load() < load.connections.load() &&
+            Handoff(conn, target)) {
+            continue;
+        }
+
+        load.connections++;
+        Adopt(conn);
+    }
+}
+
+// See Worker.h
+void Worker::OnEvent(Connection *conn, uint32_t events) {
+    uint64_t traffic_before = conn->Traffic();
+    size_t pending_before = conn->Pending();
+
+    bool alive = !(events & EPOLLERR) && conn->Resume() && !conn->Done();
+
+    traffic += conn->Traffic() - traffic_before;
+    load.pending += conn->Pending() - pending_before;
+    if (!alive) {
+        Close(conn);
+    }
+}
+
+// See Worker.h
+void Worker::Close(Connection *conn) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->Socket(), nullptr);
+    connections.erase(conn);
+    load.connections--;
+    load.pending -= conn->Pending();
+    delete conn;
+}
+
+// Socket is checked for readiness once added, so data arrived before that is not lost
+// See Worker.h
+void Worker::Adopt(Connection *conn) {
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = conn;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, conn->Socket(), &event) == -1) {
+        std::cerr << "Failed to add client socket into epoll: " << strerror(errno) << std::endl;
+        load.connections--;
+        delete conn;
+        return;
+    }
+
+    connections.insert(conn);
+    load.pending += conn->Pending();
+}
+
+// See Worker.h
+void Worker::OnHandoff() {
+    for (auto &queue : inbox) {
+        Connection *conn;
+        while (queue->Pop(conn)) {
+            Adopt(conn);
+        }
+    }
+}
+
+// Target's counter is bumped before push, so it never sees a connection it doesn't account for
+// See Worker.h
+bool Worker::Handoff(Connection *conn, Worker *target) {
+    target->load.connections++;
+    if (!target->inbox[id]->Push(conn)) {
+        target->load.connections--;
+        return false;
+    }
+
+    uint64_t one = 1;
+    if (write(target->wakeup_fd, &one, sizeof(one)) != sizeof(one)) {
+        std::cerr << "Failed to wake up worker: " << strerror(errno) << std::endl;
+    }
+    return true;
+}
+
+// See Worker.h
+Worker *Worker::LeastLoaded() {
+    if (peers == nullptr) {
+        return nullptr;
+    }
+
+    Worker *result = nullptr;
+    uint32_t min_connections = 0;
+    uint64_t min_rate = 0;
+    for (auto &peer : *peers) {
+        if (&peer == this || !peer.running.load()) {
+            continue;
+        }
+
+        uint32_t connections = peer.load.connections.load();
+        uint64_t rate = peer.load.rate.load();
+        if (result == nullptr || connections < min_connections ||
+            (connections == min_connections && rate < min_rate)) {
+            result = &peer;
+            min_connections = connections;
+            min_rate = rate;
+        }
+    }
+    return result;
+}
+
+// Connections close unevenly, so counts drift apart even if new ones are spread fairly. Besides that
+// worker serving at least twice the traffic of the least loaded one gives away a connection even if it
+// has just one more: idle connection is usually a client waiting between requests, so its traffic moves too
+// See Worker.h
+void Worker::Rebalance() {
+    load.rate.store(traffic * 1000 / BalanceInterval.count());
+    traffic = 0;
+
+    Worker *target = LeastLoaded();
+    if (target == nullptr) {
+        return;
+    }
+
+    bool hot = load.rate.load() > 2 * target->load.rate.load();
+    size_t moved = 0;
+    for (auto it = connections.begin(); it != connections.end() && moved < MaxMigrations;) {
+        Connection *conn = *it++;
+
+        uint32_t own = load.connections.load();
+        uint32_t theirs = target->load.connections.load();
+        if (own <= theirs + 1 && !(hot && own > theirs && moved == 0)) {
+            break;
+        }
+
+        if (!conn->Idle()) {
+            continue;
+        }
+
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->Socket(), nullptr);
+        connections.erase(conn);
+        if (!Handoff(conn, target)) {
+            Adopt(conn);
+            break;
+        }
+        load.connections--;
+        moved++;
+    }
 }
 
 } // namespace NonBlocking
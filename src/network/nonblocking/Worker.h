@@ -1,9 +1,14 @@
 #ifndef AFINA_NETWORK_NONBLOCKING_WORKER_H
 #define AFINA_NETWORK_NONBLOCKING_WORKER_H
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <pthread.h>
-#include <atomic>
+#include <unordered_set>
+#include <vector>
+
+#include "SPSCQueue.h"
 
 namespace Afina {
 
@@ -13,18 +18,49 @@ class Storage;
 namespace Network {
 namespace NonBlocking {
 
+// Forward declaration, see Connection.h
+class Connection;
+
 /**
  * # Thread running epoll
  * On Start spaws background thread that is doing epoll on the given server
  * socket and process incoming connections and its data
+ *
+ * All sockets are registered in edge triggered mode. Each connection keeps its own parser state
+ * and output queue, so worker never waits for any single client and could multiplex thousands of
+ * them
+ *
+ * Workers of the same server publish their load and could hand connections over to each other. New
+ * connection goes to the worker having least connections, and once in a while overloaded worker moves
+ * its idle connections to the least loaded one. Connections are passed through a lock free queue per
+ * pair of workers, receiver is woken up by eventfd
  */
 class Worker {
 public:
-    Worker(std::shared_ptr<Afina::Storage> ps);
+    /**
+     * Load of the worker, written by the worker thread and read by the others to pick handoff target
+     */
+    struct Load {
+        // Connections owned by the worker including ones being handed over to it
+        std::atomic<uint32_t> connections;
+
+        // Bytes read and written per second during last balance interval
+        std::atomic<uint64_t> rate;
+
+        // Bytes queued for output across all connections
+        std::atomic<uint64_t> pending;
+    };
+
+    /**
+     * @param ps storage commands are executed on
+     * @param id index of the worker in peers
+     * @param peers all workers of the server, elements must not be moved once any of workers started
+     */
+    Worker(std::shared_ptr<Afina::Storage> ps, size_t id = 0, std::vector<Worker> *peers = nullptr);
     Worker(const Worker&) = delete;
     Worker& operator = (const Worker&) = delete;
     Worker(Worker&& w);
-    Worker& operator = (Worker&&) = default;
+    Worker& operator = (Worker&&) = delete;
     ~Worker();
 
     /**
@@ -48,23 +84,80 @@ public:
      */
     void Join();
 
+    const Load &GetLoad() const { return load; }
+
 protected:
     /**
      * Method executing by background thread
      */
-    void OnRun(void *args);
+    void OnRun();
     static void *OnRunWrapper(void *args);
 
 private:
+    /**
+     * Accepts all pending connections and registers them in epoll
+     */
+    void OnAccept();
+
+    /**
+     * Handles readiness of the client socket
+     */
+    void OnEvent(Connection *conn, uint32_t events);
+
+    /**
+     * Unregisters and destroys connection
+     */
+    void Close(Connection *conn);
+
+    /**
+     * Registers connection in epoll and starts to serve it
+     */
+    void Adopt(Connection *conn);
+
+    /**
+     * Adopts all connections handed over by peers
+     */
+    void OnHandoff();
+
+    /**
+     * Passes connection that isn't registered in epoll to the given peer. Returns false if peer's queue
+     * is full, connection stays with the caller then
+     */
+    bool Handoff(Connection *conn, Worker *target);
+
+    /**
+     * Returns running peer with the least connections, ties are broken by traffic rate. Returns
+     * nullptr if there are no peers
+     */
+    Worker *LeastLoaded();
+
+    /**
+     * Updates traffic rate and moves idle connections to the least loaded peer if this one has more
+     */
+    void Rebalance();
+
     std::shared_ptr<Afina::Storage> pStorage;
+    size_t id;
+    std::vector<Worker> *peers;
     pthread_t thread;
     int server_socket;
     std::atomic<bool> running;
-};
 
-struct args_t {
-    int socket;
-    void *this_ptr;
+    int epoll_fd;
+
+    // Written by Stop and by peers handing connections over to wake up the thread
+    int wakeup_fd;
+
+    // Connections owned by the worker, accessed by the worker thread only
+    std::unordered_set<Connection *> connections;
+
+    // Connections handed over by peers, queue per sender
+    std::vector<std::unique_ptr<SPSCQueue<Connection *>>> inbox;
+
+    Load load;
+
+    // Bytes transferred since last balance interval started
+    uint64_t traffic;
 };
 
 } // namespace NonBlocking
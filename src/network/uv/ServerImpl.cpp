@@ -6,13 +6,15 @@
 #include <sys/mman.h>
 
 #include <afina/Storage.h>
+#include <afina/execute/Stats.h>
 
 namespace Afina {
 namespace Network {
 namespace UV {
 
 // See Server.h
-ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps) : Server(ps) {}
+ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps, int executor_threads, Afina::Executor::Mode executor_mode)
+    : Server(ps), executor_threads(executor_threads), executor_mode(executor_mode), stats_source(0) {}
 
 // See Server.h
 ServerImpl::~ServerImpl() { assert(workers.size() == 0); }
@@ -27,8 +29,11 @@ void ServerImpl::Start(uint32_t port, uint16_t n_workers) {
         throw std::runtime_error("Failed to call uv_ip4_addr");
     }
 
+    executor.reset(new Afina::Executor("uv", executor_threads, executor_mode));
+    stats_source = Afina::Execute::Stats::AddSource(
+        [this](std::vector<std::pair<std::string, std::string>> &stats) { CollectStats(stats); });
     for (auto i = 0; i < n_workers; i++) {
-        workers.push_back(new Worker(pStorage));
+        workers.push_back(new Worker(pStorage, executor.get()));
         workers[i]->Start(address);
     }
 }
@@ -44,6 +49,25 @@ void ServerImpl::Stop() {
 void ServerImpl::Join() {
     for (auto worker : workers) {
         worker->Join();
+        delete worker;
+    }
+    workers.clear();
+
+    // Workers wait for their commands to complete, so nothing is left in the pool here
+    if (stats_source != 0) {
+        Afina::Execute::Stats::RemoveSource(stats_source);
+        stats_source = 0;
+    }
+    if (executor) {
+        executor->Stop(true);
+        executor.reset();
+    }
+}
+
+// See Server.h
+void ServerImpl::CollectStats(std::vector<std::pair<std::string, std::string>> &stats) const {
+    if (executor) {
+        executor->CollectStats(stats);
     }
 }
 
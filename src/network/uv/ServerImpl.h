@@ -4,6 +4,7 @@
 #include <memory>
 #include <vector>
 
+#include <afina/Executor.h>
 #include <afina/network/Server.h>
 
 #include "Worker.h"
@@ -15,11 +16,12 @@ namespace UV {
 
 /**
  * # Network resource manager implementation
- * Implementation on top of lib uv library
+ * Implementation on top of lib uv library, commands are executed by the thread pool shared by all workers
  */
 class ServerImpl : public Server {
 public:
-    ServerImpl(std::shared_ptr<Afina::Storage> ps);
+    ServerImpl(std::shared_ptr<Afina::Storage> ps, int executor_threads = 4,
+               Afina::Executor::Mode executor_mode = Afina::Executor::Mode::kSharedQueue);
     ~ServerImpl();
 
     // See Server.h
@@ -31,11 +33,34 @@ public:
     // See Server.h
     void Join() override;
 
+    // See Server.h
+    void CollectStats(std::vector<std::pair<std::string, std::string>> &stats) const override;
+
 protected:
     /**
      * List of all workers created for this instance of server
      */
     std::vector<Worker *> workers;
+
+    /**
+     * Number of threads executing commands
+     */
+    int executor_threads;
+
+    /**
+     * How executor threads share tasks
+     */
+    Afina::Executor::Mode executor_mode;
+
+    /**
+     * Thread pool executing commands, stopped once all workers are joined
+     */
+    std::unique_ptr<Afina::Executor> executor;
+
+    /**
+     * Executor metrics are reported by "stats" command while server is running
+     */
+    size_t stats_source;
 };
 
 } // namespace UV
@@ -7,6 +7,7 @@
 #include <sstream>
 #include <stdexcept>
 
+#include <afina/Executor.h>
 #include <afina/Storage.h>
 #include <afina/execute/Command.h>
 
@@ -53,6 +54,16 @@ template <typename T, typename... Types> struct delegate {
 
 void noop(uv_signal_t *handle, int signum) {}
 
+// See Worker.h
+Worker::~Worker() {
+    for (auto pconn : freeConnections) {
+        delete pconn;
+    }
+    for (auto task : freeTasks) {
+        delete task;
+    }
+}
+
 // See Worker.h
 void Worker::Start(const struct sockaddr_storage &address) {
     // Init loop
@@ -73,6 +84,15 @@ void Worker::Start(const struct sockaddr_storage &address) {
     }
     uvStopAsync.data = this;
 
+    // Init execution infrastructure
+    rc = uv_async_init(&uvLoop, &uvExecutionDone, delegate<Worker>::callback<&Worker::OnExecutionDone>);
+    if (rc != 0) {
+        std::stringstream ss;
+        ss << "Failed to call uv_async_init: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc);
+        throw std::runtime_error(ss.str());
+    }
+    uvExecutionDone.data = this;
+
     // Init signals
     rc = uv_signal_init(&uvLoop, &uvSigPipe);
     if (rc != 0) {
@@ -164,6 +184,7 @@ void Worker::OnRun() {
 // See Worker.h
 void Worker::OnStop(uv_async_t *async) {
     std::cout << "network debug:" << __PRETTY_FUNCTION__ << std::endl;
+    stopping = true;
 
     // Stop accept new incomming connections
     uv_close((uv_handle_t *)&uvStopAsync, delegate<Worker>::callback<&Worker::OnHandleClosed>);
@@ -176,8 +197,8 @@ void Worker::OnStop(uv_async_t *async) {
         conn->state = ConnectionState::sClosed;
         uv_read_stop((uv_stream_t *)conn);
 
-        // Try to close connections if possible
-        if (conn->runningTasks == 0) {
+        // Try to close connections if possible, the ones client has already closed are in progress
+        if (conn->runningTasks == 0 && !uv_is_closing((uv_handle_t *)conn)) {
             uv_close((uv_handle_t *)conn, delegate<Worker>::callback<&Worker::OnConnectionClosed>);
         }
     }
@@ -201,7 +222,7 @@ void Worker::OnConnectionClosed(uv_handle_t *h) {
     assert(pconn->runningTasks == 0);
 
     if (alive.erase(pconn) != 0) {
-        delete pconn;
+        ReleaseConnection(pconn);
     }
 
     // After all connections are closed, we could really close worker
@@ -214,6 +235,12 @@ void Worker::OnConnectionClosed(uv_handle_t *h) {
 // See Worker.h
 void Worker::CloseEventLoppIfPossible() {
     if (alive.empty()) {
+        // No connection left means no batch is running, so executor won't signal anymore
+        if (stopping && !uv_is_closing((uv_handle_t *)&uvExecutionDone)) {
+            std::lock_guard<std::mutex> lock(completedLock);
+            uv_close((uv_handle_t *)&uvExecutionDone, delegate<Worker>::callback<&Worker::OnHandleClosed>);
+        }
+
         // Loop can't be closed until at least one handler exists, so even code
         // below executed each time last connection closed it wont leads to
         // event loop close until there are onStopAsync,SigPipe and uvNetwork
@@ -229,7 +256,7 @@ void Worker::CloseEventLoppIfPossible() {
 void Worker::OnConnectionOpen(uv_stream_t *server, int status) {
     std::cout << "network debug:" << __PRETTY_FUNCTION__ << std::endl;
     // Allocate new connection from the memory pool
-    Connection *pconn = new Connection;
+    Connection *pconn = AcquireConnection();
     alive.insert(pconn);
 
     // Init connection
@@ -240,7 +267,7 @@ void Worker::OnConnectionOpen(uv_stream_t *server, int status) {
     int rc = uv_accept(server, (uv_stream_t *)pconn);
     if (rc != 0) {
         std::cerr << "Failed to call uv_accept: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc);
-        uv_close((uv_handle_t *)(pconn), delegate<Worker>::callback<&Worker::OnHandleClosed>);
+        uv_close((uv_handle_t *)(pconn), delegate<Worker>::callback<&Worker::OnConnectionClosed>);
         return;
     }
 
@@ -249,28 +276,22 @@ void Worker::OnConnectionOpen(uv_stream_t *server, int status) {
                        delegate<Worker, ssize_t, const uv_buf_t *>::callback<&Worker::OnRead>);
     if (rc != 0) {
         std::cerr << "Failed to call uv_read_start: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc);
-        uv_close((uv_handle_t *)(pconn), delegate<Worker>::callback<&Worker::OnHandleClosed>);
+        uv_close((uv_handle_t *)(pconn), delegate<Worker>::callback<&Worker::OnConnectionClosed>);
         return;
     }
 }
 
 // Just before read, libuv calls that method to allocate some memory chunk where read copies socket data.
-// We are always allocate memorythere until all incoming data fits, parse it and deallocate buffer just after that.
+// It is the free space of the connection ring buffer, so unparsed data stays where it is
 // See Worker.h
 void Worker::OnAllocate(uv_handle_t *conn, size_t suggested_size, uv_buf_t *buf) {
     assert(conn);
 
     Connection *pconn = (Connection *)(conn);
-    assert(pconn->input_parsed <= pconn->input_used);
 
-    size_t unparsed = pconn->input_used - pconn->input_parsed;
-    std::memmove(pconn->input, pconn->input + pconn->input_parsed, unparsed);
-
-    pconn->input_parsed = 0;
-    pconn->input_used = unparsed;
-
-    buf->base = &pconn->input[unparsed];
-    buf->len = ConnectionInputBufferSize - unparsed;
+    size_t free = 0;
+    buf->base = pconn->input.WriteSpace(free);
+    buf->len = free;
 }
 
 // Once soket is ready to give some bytes back to application libuv calls that method,
@@ -282,159 +303,170 @@ void Worker::OnRead(uv_stream_t *conn, ssize_t nread, const uv_buf_t *buf) {
     assert(conn != nullptr);
     Connection *pconn = (Connection *)(conn);
 
-    // negative nread indicates that socket has been closed
+    // negative nread indicates that socket has been closed, connection itself is released once commands
+    // already received are complete
     if (nread < 0) {
-        uv_close((uv_handle_t *)(pconn), delegate<Worker>::callback<&Worker::OnConnectionClosed>);
+        pconn->state = ConnectionState::sClosed;
+        uv_read_stop(conn);
+        if (pconn->runningTasks == 0) {
+            uv_close((uv_handle_t *)(pconn), delegate<Worker>::callback<&Worker::OnConnectionClosed>);
+        }
         return;
     } else if (pconn->state == ConnectionState::sClosed) {
         return;
     }
 
-    // Look for the command delimeters in the [parsed, input.size()). Note that buffer could contains
-    // many commands, not only one
+    // Feed framer with the buffered data. Note that buffer could contains many commands, not only one, and
+    // the last of them could be incomplete, it stays in the buffer until the rest of it arrives
     try {
-        pconn->input_used += nread;
-        while (pconn->input_parsed < pconn->input_used) {
-            // Read header or body if needs
-            if (pconn->state == ConnectionState::sRecvHeader) {
-                // Try to parse command out
-                if (!pconn->parser.Parse(pconn->input, pconn->input_used, pconn->input_parsed)) {
-                    continue;
-                }
-
-                // Command has been parsed form input
-                pconn->cmd = pconn->parser.Build(pconn->body_size);
-
-                // Command has argument that needs to be read from the network connection before execution could take
-                // place
-                if (pconn->body_size > 0) {
-                    pconn->body.clear();
-                    pconn->state = ConnectionState::sRecvBody;
-                } else {
-                    pconn->state = ConnectionState::sExecute;
-                }
-            } else if (pconn->state == ConnectionState::sRecvBody) {
-                size_t for_copy = std::min(uint32_t(pconn->input_used - pconn->input_parsed), pconn->body_size);
-                pconn->body.append(pconn->input + pconn->input_parsed, for_copy);
-
-                pconn->body_size -= for_copy;
-                pconn->input_parsed += for_copy;
-
-                if (pconn->body_size == 0) {
-                    pconn->state = ConnectionState::sRecvTrailerCR;
-                }
-            } else if (pconn->state == ConnectionState::sRecvTrailerCR) {
-                if (pconn->input[pconn->input_parsed] != '\r') {
-                    throw std::runtime_error("Invalid chat, \\r expected");
-                }
-                pconn->input_parsed++;
-                pconn->state = ConnectionState::sRecvTrailerLF;
-            } else if (pconn->state == ConnectionState::sRecvTrailerLF) {
-                if (pconn->input[pconn->input_parsed] != '\n') {
-                    throw std::runtime_error("Invalid chat, \\n expected");
-                }
-                pconn->input_parsed++;
-                pconn->state = ConnectionState::sExecute;
-            }
-
-            if (pconn->state == ConnectionState::sExecute) {
+        pconn->input.Produce(nread);
+        while (!pconn->input.Empty()) {
+            size_t available = 0, consumed = 0;
+            const char *data = pconn->input.ReadSpace(available);
+            bool complete = pconn->framer.Feed(data, available, consumed);
+            pconn->input.Consume(consumed);
+
+            if (complete) {
                 Execute(*pconn);
-
-                pconn->cmd.reset();
-                pconn->body.clear();
-                pconn->parser.Reset();
-                pconn->state = ConnectionState::sRecvHeader;
+                pconn->framer.Reset();
             }
         }
     } catch (std::runtime_error &ex) {
-        // Parser throws exception in case if something goes wrong with input data format
-        // TODO: That code duplicates too much of OnExecutionDone - refactor
+        // Parser throws exception in case if something goes wrong with input data format. Error is queued
+        // as a task without command, so it is sent after results of commands parsed before
         std::stringstream ss;
         ss << "CLIENT_ERROR " << ex.what();
 
-        std::string output = ss.str();
+        ss << "\r\n";
 
-        ExecuteTask *ptask = new ExecuteTask();
-        ptask->connection = pconn;
-        uv_async_init(&uvLoop, &ptask->done, delegate<Worker>::callback<&Worker::OnExecutionDone>);
-        ptask->done.data = this;
-
-        size_t size = output.size() + 2;
-        ptask->result.base = new char[size];
-        ptask->result.len = size;
-
-        std::memcpy(ptask->result.base, &output[0], size - 2);
-        ptask->result.base[size - 2] = '\r';
-        ptask->result.base[size - 1] = '\n';
+        ExecuteTask *ptask = AcquireTask(pconn);
+        ptask->result.Append(ss.str());
 
         pconn->runningTasks++;
+        pconn->queued.push_back(ptask);
         pconn->state = ConnectionState::sClosed;
-        OnExecutionDone(&ptask->done);
+        uv_read_stop(conn);
     }
+
+    Submit(*pconn);
 }
 
+// Command is only queued here, all commands parsed out from the same read are submitted together
 // See Worker.h
 void Worker::Execute(Connection &pconn) {
     std::cout << "network debug:" << __PRETTY_FUNCTION__ << std::endl;
 
-    // Setup execution params
-    ExecuteTask *ptask = new ExecuteTask();
-    ptask->connection = &pconn;
-    ptask->cmd = std::move(pconn.cmd);
-    ptask->argument = std::move(pconn.body);
+    // Setup execution params. Argument buffers are swapped, so connection gets back capacity of a released task
+    ExecuteTask *ptask = AcquireTask(&pconn);
+    ptask->cmd = std::move(pconn.framer.Command());
+    ptask->argument.swap(pconn.framer.Body());
+
     pconn.runningTasks++;
+    pconn.queued.push_back(ptask);
+}
 
-    // Setup async signal to be called once task execution is complete
-    int rc = uv_async_init(&uvLoop, &ptask->done, delegate<Worker>::callback<&Worker::OnExecutionDone>);
-    if (rc != 0) {
-        throw std::runtime_error("Failed to call uv_async_init for the task");
+// See Worker.h
+void Worker::Submit(Connection &pconn) {
+    if (pconn.executing || pconn.queued.empty()) {
+        return;
     }
-    ptask->done.data = this;
 
-    // TODO: That should be in another thread
-    {
-        std::string output;
+    // Batch is empty once previous one is complete
+    pconn.batch.swap(pconn.queued);
+    pconn.executing = true;
+
+    // Executor is stopped only after all workers are joined, but don't lose commands if it refuses anyway
+    Connection *conn = &pconn;
+    if (!pExecutor->Execute([this, conn]() { RunBatch(conn); })) {
+        RunBatch(conn);
+    }
+}
+
+// See Worker.h
+void Worker::RunBatch(Connection *pconn) {
+    for (auto task : pconn->batch) {
+        if (!task->cmd) {
+            continue;
+        }
+
         try {
-            ptask->cmd->Execute(*pStorage, ptask->argument, output);
+            task->cmd->Execute(*pStorage, task->argument, task->result);
         } catch (std::runtime_error &ex) {
             std::cerr << "Failed to execute command: " << ex.what() << std::endl;
 
             std::stringstream ss;
-            ss << "SERVER_ERROR " << ex.what();
-            output = ss.str();
+            ss << "SERVER_ERROR " << ex.what() << "\r\n";
+            task->result.Clear();
+            task->result.Append(ss.str());
         }
-
-        // Prepare output
-        size_t size = output.size() + 2;
-        ptask->result.base = new char[size];
-        ptask->result.len = size;
-
-        std::memcpy(ptask->result.base, &output[0], size - 2);
-        ptask->result.base[size - 2] = '\r';
-        ptask->result.base[size - 1] = '\n';
-
-        // Notify event loop about task completition
-        uv_async_send(&ptask->done);
     }
+
+    // Notify event loop about batch completition. Once lock is released loop could complete the batch, close
+    // the connection and the async handle, so signal is sent before that
+    std::lock_guard<std::mutex> lock(completedLock);
+    completed.push_back(pconn);
+    uv_async_send(&uvExecutionDone);
 }
 
 // See Worker.h
 void Worker::OnExecutionDone(uv_async_t *handle) {
     std::cout << "network debug:" << __PRETTY_FUNCTION__ << std::endl;
 
-    assert(handle);
-    ExecuteTask *task = (ExecuteTask *)((uint8_t *)handle - offsetof(ExecuteTask, done));
-    assert(&task->done == handle);
+    {
+        std::lock_guard<std::mutex> lock(completedLock);
+        completedScratch.swap(completed);
+    }
+
+    // Results are written in order, then next batch of the connection is started. Write completion could
+    // release connection only after its last task, so connection stays valid here
+    for (auto pconn : completedScratch) {
+        batchScratch.swap(pconn->batch);
+        pconn->executing = false;
 
-    // We don't need async anymore
-    uv_close((uv_handle_t *)&task->done, delegate<Worker>::callback<&Worker::OnHandleClosed>);
+        Submit(*pconn);
+        SendResults(batchScratch);
+        batchScratch.clear();
+    }
+    completedScratch.clear();
+}
+
+// Tasks of the batch are chained behind the first one, which owns write request and the buffer list
+// See Worker.h
+void Worker::SendResults(const std::vector<ExecuteTask *> &batch) {
+    ExecuteTask *head = batch.front();
+    head->buffers.clear();
+
+    // Response chunks point either to the task own buffer or to the pinned values, so they are
+    // passed to the socket as is
+    for (size_t i = 0; i < batch.size(); i++) {
+        ExecuteTask *task = batch[i];
+        task->next = (i + 1 < batch.size()) ? batch[i + 1] : nullptr;
+
+        for (size_t j = 0; j < task->result.Chunks(); j++) {
+            const char *data;
+            size_t size;
+            task->result.Chunk(j, data, size);
+            head->buffers.push_back(uv_buf_init(const_cast<char *>(data), size));
+        }
+    }
+
+    // Nothing to send if all commands were noreply, batch is complete right away
+    if (head->buffers.empty()) {
+        OnWriteDone(&head->handler, 0);
+        return;
+    }
 
     // Send buffer to socket. Even if connection is already closed we are still try to write data out,
     // that would lead to possible write error which is ok and will be handled in the OnWriteDone
-    int rc = uv_write(&task->handler, &task->connection->handler, &task->result, 1,
+    head->handler.data = this;
+    int rc = uv_write(&head->handler, &head->connection->handler, head->buffers.data(), head->buffers.size(),
                       delegate<Worker, int>::callback<&Worker::OnWriteDone>);
     if (rc != 0) {
-        throw std::runtime_error("Failed to write request");
+        // Request wasn't queued, so it is completed right away with the error, that releases tasks and
+        // closes the connection. Exception must not escape to libuv
+        std::cerr << "Failed to call uv_write: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc)
+                  << std::endl;
+        OnWriteDone(&head->handler, rc);
     }
 }
 
@@ -445,13 +477,75 @@ void Worker::OnWriteDone(uv_write_t *req, int status) {
     ExecuteTask *task = (ExecuteTask *)req;
     Connection *pconn = task->connection;
 
-    task->connection->runningTasks--;
-    if (task->connection->state == ConnectionState::sClosed && task->connection->runningTasks == 0) {
-        uv_close((uv_handle_t *)(task->connection), delegate<Worker>::callback<&Worker::OnConnectionClosed>);
+    // Client won't get the rest of responses, so nothing more is read from it
+    if (status < 0 && pconn->state != ConnectionState::sClosed) {
+        pconn->state = ConnectionState::sClosed;
+        uv_read_stop(&pconn->handler);
+    }
+
+    while (task != nullptr) {
+        ExecuteTask *next = task->next;
+        pconn->runningTasks--;
+        ReleaseTask(task);
+        task = next;
+    }
+
+    if (pconn->state == ConnectionState::sClosed && pconn->runningTasks == 0) {
+        uv_close((uv_handle_t *)(pconn), delegate<Worker>::callback<&Worker::OnConnectionClosed>);
+    }
+}
+
+// See Worker.h
+Worker::Connection *Worker::AcquireConnection() {
+    if (freeConnections.empty()) {
+        return new Connection;
+    }
+
+    Connection *pconn = freeConnections.back();
+    freeConnections.pop_back();
+    return pconn;
+}
+
+// See Worker.h
+void Worker::ReleaseConnection(Connection *pconn) {
+    if (freeConnections.size() >= MaxPooledConnections) {
+        delete pconn;
+        return;
+    }
+
+    pconn->Reset();
+    freeConnections.push_back(pconn);
+}
+
+// See Worker.h
+Worker::ExecuteTask *Worker::AcquireTask(Connection *pconn) {
+    ExecuteTask *task;
+    if (freeTasks.empty()) {
+        task = new ExecuteTask();
+    } else {
+        task = freeTasks.back();
+        freeTasks.pop_back();
+    }
+
+    task->connection = pconn;
+    return task;
+}
+
+// Result is cleared rather than destroyed, so its text buffer is reused by the next command
+// See Worker.h
+void Worker::ReleaseTask(ExecuteTask *task) {
+    if (freeTasks.size() >= MaxPooledTasks) {
+        delete task;
+        return;
     }
 
-    delete[] task->result.base;
-    delete task;
+    task->connection = nullptr;
+    task->next = nullptr;
+    task->cmd.reset();
+    task->argument.clear();
+    task->result.Clear();
+    task->buffers.clear();
+    freeTasks.push_back(task);
 }
 
 } // namespace UV
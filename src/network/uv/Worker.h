@@ -1,15 +1,18 @@
 #ifndef AFINA_NETWORK_UV_WORKER_H
 #define AFINA_NETWORK_UV_WORKER_H
 
+#include <mutex>
 #include <string>
 #include <unordered_set>
 #include <uv.h>
 #include <vector>
 
 #include <afina/execute/Command.h>
-#include <protocol/Parser.h>
+#include <afina/execute/Response.h>
+#include <protocol/Framing.h>
 
 namespace Afina {
+class Executor;
 class Storage;
 namespace Execute {
 class Command;
@@ -21,11 +24,23 @@ namespace UV {
  * # Basic network data processor
  * Reads and writes byte streams from/to clients, parse protocol and submit commands to the execution. Implements
  * logic protocol
+ *
+ * Commands are executed on the executor thread pool, so slow command doesn't block network io of the other
+ * connections. Commands of the same connection are executed one after another in order they are received:
+ * everything parsed out from a single read is passed to the pool as one batch, next batch is submitted once
+ * previous is complete. Completed batches are collected in a list and event loop is woken up by a single async
+ * handle, libuv coalesces wake ups sent while loop is busy. Responses of the whole batch are sent by a single
+ * vectored write, so pipelining client costs one syscall per batch rather than per command
+ *
+ * Tasks and connections are recycled through per loop free lists. Released objects keep buffers they have
+ * grown: input buffer, command argument, response text and chunk vectors, so once pools are warmed up the
+ * request path doesn't touch the heap besides command object built by the parser
  */
 class Worker {
 public:
-    Worker(std::shared_ptr<Afina::Storage> pStorage) : pStorage(pStorage) {}
-    ~Worker() {}
+    Worker(std::shared_ptr<Afina::Storage> pStorage, Afina::Executor *pExecutor)
+        : stopping(false), pStorage(pStorage), pExecutor(pExecutor) {}
+    ~Worker();
 
     Worker(const Worker &) = delete;
     Worker &operator=(const Worker &) = delete;
@@ -47,34 +62,37 @@ public:
      */
     void Join();
 
+    /**
+     * Number of connections and tasks kept in the pools for reuse. Once worker is joined every object
+     * it allocated is back in the pool, unless the pool was full. Must not be called while worker runs
+     */
+    size_t PooledConnections() const { return freeConnections.size(); }
+    size_t PooledTasks() const { return freeTasks.size(); }
+
 protected:
     // Size of input buffer
     const static size_t ConnectionInputBufferSize = 64 * 1024L;
 
+    // Maximum number of released connections kept for reuse
+    const static size_t MaxPooledConnections = 256;
+
+    // Maximum number of released tasks kept for reuse
+    const static size_t MaxPooledTasks = 4096;
+
     // Determinates how connection reacts on different async events, such as
     // new input data or command execution complete
     enum ConnectionState : uint8_t {
-        // Command header expected, i.e input stream must be read until header end
-        // marker found
-        sRecvHeader,
-
-        // Data block expected, i.e read until all neccessary bytes consumed
-        sRecvBody,
-
-        // Data block received and \r trailer expected
-        sRecvTrailerCR,
-
-        // Data block received and \n trailer expected
-        sRecvTrailerLF,
-
-        // Command was parsed out, time to execute it
-        sExecute,
+        // Commands are read from the input stream and executed
+        sRecvCommand,
 
         // Connection has been requested to shutdown. It still flys around as wasn't completely
         // cleanup yet.
         sClosed
     };
 
+    // Forward declaration, see below
+    struct ExecuteTask;
+
     /**
      * Holds information about single connection from the client
      */
@@ -86,38 +104,38 @@ protected:
         // Current connection state, defines how buffered data processed
         ConnectionState state;
 
-        // Buffer for input
-        char *input;
+        // Buffer for input, socket is read right into its free space
+        Protocol::RingBuffer input;
 
-        // HOw many bytes in input buffer if already used
-        size_t input_used;
+        // Splits input into commands and their arguments
+        Protocol::Framer framer;
 
-        // How many bytes from input has been parsed already
-        size_t input_parsed;
-
-        // State of the header parser
-        Protocol::Parser parser;
+        // Number of tasks that are running now
+        size_t runningTasks;
 
-        // Command parsed out from the input
-        std::unique_ptr<Execute::Command> cmd;
+        // Tasks parsed out but not yet passed to the executor
+        std::vector<ExecuteTask *> queued;
 
-        // Number of bytes left to read to get command
-        uint32_t body_size;
+        // Tasks being executed by the executor, accessed by the pool thread until batch is complete
+        std::vector<ExecuteTask *> batch;
 
-        // Argument for the command
-        std::string body;
-
-        // Number of tasks that are running now
-        size_t runningTasks;
+        // True while batch is owned by the executor
+        bool executing;
 
         Connection()
-            : state(ConnectionState::sRecvHeader), input(nullptr), input_used(0), input_parsed(0), cmd(nullptr),
-              body_size(0), body(""), runningTasks(0) {
-            input = new char[ConnectionInputBufferSize];
-            parser.Reset();
+            : state(ConnectionState::sRecvCommand), input(ConnectionInputBufferSize), runningTasks(0),
+              executing(false) {}
+
+        /**
+         * Brings connection to the initial state keeping allocated buffers
+         */
+        void Reset() {
+            state = ConnectionState::sRecvCommand;
+            input.Clear();
+            framer.Restart();
+            runningTasks = 0;
+            executing = false;
         }
-
-        ~Connection() { delete[] input; }
     } Connection;
 
     /**
@@ -125,23 +143,27 @@ protected:
      * some command
      */
     typedef struct ExecuteTask {
-        // Write handler, used to send this task through the libuv write pipeline
+        // Write handler, used to send this task through the libuv write pipeline. Only the first task of a
+        // batch is passed to uv_write, it writes results of the whole batch
         uv_write_t handler;
 
-        // Async signal to be called once task execution is complete
-        uv_async_t done;
+        // Next task of the same batch, written out by the same request
+        struct ExecuteTask *next;
 
         // Connection that received command, used to write out response
         Connection *connection;
 
-        // Command to execute
+        // Command to execute, nullptr if result is already known
         std::unique_ptr<Execute::Command> cmd;
 
         // Argument for the command
         std::string argument;
 
-        // Execution result
-        uv_buf_t result;
+        // Execution result, values are referenced until write is complete
+        Execute::Response result;
+
+        // Chunks of results of the whole batch passed to uv_write
+        std::vector<uv_buf_t> buffers;
     } ExecuteTask;
 
     /**
@@ -194,12 +216,47 @@ protected:
     void Execute(Connection &pconn);
 
     /**
-     * Called once command execution is complete
+     * Passes all queued tasks of the connection to the executor, unless previous batch is still running
+     */
+    void Submit(Connection &pconn);
+
+    /**
+     * Runs on the executor: executes connection batch and notifies event loop
+     */
+    void RunBatch(Connection *pconn);
+
+    /**
+     * Called once some batches execution is complete
      */
     void OnExecutionDone(uv_async_t *handle);
 
     /**
-     * Called by libuv once ExecuteTask output buffer has been written to the output connection
+     * Writes results of the batch out to the connection by a single write request, in order
+     */
+    void SendResults(const std::vector<ExecuteTask *> &batch);
+
+    /**
+     * Takes connection from the pool or allocates new one
+     */
+    Connection *AcquireConnection();
+
+    /**
+     * Returns closed connection to the pool
+     */
+    void ReleaseConnection(Connection *pconn);
+
+    /**
+     * Takes task from the pool or allocates new one
+     */
+    ExecuteTask *AcquireTask(Connection *pconn);
+
+    /**
+     * Returns task which result is written out to the pool
+     */
+    void ReleaseTask(ExecuteTask *task);
+
+    /**
+     * Called by libuv once output buffers of the batch have been written to the output connection
      */
     void OnWriteDone(uv_write_t *req, int status);
 
@@ -234,6 +291,39 @@ private:
      */
     uv_async_t uvStopAsync;
 
+    /**
+     * Async used by executor threads to notify event loop about completed batches
+     */
+    uv_async_t uvExecutionDone;
+
+    /**
+     * Connections which batches are complete, filled by executor threads
+     */
+    std::vector<Connection *> completed;
+
+    /**
+     * Protects completed. Executor threads also signal uvExecutionDone under it and the loop closes that
+     * handle under it, so the handle is never signaled once closed
+     */
+    std::mutex completedLock;
+
+    /**
+     * Swapped with completed and with connection batches by the loop, kept to reuse their capacity
+     */
+    std::vector<Connection *> completedScratch;
+    std::vector<ExecuteTask *> batchScratch;
+
+    /**
+     * Released objects ready for reuse, accessed by the loop thread only
+     */
+    std::vector<Connection *> freeConnections;
+    std::vector<ExecuteTask *> freeTasks;
+
+    /**
+     * Set once stop is requested, execution async gets closed after that with the last connection
+     */
+    bool stopping;
+
     /**
      * TCP/IP socket used by server to listen for incomming connection
      */
@@ -249,6 +339,11 @@ private:
      * Storage instance to execute commands on
      */
     std::shared_ptr<Afina::Storage> pStorage;
+
+    /**
+     * Thread pool to execute commands on, shared by all workers of the server
+     */
+    Afina::Executor *pExecutor;
 };
 
 } // namespace UV
@@ -0,0 +1,522 @@
+#include "BinaryParser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <afina/Storage.h>
+#include <afina/Value.h>
+#include <afina/execute/Add.h>
+#include <afina/execute/Append.h>
+#include <afina/execute/Cas.h>
+#include <afina/execute/Command.h>
+#include <afina/execute/Decr.h>
+#include <afina/execute/Delete.h>
+#include <afina/execute/Incr.h>
+#include <afina/execute/InsertCommand.h>
+#include <afina/execute/Prepend.h>
+#include <afina/execute/Replace.h>
+#include <afina/execute/Response.h>
+#include <afina/execute/Set.h>
+#include <afina/execute/Stats.h>
+#include <afina/execute/Touch.h>
+
+namespace Afina {
+namespace Protocol {
+
+using Execute::Response;
+typedef BinaryParser::Opcode Opcode;
+typedef BinaryParser::Status Status;
+
+const uint8_t BinaryParser::RequestMagic;
+const uint8_t BinaryParser::ResponseMagic;
+const size_t BinaryParser::HeaderSize;
+
+// Expiration of incr/decr telling that missing item must not be created
+static const uint32_t NoInitialValue = 0xffffffff;
+
+static uint16_t Load16(const char *p) {
+    const unsigned char *u = reinterpret_cast<const unsigned char *>(p);
+    return uint16_t((u[0] << 8) | u[1]);
+}
+
+static uint32_t Load32(const char *p) { return (uint32_t(Load16(p)) << 16) | Load16(p + 2); }
+
+static uint64_t Load64(const char *p) { return (uint64_t(Load32(p)) << 32) | Load32(p + 4); }
+
+static void Store(std::string &out, uint64_t value, size_t bytes) {
+    for (size_t i = bytes; i > 0; i--) {
+        out.push_back(char((value >> (8 * (i - 1))) & 0xff));
+    }
+}
+
+static bool IsQuiet(Opcode opcode) {
+    switch (opcode) {
+    case Opcode::kGetQ:
+    case Opcode::kGetKQ:
+    case Opcode::kSetQ:
+    case Opcode::kAddQ:
+    case Opcode::kReplaceQ:
+    case Opcode::kDeleteQ:
+    case Opcode::kIncrementQ:
+    case Opcode::kDecrementQ:
+    case Opcode::kAppendQ:
+    case Opcode::kPrependQ:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static const char *Message(Status status) {
+    switch (status) {
+    case Status::kKeyNotFound:
+        return "Not found";
+    case Status::kKeyExists:
+        return "Data exists for key";
+    case Status::kValueTooLarge:
+        return "Too large";
+    case Status::kInvalidArguments:
+        return "Invalid arguments";
+    case Status::kNotStored:
+        return "Not stored";
+    case Status::kNonNumeric:
+        return "Non-numeric server-side value for incr or decr";
+    case Status::kUnknownCommand:
+        return "Unknown command";
+    default:
+        return "";
+    }
+}
+
+// Maps result of the text protocol command, not_stored tells what NOT_STORED means for the command
+static Status StatusOf(const std::string &result, Status not_stored) {
+    if (result == "STORED" || result == "DELETED" || result == "TOUCHED") {
+        return Status::kOk;
+    } else if (result == "NOT_FOUND") {
+        return Status::kKeyNotFound;
+    } else if (result == "EXISTS") {
+        return Status::kKeyExists;
+    } else if (result == "NOT_STORED") {
+        return not_stored;
+    }
+    return Status::kNonNumeric;
+}
+
+/**
+ * Request of the binary protocol. Storage is changed by the text protocol command built for the request,
+ * so both protocols behave the same, its result is encoded as a binary response
+ */
+class BinaryCommand : public Afina::Execute::Command {
+public:
+    BinaryCommand(Opcode opcode, uint32_t opaque, uint64_t cas, const std::string &key)
+        : opcode(opcode), status(Status::kOk), opaque(opaque), cas(cas), key(key), flags(0), expiration(0),
+          delta(0), initial(0) {}
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override {
+        Response response;
+        Execute(storage, args, response);
+        out = response.ToString();
+    }
+
+    void Execute(Storage &storage, const std::string &args, Response &out) override;
+
+    // Header fields of the request
+    const Opcode opcode;
+    Status status;
+    const uint32_t opaque;
+    const uint64_t cas;
+    const std::string key;
+
+    // Extras of the request
+    uint32_t flags;
+    uint32_t expiration;
+    uint64_t delta;
+    uint64_t initial;
+
+private:
+    /**
+     * Appends response unless request is quiet and succeed, failed response carries error message
+     */
+    void Reply(Response &out, Status result, const std::string &value = "", uint64_t result_cas = 0) const;
+
+    void Get(Storage &storage, Response &out) const;
+    void Arithmetic(Storage &storage, Response &out) const;
+    void Stat(Storage &storage, Response &out) const;
+};
+
+// See BinaryParser.h
+void BinaryParser::EncodeHeader(std::string &out, Opcode opcode, Status status, uint8_t extras_size,
+                                uint16_t key_size, uint32_t body_size, uint32_t opaque, uint64_t cas) {
+    out.push_back(char(ResponseMagic));
+    out.push_back(char(opcode));
+    Store(out, key_size, 2);
+    out.push_back(char(extras_size));
+    out.push_back(0); // data type
+    Store(out, uint16_t(status), 2);
+    Store(out, body_size, 4);
+    Store(out, opaque, 4);
+    Store(out, cas, 8);
+}
+
+void BinaryCommand::Reply(Response &out, Status result, const std::string &value, uint64_t result_cas) const {
+    if (result == Status::kOk && IsQuiet(opcode)) {
+        return;
+    }
+
+    const std::string &body = (result == Status::kOk) ? value : std::string(Message(result));
+    std::string header;
+    BinaryParser::EncodeHeader(header, opcode, result, 0, 0, body.size(), opaque, result_cas);
+    out.Append(header);
+    out.Append(body);
+}
+
+// Value is passed to the output by reference, as for text get
+void BinaryCommand::Get(Storage &storage, Response &out) const {
+    Value value;
+    bool with_key = (opcode == Opcode::kGetK || opcode == Opcode::kGetKQ);
+    if (!storage.GetValue(key, value)) {
+        if (opcode == Opcode::kGetQ || opcode == Opcode::kGetKQ) {
+            return;
+        }
+
+        std::string message = Message(Status::kKeyNotFound);
+        std::string header;
+        BinaryParser::EncodeHeader(header, opcode, Status::kKeyNotFound, 0, with_key ? key.size() : 0,
+                                   (with_key ? key.size() : 0) + message.size(), opaque, 0);
+        out.Append(header);
+        if (with_key) {
+            out.Append(key);
+        }
+        out.Append(message);
+        return;
+    }
+
+    // Storage doesn't keep flags, extras are always zero as in text responses
+    std::string header;
+    size_t key_size = with_key ? key.size() : 0;
+    BinaryParser::EncodeHeader(header, opcode, Status::kOk, 4, key_size, 4 + key_size + value.size(), opaque,
+                               Afina::Execute::Cas::Unique(value.data(), value.size()));
+    Store(header, 0, 4);
+    if (with_key) {
+        header += key;
+    }
+    out.Append(header);
+    out.Append(value);
+}
+
+// Missing item is created with the initial value unless expiration tells otherwise
+void BinaryCommand::Arithmetic(Storage &storage, Response &out) const {
+    bool increment = (opcode == Opcode::kIncrement || opcode == Opcode::kIncrementQ);
+    std::unique_ptr<Afina::Execute::Command> cmd;
+    if (increment) {
+        cmd.reset(new Afina::Execute::Incr(key, delta));
+    } else {
+        cmd.reset(new Afina::Execute::Decr(key, delta));
+    }
+
+    std::string result;
+    cmd->Execute(storage, "", result);
+    if (result == "NOT_FOUND" && expiration != NoInitialValue) {
+        uint32_t ttl = 0;
+        std::string value = std::to_string(initial);
+        bool alive = Afina::Execute::InsertCommand::TimeToLive(int32_t(expiration), ttl);
+        if (alive && storage.PutIfAbsent(key, value, ttl)) {
+            result = value;
+        } else {
+            cmd->Execute(storage, "", result);
+        }
+    }
+
+    if (result.empty() || result[0] < '0' || result[0] > '9') {
+        Reply(out, StatusOf(result, Status::kNotStored));
+        return;
+    }
+
+    std::string value;
+    Store(value, std::stoull(result), 8);
+    Reply(out, Status::kOk, value, Afina::Execute::Cas::Unique(result.data(), result.size()));
+}
+
+// Each "STAT <name> <value>" line becomes a response with the key and the value, the last one is empty
+void BinaryCommand::Stat(Storage &storage, Response &out) const {
+    Afina::Execute::Stats stats;
+    std::string text;
+    stats.Execute(storage, "", text);
+
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.compare(0, 5, "STAT ") != 0) {
+            continue;
+        }
+
+        size_t space = line.find(' ', 5);
+        std::string name = line.substr(5, space == std::string::npos ? std::string::npos : space - 5);
+        std::string value = (space == std::string::npos) ? "" : line.substr(space + 1);
+
+        std::string header;
+        BinaryParser::EncodeHeader(header, opcode, Status::kOk, 0, name.size(), name.size() + value.size(), opaque,
+                                   0);
+        out.Append(header);
+        out.Append(name);
+        out.Append(value);
+    }
+    Reply(out, Status::kOk);
+}
+
+// See BinaryParser.h
+void BinaryCommand::Execute(Storage &storage, const std::string &args, Response &out) {
+    if (status != Status::kOk) {
+        Reply(out, status);
+        return;
+    }
+
+    std::unique_ptr<Afina::Execute::Command> cmd;
+    Status not_stored = Status::kNotStored;
+    switch (opcode) {
+    case Opcode::kGet:
+    case Opcode::kGetQ:
+    case Opcode::kGetK:
+    case Opcode::kGetKQ:
+        Get(storage, out);
+        return;
+
+    case Opcode::kIncrement:
+    case Opcode::kIncrementQ:
+    case Opcode::kDecrement:
+    case Opcode::kDecrementQ:
+        Arithmetic(storage, out);
+        return;
+
+    case Opcode::kStat:
+        Stat(storage, out);
+        return;
+
+    case Opcode::kNoop:
+        Reply(out, Status::kOk);
+        return;
+
+    // Non zero cas makes update conditional, as cas command of the text protocol
+    case Opcode::kSet:
+    case Opcode::kSetQ:
+        if (cas != 0) {
+            cmd.reset(new Afina::Execute::Cas(key, flags, int32_t(expiration), cas));
+        } else {
+            cmd.reset(new Afina::Execute::Set(key, flags, int32_t(expiration)));
+        }
+        break;
+
+    case Opcode::kReplace:
+    case Opcode::kReplaceQ:
+        if (cas != 0) {
+            cmd.reset(new Afina::Execute::Cas(key, flags, int32_t(expiration), cas));
+        } else {
+            cmd.reset(new Afina::Execute::Replace(key, flags, int32_t(expiration)));
+        }
+        not_stored = Status::kKeyNotFound;
+        break;
+
+    case Opcode::kAdd:
+    case Opcode::kAddQ:
+        cmd.reset(new Afina::Execute::Add(key, flags, int32_t(expiration)));
+        not_stored = Status::kKeyExists;
+        break;
+
+    case Opcode::kAppend:
+    case Opcode::kAppendQ:
+        cmd.reset(new Afina::Execute::Append(key, 0, 0));
+        break;
+
+    case Opcode::kPrepend:
+    case Opcode::kPrependQ:
+        cmd.reset(new Afina::Execute::Prepend(key, 0, 0));
+        break;
+
+    case Opcode::kDelete:
+    case Opcode::kDeleteQ:
+        cmd.reset(new Afina::Execute::Delete(key));
+        break;
+
+    case Opcode::kTouch:
+        cmd.reset(new Afina::Execute::Touch(key, int32_t(expiration)));
+        break;
+
+    default:
+        Reply(out, Status::kUnknownCommand);
+        return;
+    }
+
+    std::string result;
+    cmd->Execute(storage, args, result);
+    Status code = StatusOf(result, not_stored);
+
+    // New value is known only for the commands which replace it completely
+    uint64_t result_cas = 0;
+    if (code == Status::kOk && (opcode == Opcode::kSet || opcode == Opcode::kSetQ || opcode == Opcode::kAdd ||
+                                opcode == Opcode::kAddQ || opcode == Opcode::kReplace || opcode == Opcode::kReplaceQ)) {
+        result_cas = Afina::Execute::Cas::Unique(args.data(), args.size());
+    }
+    Reply(out, code, "", result_cas);
+}
+
+// Header is decoded once all of it arrived, extras and key sizes it has tell how much more to take
+bool BinaryParser::Parse(const char *input, const size_t size, size_t &parsed) {
+    parsed = 0;
+    if (parse_complete) {
+        return true;
+    }
+
+    // Magic is checked on the first byte, so text following binary requests fails right away
+    if (pending.empty() && size > 0 && uint8_t(input[0]) != RequestMagic) {
+        throw std::runtime_error("Invalid magic of binary request");
+    }
+
+    auto decode = [this](const char *header) {
+        opcode = Opcode(header[1]);
+        key_size = Load16(header + 2);
+        extras_size = uint8_t(header[4]);
+        total_size = Load32(header + 8);
+        opaque = Load32(header + 12);
+        cas = Load64(header + 16);
+        if (size_t(extras_size) + key_size > total_size) {
+            throw std::runtime_error("Invalid body length of binary request");
+        }
+    };
+
+    // Request found in one piece is parsed in place
+    if (pending.empty() && size >= HeaderSize) {
+        decode(input);
+        size_t need = HeaderSize + extras_size + key_size;
+        if (size >= need) {
+            extras = input + HeaderSize;
+            key = extras + extras_size;
+            parsed = need;
+            parse_complete = true;
+            return true;
+        }
+    }
+
+    while (true) {
+        size_t need = (pending.size() < HeaderSize) ? HeaderSize : HeaderSize + extras_size + key_size;
+        if (pending.size() == need) {
+            extras = pending.data() + HeaderSize;
+            key = extras + extras_size;
+            parse_complete = true;
+            return true;
+        }
+
+        size_t take = std::min(need - pending.size(), size - parsed);
+        if (take == 0) {
+            return false;
+        }
+
+        pending.append(input + parsed, take);
+        parsed += take;
+        if (pending.size() == HeaderSize) {
+            decode(pending.data());
+        }
+    }
+}
+
+// See BinaryParser.h
+std::unique_ptr<Afina::Execute::Command> BinaryParser::Build(uint32_t &body_size) const {
+    if (!parse_complete) {
+        return std::unique_ptr<Afina::Execute::Command>(nullptr);
+    }
+
+    body_size = ValueSize();
+    std::unique_ptr<BinaryCommand> cmd(new BinaryCommand(opcode, opaque, cas, std::string(key, key_size)));
+
+    // Sizes of extras the request must have, whether it must have a key and whether it may have a value
+    size_t need_extras = 0;
+    bool need_key = true, allow_value = false;
+    switch (opcode) {
+    case Opcode::kGet:
+    case Opcode::kGetQ:
+    case Opcode::kGetK:
+    case Opcode::kGetKQ:
+    case Opcode::kDelete:
+    case Opcode::kDeleteQ:
+        break;
+
+    case Opcode::kSet:
+    case Opcode::kSetQ:
+    case Opcode::kAdd:
+    case Opcode::kAddQ:
+    case Opcode::kReplace:
+    case Opcode::kReplaceQ:
+        need_extras = 8;
+        allow_value = true;
+        break;
+
+    case Opcode::kAppend:
+    case Opcode::kAppendQ:
+    case Opcode::kPrepend:
+    case Opcode::kPrependQ:
+        allow_value = true;
+        break;
+
+    case Opcode::kIncrement:
+    case Opcode::kIncrementQ:
+    case Opcode::kDecrement:
+    case Opcode::kDecrementQ:
+        need_extras = 20;
+        break;
+
+    case Opcode::kTouch:
+        need_extras = 4;
+        break;
+
+    case Opcode::kNoop:
+    case Opcode::kStat:
+        need_key = false;
+        break;
+
+    default:
+        cmd->status = Status::kUnknownCommand;
+        return cmd;
+    }
+
+    if (extras_size != need_extras || (need_key && key_size == 0) || (!allow_value && body_size > 0)) {
+        cmd->status = Status::kInvalidArguments;
+        return cmd;
+    }
+
+    switch (need_extras) {
+    case 8:
+        cmd->flags = Load32(extras);
+        cmd->expiration = Load32(extras + 4);
+        break;
+    case 20:
+        cmd->delta = Load64(extras);
+        cmd->initial = Load64(extras + 8);
+        cmd->expiration = Load32(extras + 16);
+        break;
+    case 4:
+        cmd->expiration = Load32(extras);
+        break;
+    }
+    return cmd;
+}
+
+// See BinaryParser.h
+void BinaryParser::Reset() {
+    pending.clear();
+    opcode = Opcode::kNoop;
+    extras_size = 0;
+    key_size = 0;
+    total_size = 0;
+    opaque = 0;
+    cas = 0;
+    extras = nullptr;
+    key = nullptr;
+    parse_complete = false;
+}
+
+} // namespace Protocol
+} // namespace Afina
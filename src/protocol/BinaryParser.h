@@ -0,0 +1,141 @@
+#ifndef AFINA_PROTOCOL_BINARY_PARSER_H
+#define AFINA_PROTOCOL_BINARY_PARSER_H
+
+#include <memory>
+#include <string>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Afina {
+namespace Execute {
+class Command;
+} // namespace Execute
+namespace Protocol {
+
+/**
+ * # Memcached binary protocol parser
+ * Request starts with the fixed size header which tells sizes of the extras, key and value following it,
+ * so nothing is searched or converted from decimal: header, extras and key are taken by the parser and
+ * value is read as a body of exactly known size, like a data block of the text protocol.
+ *
+ * Commands built reuse ones of the text protocol and encode their results as binary responses. Quiet
+ * versions of the commands respond only on failure, GETQ and GETKQ only on hit
+ */
+class BinaryParser {
+public:
+    // First byte of every request and response
+    static const uint8_t RequestMagic = 0x80;
+    static const uint8_t ResponseMagic = 0x81;
+
+    static const size_t HeaderSize = 24;
+
+    enum class Opcode : uint8_t {
+        kGet = 0x00,
+        kSet = 0x01,
+        kAdd = 0x02,
+        kReplace = 0x03,
+        kDelete = 0x04,
+        kIncrement = 0x05,
+        kDecrement = 0x06,
+        kQuit = 0x07,
+        kFlush = 0x08,
+        kGetQ = 0x09,
+        kNoop = 0x0a,
+        kVersion = 0x0b,
+        kGetK = 0x0c,
+        kGetKQ = 0x0d,
+        kAppend = 0x0e,
+        kPrepend = 0x0f,
+        kStat = 0x10,
+        kSetQ = 0x11,
+        kAddQ = 0x12,
+        kReplaceQ = 0x13,
+        kDeleteQ = 0x14,
+        kIncrementQ = 0x15,
+        kDecrementQ = 0x16,
+        kQuitQ = 0x17,
+        kFlushQ = 0x18,
+        kAppendQ = 0x19,
+        kPrependQ = 0x1a,
+        kTouch = 0x1c
+    };
+
+    enum class Status : uint16_t {
+        kOk = 0x0000,
+        kKeyNotFound = 0x0001,
+        kKeyExists = 0x0002,
+        kValueTooLarge = 0x0003,
+        kInvalidArguments = 0x0004,
+        kNotStored = 0x0005,
+        kNonNumeric = 0x0006,
+        kUnknownCommand = 0x0081
+    };
+
+    BinaryParser() { Reset(); }
+
+    /**
+     * Push given bytes into parser input. Method returns true once header, extras and key of the request
+     * are parsed out, in a such case method Build will return new command. Value of the request is not
+     * consumed, it is the body Build tells size of
+     *
+     * Parsed request refers to the input, so buffer must not change until Build is called. Throws
+     * std::runtime_error if input isn't a binary protocol request
+     *
+     * @param input bytes to be added to the parsed input
+     * @param size number of bytes in the input buffer that could be read
+     * @param parsed output parameter tells how many bytes was consumed from the input
+     * @return true if request has been parsed out
+     */
+    bool Parse(const char *input, const size_t size, size_t &parsed);
+
+    /**
+     * Builds new command from parsed input. In case if it wasn't enough input to parse request out
+     * method return nullptr. Request which is well framed but can't be executed gives command responding
+     * with the error status
+     */
+    std::unique_ptr<Execute::Command> Build(uint32_t &body_size) const;
+
+    /**
+     * Reset parser so that it could be used to parse out new request
+     */
+    void Reset();
+
+    inline Opcode GetOpcode() const { return opcode; }
+
+    /**
+     * True if request has value to be read as a body
+     */
+    inline bool ExpectsBody() const { return parse_complete && ValueSize() > 0; }
+
+    /**
+     * Appends response header to the output, all numbers are written in network byte order
+     */
+    static void EncodeHeader(std::string &out, Opcode opcode, Status status, uint8_t extras_size, uint16_t key_size,
+                             uint32_t body_size, uint32_t opaque, uint64_t cas);
+
+private:
+    inline uint32_t ValueSize() const { return total_size - extras_size - key_size; }
+
+    // Header and everything after it that is taken by parser, collected here if split between inputs
+    std::string pending;
+
+    // Header fields
+    Opcode opcode;
+    uint8_t extras_size;
+    uint16_t key_size;
+    uint32_t total_size;
+    uint32_t opaque;
+    uint64_t cas;
+
+    // Extras and key, point either to the input or to the pending
+    const char *extras;
+    const char *key;
+
+    bool parse_complete;
+};
+
+} // namespace Protocol
+} // namespace Afina
+
+#endif // AFINA_PROTOCOL_BINARY_PARSER_H
@@ -0,0 +1,200 @@
+#include "Framing.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include <afina/execute/Command.h>
+
+namespace Afina {
+namespace Protocol {
+
+// Largest body buffer allocated before the body arrives
+static const size_t MaxBodyReserve = 1024 * 1024;
+
+// See Framing.h
+const char *FindLineEndBytes(const char *begin, const char *end) {
+    for (; begin < end; begin++) {
+        if (*begin == '\n') {
+            return begin;
+        }
+    }
+    return nullptr;
+}
+
+// Unaligned loads never cross end, tail shorter than a vector is scanned by the narrower implementation
+#if defined(__SSE2__)
+static const char *FindLineEndVector16(const char *begin, const char *end) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; end - begin >= 16; begin += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+        if (mask != 0) {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+    return FindLineEndBytes(begin, end);
+}
+const char *(*const FindLineEndSSE2)(const char *, const char *) = &FindLineEndVector16;
+#else
+const char *(*const FindLineEndSSE2)(const char *, const char *) = nullptr;
+#endif
+
+#if defined(__AVX2__)
+static const char *FindLineEndVector32(const char *begin, const char *end) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    for (; end - begin >= 32; begin += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin));
+        unsigned mask = unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline)));
+        if (mask != 0) {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+    return FindLineEndVector16(begin, end);
+}
+const char *(*const FindLineEndAVX2)(const char *, const char *) = &FindLineEndVector32;
+#else
+const char *(*const FindLineEndAVX2)(const char *, const char *) = nullptr;
+#endif
+
+// See Framing.h
+const char *FindLineEnd(const char *begin, const char *end) {
+#if defined(__AVX2__)
+    return FindLineEndVector32(begin, end);
+#elif defined(__SSE2__)
+    return FindLineEndVector16(begin, end);
+#else
+    return FindLineEndBytes(begin, end);
+#endif
+}
+
+// See Framing.h
+RingBuffer::RingBuffer(size_t capacity) : _capacity(1), _head(0), _tail(0) {
+    while (_capacity < capacity) {
+        _capacity <<= 1;
+    }
+    _buffer.reset(new char[_capacity]);
+}
+
+// Empty buffer starts over from the beginning, so reads aren't split by the wrap point needlessly
+char *RingBuffer::WriteSpace(size_t &size) {
+    if (Empty()) {
+        _head = _tail = 0;
+    }
+
+    size_t offset = size_t(_tail & (_capacity - 1));
+    size = std::min(_capacity - Size(), _capacity - offset);
+    return _buffer.get() + offset;
+}
+
+// See Framing.h
+const char *RingBuffer::ReadSpace(size_t &size) const {
+    size_t offset = size_t(_head & (_capacity - 1));
+    size = std::min(Size(), _capacity - offset);
+    return _buffer.get() + offset;
+}
+
+// See Framing.h
+void RingBuffer::Consume(size_t size) {
+    if (size > Size()) {
+        throw std::logic_error("Consumed more than buffered");
+    }
+    _head += size;
+}
+
+// Defined here as header only has forward declaration of command
+Framer::Framer() : _state(sRecvHeader), _format(fUnknown), _body_size(0) {}
+
+// See Framing.h
+Framer::~Framer() {}
+
+// Parser builds command right after the header is parsed, so it could refer to the input given
+bool Framer::Feed(const char *input, size_t size, size_t &consumed) {
+    const char *pos = input;
+    const char *end = input + size;
+    while (_state != sReady && pos < end) {
+        switch (_state) {
+        case sRecvHeader: {
+            if (_format == fUnknown) {
+                _format = (uint8_t(*pos) == BinaryParser::RequestMagic) ? fBinary : fText;
+            }
+
+            size_t parsed = 0;
+            bool complete = (_format == fBinary) ? _binary.Parse(pos, end - pos, parsed)
+                                                 : _parser.Parse(pos, end - pos, parsed);
+            pos += parsed;
+            if (!complete) {
+                break;
+            }
+
+            // Body size is known in advance, so it is read right into the buffer of that size. Client could
+            // announce any size, buffer beyond the limit grows only as data arrives
+            if (_format == fBinary) {
+                _cmd = _binary.Build(_body_size);
+                _state = _binary.ExpectsBody() ? sRecvBody : sReady;
+            } else {
+                _cmd = _parser.Build(_body_size);
+                _state = _parser.ExpectsBody() ? (_body_size > 0 ? sRecvBody : sRecvTrailerCR) : sReady;
+            }
+            _body.reserve(std::min(size_t(_body_size), MaxBodyReserve));
+            break;
+        }
+
+        case sRecvBody: {
+            size_t for_copy = std::min(size_t(end - pos), size_t(_body_size));
+            _body.append(pos, for_copy);
+            pos += for_copy;
+            _body_size -= for_copy;
+            if (_body_size == 0) {
+                _state = (_format == fBinary) ? sReady : sRecvTrailerCR;
+            }
+            break;
+        }
+
+        case sRecvTrailerCR:
+            if (*pos++ != '\r') {
+                throw std::runtime_error("Invalid chat, \\r expected");
+            }
+            _state = sRecvTrailerLF;
+            break;
+
+        case sRecvTrailerLF:
+            if (*pos++ != '\n') {
+                throw std::runtime_error("Invalid chat, \\n expected");
+            }
+            _state = sReady;
+            break;
+
+        default:
+            throw std::runtime_error("Unknown state");
+        }
+    }
+
+    consumed = pos - input;
+    return _state == sReady;
+}
+
+// See Framing.h
+void Framer::Reset() {
+    _state = sRecvHeader;
+    _parser.Reset();
+    _binary.Reset();
+    _cmd.reset();
+    _body_size = 0;
+    _body.clear();
+}
+
+// See Framing.h
+void Framer::Restart() {
+    Reset();
+    _format = fUnknown;
+}
+
+} // namespace Protocol
+} // namespace Afina
@@ -0,0 +1,163 @@
+#ifndef AFINA_PROTOCOL_FRAMING_H
+#define AFINA_PROTOCOL_FRAMING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "BinaryParser.h"
+#include "Parser.h"
+
+namespace Afina {
+namespace Execute {
+class Command;
+} // namespace Execute
+namespace Protocol {
+
+/**
+ * Returns pointer to the first \n in [begin, end) or nullptr if there is none. Compares 32 bytes at once
+ * if compiler targets AVX2, 16 bytes with SSE2 otherwise, build uses -march=native when available
+ */
+const char *FindLineEnd(const char *begin, const char *end);
+
+/**
+ * Implementations FindLineEnd picks from, exposed for benchmark. Vector ones are null if not compiled in
+ */
+const char *FindLineEndBytes(const char *begin, const char *end);
+extern const char *(*const FindLineEndSSE2)(const char *begin, const char *end);
+extern const char *(*const FindLineEndAVX2)(const char *begin, const char *end);
+
+/**
+ * # Ring buffer of connection input
+ * Socket is read into the free space after the data and processed data is released from the front, so
+ * nothing is ever moved. Both data and free space could wrap around the end of the buffer, so each is
+ * accessed as up to two contiguous parts, the first one is returned
+ */
+class RingBuffer {
+public:
+    /**
+     * Capacity is rounded up to the power of two
+     */
+    RingBuffer(size_t capacity);
+
+    size_t Size() const { return size_t(_tail - _head); }
+    size_t Capacity() const { return _capacity; }
+    bool Empty() const { return _tail == _head; }
+    bool Full() const { return Size() == _capacity; }
+
+    /**
+     * Contiguous free space to write into and number of bytes it has, 0 if buffer is full
+     */
+    char *WriteSpace(size_t &size);
+
+    /**
+     * Marks that many bytes of the free space as data
+     */
+    void Produce(size_t size) { _tail += size; }
+
+    /**
+     * Contiguous data from the front of the buffer and number of bytes it has, 0 if buffer is empty
+     */
+    const char *ReadSpace(size_t &size) const;
+
+    /**
+     * Releases that many bytes from the front
+     */
+    void Consume(size_t size);
+
+    /**
+     * Drops all data
+     */
+    void Clear() { _head = _tail = 0; }
+
+private:
+    RingBuffer(const RingBuffer &);            // = delete;
+    RingBuffer &operator=(const RingBuffer &); // = delete;
+
+    std::unique_ptr<char[]> _buffer;
+    size_t _capacity;
+
+    // Data is [_head, _tail), positions only grow and are wrapped by mask
+    uint64_t _head;
+    uint64_t _tail;
+};
+
+/**
+ * # Splits input stream into commands
+ * Command header goes to the parser, then body of the size header announced and its \r\n trailer are
+ * collected. Input could be given in pieces split at any byte, all servers use it to frame requests
+ *
+ * Protocol is detected by the first byte of the stream: binary protocol requests start with the magic
+ * byte no text command starts with. Binary requests have no trailer after the body
+ */
+class Framer {
+public:
+    Framer();
+    ~Framer();
+
+    /**
+     * Consumes input until command is complete, consumed tells how many bytes were taken. Returns true once
+     * command and its body are ready, they stay valid until Reset. Throws std::runtime_error on malformed input
+     */
+    bool Feed(const char *input, size_t size, size_t &consumed);
+
+    /**
+     * Command ready to be executed, could be moved out
+     */
+    std::unique_ptr<Execute::Command> &Command() { return _cmd; }
+
+    /**
+     * Body of the command, could be swapped out
+     */
+    std::string &Body() { return _body; }
+
+    /**
+     * Prepares framer for the next command of the same stream
+     */
+    void Reset();
+
+    /**
+     * Prepares framer for a new stream, protocol gets detected again
+     */
+    void Restart();
+
+    /**
+     * True once the stream is known to use binary protocol
+     */
+    bool Binary() const { return _format == fBinary; }
+
+private:
+    enum State : uint8_t {
+        // Command header expected
+        sRecvHeader,
+
+        // Command parsed and its body is being read
+        sRecvBody,
+
+        // Body is read, waiting for the trailing \r\n
+        sRecvTrailerCR,
+        sRecvTrailerLF,
+
+        // Command is complete
+        sReady
+    };
+
+    /**
+     * Protocol of the stream
+     */
+    enum Format : uint8_t { fUnknown, fText, fBinary };
+
+    State _state;
+    Format _format;
+    Parser _parser;
+    BinaryParser _binary;
+    std::unique_ptr<Execute::Command> _cmd;
+    uint32_t _body_size;
+    std::string _body;
+};
+
+} // namespace Protocol
+} // namespace Afina
+
+#endif // AFINA_PROTOCOL_FRAMING_H
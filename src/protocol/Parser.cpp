@@ -1,198 +1,383 @@
 #include "Parser.h"
+#include "Framing.h"
 
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 
 #include <afina/execute/Add.h>
 #include <afina/execute/Append.h>
+#include <afina/execute/Cas.h>
 #include <afina/execute/Command.h>
+#include <afina/execute/Decr.h>
 #include <afina/execute/Delete.h>
 #include <afina/execute/Get.h>
+#include <afina/execute/Incr.h>
+#include <afina/execute/Prepend.h>
+#include <afina/execute/Replace.h>
 #include <afina/execute/Set.h>
 #include <afina/execute/Stats.h>
+#include <afina/execute/Touch.h>
 
 namespace Afina {
 namespace Protocol {
 
+// Longest command line accepted, protects parser from clients which never send \n
+static const size_t MaxLineSize = 64 * 1024;
+
+// Layout of the command line after the command name, parser handles all commands of the same syntax alike
+enum class Syntax : uint8_t {
+    // <key>*
+    kRetrieval,
+
+    // <key> <flags> <exptime> <bytes> [noreply]
+    kStorage,
+
+    // <key> <flags> <exptime> <bytes> <cas unique> [noreply]
+    kCas,
+
+    // <key> [noreply]
+    kDelete,
+
+    // <key> <value> [noreply]
+    kArithmetic,
+
+    // <key> <exptime> [noreply]
+    kTouch,
+
+    // [<args>], ignored
+    kStats
+};
+
+// Command names table, slot is a perfect hash of the name. Hash covers the first, the second and the last
+// characters and the length, constants are picked to be collision free over the whole memcached text command
+// set: get gets gat gats set add replace append prepend cas delete incr decr touch stats version verbosity
+// flush_all quit
+static const size_t NameTableSize = 32;
+
+// All names are at least that long, so hash could look at the first two characters
+static const size_t MinNameSize = 3;
+
+struct NameEntry {
+    const char *name;
+    size_t size;
+    Parser::CommandId id;
+    Syntax syntax;
+};
+
+static size_t HashName(const char *name, size_t size) {
+    return (size_t((unsigned char)name[0]) + 14 * size_t((unsigned char)name[1]) +
+            19 * size_t((unsigned char)name[size - 1]) + size) &
+           (NameTableSize - 1);
+}
+
+// Built once at startup, parsers are never used before main
+static const struct NameTable {
+    NameTable() {
+        static const NameEntry names[] = {
+            {"get", 3, Parser::CommandId::kGet, Syntax::kRetrieval},
+            {"gets", 4, Parser::CommandId::kGets, Syntax::kRetrieval},
+            {"set", 3, Parser::CommandId::kSet, Syntax::kStorage},
+            {"add", 3, Parser::CommandId::kAdd, Syntax::kStorage},
+            {"replace", 7, Parser::CommandId::kReplace, Syntax::kStorage},
+            {"append", 6, Parser::CommandId::kAppend, Syntax::kStorage},
+            {"prepend", 7, Parser::CommandId::kPrepend, Syntax::kStorage},
+            {"cas", 3, Parser::CommandId::kCas, Syntax::kCas},
+            {"delete", 6, Parser::CommandId::kDelete, Syntax::kDelete},
+            {"incr", 4, Parser::CommandId::kIncr, Syntax::kArithmetic},
+            {"decr", 4, Parser::CommandId::kDecr, Syntax::kArithmetic},
+            {"touch", 5, Parser::CommandId::kTouch, Syntax::kTouch},
+            {"stats", 5, Parser::CommandId::kStats, Syntax::kStats},
+        };
+
+        for (auto &entry : slots) {
+            entry = {"", 0, Parser::CommandId::kUnknown, Syntax::kStats};
+        }
+        for (auto &entry : names) {
+            slots[HashName(entry.name, entry.size)] = entry;
+        }
+    }
+
+    // Entry for the given name, nullptr if there is no such command
+    const NameEntry *Find(const char *name, size_t size) const {
+        if (size < MinNameSize) {
+            return nullptr;
+        }
+
+        const NameEntry &entry = slots[HashName(name, size)];
+        if (entry.size != size || memcmp(entry.name, name, size) != 0) {
+            return nullptr;
+        }
+        return &entry;
+    }
+
+    NameEntry slots[NameTableSize];
+} name_table;
+
+// Moves pos to the start of the next space separated field and returns it, false if line is over
+static bool NextField(const char *&pos, const char *end, Parser::Span &field) {
+    while (pos < end && *pos == ' ') {
+        pos++;
+    }
+    if (pos == end) {
+        return false;
+    }
+
+    const char *space = static_cast<const char *>(memchr(pos, ' ', end - pos));
+    field.data = pos;
+    field.size = (space == nullptr ? end : space) - pos;
+    pos += field.size;
+    return true;
+}
+
+static uint64_t ParseUnsigned(const Parser::Span &field, const char *name, uint64_t max = UINT32_MAX) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < field.size; i++) {
+        char c = field.data[i];
+        if (c < '0' || c > '9') {
+            throw std::runtime_error(std::string(name) + " field is not a number");
+        }
+
+        uint64_t digit = c - '0';
+        if (value > (max - digit) / 10) {
+            throw std::runtime_error(std::string(name) + " field overflow");
+        }
+        value = value * 10 + digit;
+    }
+    return value;
+}
+
+static int32_t ParseSigned(const Parser::Span &field, const char *name) {
+    if (field.size > 0 && field.data[0] == '-') {
+        uint64_t value = ParseUnsigned({field.data + 1, field.size - 1}, name);
+        if (value > uint32_t(INT32_MAX) + 1) {
+            throw std::runtime_error(std::string(name) + " field overflow");
+        }
+        return int32_t(-int64_t(value));
+    }
+
+    uint64_t value = ParseUnsigned(field, name);
+    if (value > uint32_t(INT32_MAX)) {
+        throw std::runtime_error(std::string(name) + " field overflow");
+    }
+    return int32_t(value);
+}
+
+// See Parse.h
+Parser::CommandId Parser::Lookup(const char *name, size_t size) {
+    const NameEntry *entry = name_table.Find(name, size);
+    return entry == nullptr ? CommandId::kUnknown : entry->id;
+}
+
+// See Parse.h
+std::string Parser::Name() const {
+    for (auto &entry : name_table.slots) {
+        if (entry.size > 0 && entry.id == id) {
+            return entry.name;
+        }
+    }
+    return "";
+}
+
+// See Parse.h
+// See Parse.h
+bool Parser::Parse(const std::string &input, size_t &parsed) { return Parse(input.data(), input.size(), parsed, true); }
+
 // See Parse.h
-bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
-    size_t pos;
+bool Parser::Parse(const char *input, const size_t size, size_t &parsed) { return Parse(input, size, parsed, false); }
+
+// Line found in one piece is parsed in place, otherwise it is collected in pending
+bool Parser::Parse(const char *input, const size_t size, size_t &parsed, bool copy) {
     parsed = 0;
+    if (parse_complete) {
+        return true;
+    }
+
+    const char *eol = FindLineEnd(input, input + size);
+    size_t used = (eol == nullptr) ? size : size_t(eol - input) + 1;
+    if (pending.size() + used > MaxLineSize) {
+        throw std::runtime_error("Command line is too long");
+    }
+
+    if (eol == nullptr) {
+        pending.append(input, used);
+        parsed = used;
+        return false;
+    }
+
+    if (pending.empty() && !copy) {
+        ParseLine(input, used);
+    } else {
+        pending.append(input, used);
+        ParseLine(pending.data(), pending.size());
+    }
+
+    parsed = used;
+    parse_complete = true;
+    return true;
+}
+
+// See Parse.h
+void Parser::ParseLine(const char *line, size_t size) {
+    if (size < 2 || line[size - 2] != '\r') {
+        std::stringstream err;
+        err << "Invalid char " << (size < 2 ? (int)'\n' : (int)line[size - 2]) << " at position " << (size - 1)
+            << ", \\r expected";
+        throw std::runtime_error(err.str());
+    }
+
+    const char *pos = line;
+    const char *end = line + size - 2;
+    Span field;
+    const NameEntry *entry = nullptr;
+    if (!NextField(pos, end, field) || (entry = name_table.Find(field.data, field.size)) == nullptr) {
+        throw std::runtime_error("Unknown command name");
+    }
+
+    id = entry->id;
+    switch (entry->syntax) {
+    case Syntax::kRetrieval:
+        while (NextField(pos, end, field)) {
+            keys.push_back(field);
+        }
+        if (keys.size() == 0) {
+            throw std::runtime_error("Client provides no key to retrive");
+        }
+        return;
+
+    case Syntax::kStats:
+        return;
+
+    case Syntax::kStorage:
+    case Syntax::kCas: {
+        Span key, f, e, b, c;
+        if (!NextField(pos, end, key) || !NextField(pos, end, f) || !NextField(pos, end, e) ||
+            !NextField(pos, end, b) || (entry->syntax == Syntax::kCas && !NextField(pos, end, c))) {
+            throw std::runtime_error("Not enough fields in command");
+        }
+
+        keys.push_back(key);
+        flags = ParseUnsigned(f, "Flags");
+        exprtime = ParseSigned(e, "Expire time");
+        bytes = ParseUnsigned(b, "Bytes");
+        if (entry->syntax == Syntax::kCas) {
+            cas_unique = ParseUnsigned(c, "Cas unique", UINT64_MAX);
+        }
+        has_body = true;
+        break;
+    }
+
+    case Syntax::kDelete:
+        if (!NextField(pos, end, field)) {
+            throw std::runtime_error("Not enough fields in command");
+        }
+        keys.push_back(field);
+        break;
 
-    for (pos = 0; pos < size && !parse_complete; pos++) {
-        char c = input[pos];
-
-        switch (state) {
-        case State::sName: {
-            if (c == ' ' || c == '\r') {
-                // std::cout << "parser debug: name='" << name << "'" << std::endl;
-                if (name == "set" || name == "add" || name == "append" || name == "prepend") {
-                    state = State::spKey;
-                } else if (name == "get" || name == "gets") {
-                    state = State::sgKey;
-                } else if (name == "stats") {
-                    state = State::sLF;
-                    continue;
-                } else {
-                    throw std::runtime_error("Unknown command name");
-                }
-            } else {
-                name.push_back(c);
-            }
-            break;
-        }
-
-        case State::spKey: {
-            if (c == ' ') {
-                state = State::spFlags;
-                keys.push_back(curKey);
-                // std::cout << "parser debug: key[" << keys.size() - 1 << "]='" << curKey << "'" << std::endl;
-            } else {
-                curKey.push_back(c);
-            }
-            break;
-        }
-
-        case State::sgKey: {
-            if (c == '\r') {
-                keys.push_back(curKey);
-                // std::cout << "parser debug: total '" << keys.size() << " keys" << std::endl;
-
-                if (keys.size() == 0) {
-                    throw std::runtime_error("Client provides no key to retrive");
-                }
-
-                curKey.clear();
-                state = State::sLF;
-            } else if (c == ' ') {
-                // std::cout << "parser debug: key[" << keys.size() << "]='" << curKey << "'" << std::endl;
-                state = State::sgKey;
-                keys.push_back(curKey);
-                curKey.clear();
-            } else {
-                curKey.push_back(c);
-            }
-            break;
-        }
-
-        case State::spFlags: {
-            if (c == ' ') {
-                negative = false;
-                state = State::spExprTimeStart;
-                // std::cout << "parser debug: flags='" << flags << "'" << std::endl;
-            } else if (c >= '0' && c <= '9') {
-                uint32_t f = (flags * 10) + (c - '0');
-                if (f < flags) {
-                    // Overflow
-                    throw std::runtime_error("Flags field overflow");
-                }
-                flags = f;
-            }
-            break;
-        }
-
-        case State::spExprTimeStart: {
-            if (c == '-') {
-                negative = true;
-                state = State::spExprTime;
-            } else if (c >= '0' && c <= '9') {
-                exprtime = (c - '0');
-                state = State::spExprTime;
-            }
-            break;
-        }
-
-        case State::spExprTime: {
-            if (c == ' ') {
-                state = State::spBytes;
-                // std::cout << "parser debug: ExprTime='" << exprtime << "'" << std::endl;
-            } else if (c >= '0' && c <= '9') {
-                int32_t et = exprtime;
-                if (negative) {
-                    et -= (c - '0');
-                    if (et > exprtime) {
-                        throw std::runtime_error("Expire time field overflow");
-                    }
-                } else {
-                    et += (c - '0');
-                    if (et < exprtime) {
-                        throw std::runtime_error("Expire time field overflow");
-                    }
-                }
-                exprtime = et;
-            }
-            break;
-        }
-
-        case State::spBytes: {
-            if (c == '\r') {
-                state = State::sLF;
-                // std::cout << "parser debug: bytes='" << bytes << "'" << std::endl;
-            } else if (c >= '0' && c <= '9') {
-                uint32_t b = (bytes * 10) + (c - '0');
-                if (b < bytes) {
-                    // Overflow
-                    throw std::runtime_error("Bytes field overflow");
-                }
-                bytes = b;
-            }
-            break;
-        }
-
-        case State::sLF: {
-            if (c == '\n') {
-                parse_complete = true;
-            } else {
-                std::stringstream err;
-                err << "Invalid char " << (int)c << " at position " << (parsed + pos) << ", \\n expected";
-                throw std::runtime_error(err.str());
-            }
-            break;
-        }
-
-        default:
-            throw std::runtime_error("Unknown state");
-        }
-    }
-
-    parsed += pos;
-    return parse_complete;
+    case Syntax::kArithmetic: {
+        Span key, value;
+        if (!NextField(pos, end, key) || !NextField(pos, end, value)) {
+            throw std::runtime_error("Not enough fields in command");
+        }
+        keys.push_back(key);
+        delta = ParseUnsigned(value, "Value", UINT64_MAX);
+        break;
+    }
+
+    case Syntax::kTouch: {
+        Span key, e;
+        if (!NextField(pos, end, key) || !NextField(pos, end, e)) {
+            throw std::runtime_error("Not enough fields in command");
+        }
+        keys.push_back(key);
+        exprtime = ParseSigned(e, "Expire time");
+        break;
+    }
+    }
+
+    // Commands which change storage could be asked not to respond, anything else is ignored
+    while (NextField(pos, end, field)) {
+        if (field.size == 7 && memcmp(field.data, "noreply", 7) == 0) {
+            noreply = true;
+        }
+    }
 }
 
 // See Parse.h
 std::unique_ptr<Execute::Command> Parser::Build(uint32_t &body_size) const {
-    if (state != State::sLF) {
+    if (!parse_complete) {
         return std::unique_ptr<Execute::Command>(nullptr);
     }
 
     body_size = bytes;
-    if (name == "set") {
-        return std::unique_ptr<Execute::Command>(new Execute::Set(keys[0], flags, exprtime));
-    } else if (name == "add") {
-        return std::unique_ptr<Execute::Command>(new Execute::Add(keys[0], flags, exprtime));
-    } else if (name == "append") {
-        return std::unique_ptr<Execute::Command>(new Execute::Append(keys[0], flags, exprtime));
-    } else if (name == "get") {
-        return std::unique_ptr<Execute::Command>(new Execute::Get(keys));
-    } else if (name == "stats") {
-        return std::unique_ptr<Execute::Command>(new Execute::Stats());
-    } else {
+    std::unique_ptr<Execute::Command> cmd;
+    switch (id) {
+    case CommandId::kGet:
+    case CommandId::kGets: {
+        std::vector<std::string> names;
+        names.reserve(keys.size());
+        for (auto &key : keys) {
+            names.push_back(key.str());
+        }
+        cmd.reset(new Execute::Get(names, id == CommandId::kGets));
+        break;
+    }
+    case CommandId::kSet:
+        cmd.reset(new Execute::Set(keys[0].str(), flags, exprtime));
+        break;
+    case CommandId::kAdd:
+        cmd.reset(new Execute::Add(keys[0].str(), flags, exprtime));
+        break;
+    case CommandId::kReplace:
+        cmd.reset(new Execute::Replace(keys[0].str(), flags, exprtime));
+        break;
+    case CommandId::kAppend:
+        cmd.reset(new Execute::Append(keys[0].str(), flags, exprtime));
+        break;
+    case CommandId::kPrepend:
+        cmd.reset(new Execute::Prepend(keys[0].str(), flags, exprtime));
+        break;
+    case CommandId::kCas:
+        cmd.reset(new Execute::Cas(keys[0].str(), flags, exprtime, cas_unique));
+        break;
+    case CommandId::kDelete:
+        cmd.reset(new Execute::Delete(keys[0].str()));
+        break;
+    case CommandId::kIncr:
+        cmd.reset(new Execute::Incr(keys[0].str(), delta));
+        break;
+    case CommandId::kDecr:
+        cmd.reset(new Execute::Decr(keys[0].str(), delta));
+        break;
+    case CommandId::kTouch:
+        cmd.reset(new Execute::Touch(keys[0].str(), exprtime));
+        break;
+    case CommandId::kStats:
+        cmd.reset(new Execute::Stats());
+        break;
+    default:
         throw std::runtime_error("Unsupported command");
     }
+
+    cmd->noreply(noreply);
+    return cmd;
 }
 
 // See Parse.h
 void Parser::Reset() {
-    state = State::sName;
-    name.clear();
+    pending.clear();
     keys.clear();
-    curKey.clear();
+    id = CommandId::kUnknown;
     parse_complete = false;
     flags = 0;
     bytes = 0;
     exprtime = 0;
+    cas_unique = 0;
+    delta = 0;
+    noreply = false;
+    has_body = false;
 }
 
 } // namespace Protocol
-} // namespace Afina
\ No newline at end of file
+} // namespace Afina
@@ -16,25 +16,67 @@ namespace Protocol {
 
 /**
  * # Memcached protocol parser
- * Parser supports subset of memcached protocol
+ * Parser supports memcached text protocol storage, retrieval, deletion, arithmetic and touch commands,
+ * any of which that changes storage could be followed by "noreply". Command names are resolved through
+ * the table which also tells how the rest of the line is laid out, so commands sharing a syntax share
+ * the parsing code
+ *
+ * Command line is located by FindLineEnd and split into spans pointing into the input, numeric fields are
+ * converted right from the input and command name is resolved through the perfect hash, so parsing a
+ * header doesn't copy or allocate anything. Only a line split between two inputs is copied into the parser.
  */
 class Parser {
 public:
+    /**
+     * Part of the input buffer
+     */
+    struct Span {
+        const char *data;
+        size_t size;
+
+        std::string str() const { return std::string(data, size); }
+    };
+
+    /**
+     * Commands known to the parser
+     */
+    enum class CommandId : uint8_t {
+        kUnknown,
+        kGet,
+        kGets,
+        kSet,
+        kAdd,
+        kReplace,
+        kAppend,
+        kPrepend,
+        kCas,
+        kDelete,
+        kIncr,
+        kDecr,
+        kTouch,
+        kStats
+    };
+
     Parser() { Reset(); }
+
     /**
      * Push given string into parser input. Method returns true if it was a command parsed out
      * from comulative input. In a such case method Build will return new command
      *
+     * Unlike the method below, command line is copied, so string could be a temporary
+     *
      * @param input sttring to be added to the parsed input
      * @param parsed output parameter tells how many bytes was consumed from the string
      * @return true if command has been parsed out
      */
-    bool Parse(const std::string &input, size_t &parsed) { return Parse(&input[0], input.size(), parsed); }
+    bool Parse(const std::string &input, size_t &parsed);
 
     /**
      * Push given string into parser input. Method returns true if it was a command parsed out
      * from comulative input. In a such case method Build will return new command
      *
+     * Parsed keys refer to the input, so buffer must not change until Build is called
+     *
      * @param input string to be added to the parsed input
      * @param size number of bytes in the input buffer that could be read
      * @param parsed output parameter tells how many bytes was consumed from the string
@@ -53,23 +95,44 @@ public:
      */
     void Reset();
 
-    inline const std::string &Name() const { return name; }
+    inline CommandId Id() const { return id; }
+
+    /**
+     * True if parsed command is followed by the data block
+     */
+    inline bool ExpectsBody() const { return has_body; }
+
+    /**
+     * True if client asked not to send response
+     */
+    inline bool NoReply() const { return noreply; }
+
+    std::string Name() const;
+
+    inline const std::vector<Span> &Keys() const { return keys; }
+
+    /**
+     * Resolves command name, returns kUnknown if there is no such command
+     */
+    static CommandId Lookup(const char *name, size_t size);
 
 private:
     /**
-     * State of the command parser. Prefixes are:
-     * - s: state for PUT and GET commands
-     * - sp: for PUT commands only
-     * - sg: for GET commands only
+     * Looks for the end of command line, copy flag forces line to be copied into the parser
      */
-    enum State : uint16_t { sCR, sLF, sName, spKey, spFlags, spExprTimeStart, spExprTime, spBytes, sgKey };
+    bool Parse(const char *input, const size_t size, size_t &parsed, bool copy);
 
-    // Current parser state
-    State state;
+    /**
+     * Splits complete command line, including trailing \r\n, into fields
+     */
+    void ParseLine(const char *line, size_t size);
+
+    // Line split between inputs, kept until the rest of it arrives
+    std::string pending;
 
     // vrious fields of the command
-    std::string name;
-    std::vector<std::string> keys;
+    CommandId id;
+    std::vector<Span> keys;
 
     // <flags> is an arbitrary 16-bit unsigned integer (written out in decimal) that the server stores along with
     // the data and sends back when the item is retrieved. Clients may use this as a bit field to store data-specific
@@ -88,12 +151,22 @@ private:
     // it's followed by an empty data block).
     uint32_t bytes;
 
-    bool negative;
-    std::string curKey;
+    // <cas unique> is a unique 64-bit value of an existing entry, client got it from "gets"
+    uint64_t cas_unique;
+
+    // <value> of incr and decr is the amount by which the client wants to change the item
+    uint64_t delta;
+
+    // "noreply" optional parameter instructs the server to not send the reply
+    bool noreply;
+
+    // Command line is followed by the data block of the given number of bytes
+    bool has_body;
+
     bool parse_complete;
 };
 
 } // namespace Protocol
 } // namespace Afina
 
-#endif // AFINA_MEMCACHED_PARSER_H
\ No newline at end of file
+#endif // AFINA_MEMCACHED_PARSER_H
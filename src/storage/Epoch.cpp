@@ -0,0 +1,199 @@
+#include "Epoch.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Afina {
+namespace Backend {
+
+namespace {
+
+// How many retired objects thread accumulates before tries to reclaim them
+const size_t CollectThreshold = 64;
+
+struct Retired {
+    void *ptr;
+    void (*deleter)(void *);
+
+    // Global epoch at the moment object was retired
+    uint64_t epoch;
+};
+
+/**
+ * Per thread state. Records are never deleted, once thread exits its record could be reused
+ * by another one
+ */
+struct Record {
+    // Zero if thread is outside of read section, (epoch << 1) | 1 otherwise. The only field
+    // other threads read, so it is kept on its own cache line
+    std::atomic<uint64_t> state;
+    char padding[64 - sizeof(std::atomic<uint64_t>)];
+
+    // Set while some thread owns the record
+    std::atomic<bool> in_use;
+
+    // Next record in the global list
+    Record *next;
+
+    // Depth of nested read sections
+    uint32_t nesting;
+
+    // Objects retired by the thread, ordered by epoch
+    std::deque<Retired> limbo;
+
+    // Objects retired since last reclamation attempt
+    size_t retired;
+
+    Record() : state(0), in_use(true), next(nullptr), nesting(0), retired(0) {}
+};
+
+std::atomic<uint64_t> global_epoch(1);
+
+// List of all records ever created, grows only
+std::atomic<Record *> records(nullptr);
+
+// Number of retired but not deleted objects
+std::atomic<size_t> pending(0);
+
+// Objects left by exited threads
+std::mutex orphans_lock;
+std::vector<Retired> orphans;
+
+Record *Acquire() {
+    for (Record *rec = records.load(std::memory_order_acquire); rec != nullptr; rec = rec->next) {
+        bool expected = false;
+        if (!rec->in_use.load(std::memory_order_relaxed) && rec->in_use.compare_exchange_strong(expected, true)) {
+            return rec;
+        }
+    }
+
+    Record *rec = new Record();
+    Record *head = records.load(std::memory_order_relaxed);
+    do {
+        rec->next = head;
+    } while (!records.compare_exchange_weak(head, rec, std::memory_order_release, std::memory_order_relaxed));
+    return rec;
+}
+
+void Release(Record *rec) {
+    if (!rec->limbo.empty()) {
+        std::unique_lock<std::mutex> guard(orphans_lock);
+        orphans.insert(orphans.end(), rec->limbo.begin(), rec->limbo.end());
+        rec->limbo.clear();
+    }
+    rec->retired = 0;
+    rec->in_use.store(false, std::memory_order_release);
+}
+
+/**
+ * Binds record to the thread and releases it on thread exit
+ */
+struct Holder {
+    Record *rec;
+    Holder() : rec(nullptr) {}
+    ~Holder() {
+        if (rec != nullptr) {
+            Release(rec);
+        }
+    }
+};
+
+thread_local Holder holder;
+
+Record *Local() {
+    if (holder.rec == nullptr) {
+        holder.rec = Acquire();
+    }
+    return holder.rec;
+}
+
+/**
+ * Advances global epoch if every thread inside of read section has observed the current one
+ */
+void TryAdvance() {
+    uint64_t epoch = global_epoch.load(std::memory_order_seq_cst);
+    for (Record *rec = records.load(std::memory_order_acquire); rec != nullptr; rec = rec->next) {
+        uint64_t state = rec->state.load(std::memory_order_seq_cst);
+        if ((state & 1) != 0 && (state >> 1) != epoch) {
+            return;
+        }
+    }
+    global_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+}
+
+void Collect(Record *rec) {
+    rec->retired = 0;
+    TryAdvance();
+
+    uint64_t epoch = global_epoch.load(std::memory_order_seq_cst);
+    while (!rec->limbo.empty() && rec->limbo.front().epoch + 2 <= epoch) {
+        Retired &r = rec->limbo.front();
+        r.deleter(r.ptr);
+        rec->limbo.pop_front();
+        pending.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Adopt objects of exited threads, they are reclaimed together with own ones
+    std::unique_lock<std::mutex> guard(orphans_lock, std::try_to_lock);
+    if (guard.owns_lock() && !orphans.empty()) {
+        rec->limbo.insert(rec->limbo.end(), orphans.begin(), orphans.end());
+        orphans.clear();
+    }
+}
+
+} // namespace
+
+// See Epoch.h
+void Epoch::Enter() {
+    Record *rec = Local();
+    if (rec->nesting++ == 0) {
+        uint64_t epoch = global_epoch.load(std::memory_order_relaxed);
+        rec->state.store((epoch << 1) | 1, std::memory_order_relaxed);
+
+        // Announcement must be visible to writers before any shared pointer is loaded
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+// See Epoch.h
+void Epoch::Leave() {
+    Record *rec = Local();
+    if (--rec->nesting == 0) {
+        rec->state.store(0, std::memory_order_release);
+    }
+}
+
+// See Epoch.h
+void Epoch::Retire(void *ptr, void (*deleter)(void *)) {
+    Record *rec = Local();
+    rec->limbo.push_back(Retired{ptr, deleter, global_epoch.load(std::memory_order_seq_cst)});
+    pending.fetch_add(1, std::memory_order_relaxed);
+
+    // Reclamation is never done from inside of read section: thread's own announcement
+    // would block epoch from advancing anyway
+    if (++rec->retired >= CollectThreshold && rec->nesting == 0) {
+        Collect(rec);
+    }
+}
+
+// See Epoch.h
+void Epoch::Synchronize() {
+    Record *rec = Local();
+    while (true) {
+        Collect(rec);
+        if (rec->limbo.empty()) {
+            break;
+        }
+        std::this_thread::yield();
+    }
+}
+
+// See Epoch.h
+size_t Epoch::Pending() { return pending.load(std::memory_order_relaxed); }
+
+} // namespace Backend
+} // namespace Afina
@@ -0,0 +1,71 @@
+#ifndef AFINA_STORAGE_EPOCH_H
+#define AFINA_STORAGE_EPOCH_H
+
+#include <cstddef>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Epoch based memory reclamation
+ * Allows readers to access shared objects without any locks, while writers unlink objects and
+ * retire them instead of immediate delete.
+ *
+ * Each thread announces global epoch it has observed once enters read section. Global epoch could
+ * be advanced only when all threads inside read sections have observed current one, so an object
+ * retired at epoch E is unreachable for everybody once global epoch becomes E + 2 and gets deleted.
+ *
+ * Domain is process wide, threads are registered lazily on first use and unregistered at thread exit,
+ * objects retired by exited threads are deleted by the others
+ */
+class Epoch {
+public:
+    /**
+     * RAII read section, any pointer loaded from shared structure inside of section stays valid until
+     * guard is destroyed. Sections could be nested
+     */
+    class Guard {
+    public:
+        Guard() { Epoch::Enter(); }
+        ~Guard() { Epoch::Leave(); }
+
+    private:
+        Guard(const Guard &);            // = delete;
+        Guard &operator=(const Guard &); // = delete;
+    };
+
+    /**
+     * Enter read section
+     */
+    static void Enter();
+
+    /**
+     * Leave read section
+     */
+    static void Leave();
+
+    /**
+     * Schedule object to be deleted once no reader could reference it anymore. Object must be already
+     * unreachable for readers that enter read section after this call
+     *
+     * @param ptr object to delete
+     * @param deleter function to call to delete object
+     */
+    static void Retire(void *ptr, void (*deleter)(void *));
+
+    /**
+     * Blocks until every object retired by the calling thread so far gets deleted. Must not be called
+     * from inside of read section
+     */
+    static void Synchronize();
+
+    /**
+     * Number of objects retired by all threads that are not deleted yet
+     */
+    static size_t Pending();
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_EPOCH_H
@@ -2,52 +2,82 @@
 
 #include <mutex>
 
+#include "TimerWheel.h"
+
 namespace Afina {
 namespace Backend {
 
 // See MapBasedGlobalLockImpl.h
 bool MapBasedGlobalLockImpl::Put(const std::string &key, const std::string &value)
+{
+    return Put(key, value, 0);
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Put(const std::string &key, const std::string &value, uint32_t ttl)
 {
     std::unique_lock<std::mutex> guard(_lock);
-    if( _backend.find(key) == _backend.end() )
+    return Store(key, value, ttl);
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Store(const std::string &key, const std::string &value, uint32_t ttl)
+{
+    uint32_t expires = ttl > 0 ? TimerWheel::Now() + ttl : 0;
+    auto it = Lookup(key);
+    if( it == _backend.end() )
     {
-        if( _order.size() + 1 > _max_size ) {
-            _backend.erase(_order.front());
-            _order.pop_front();
+        if( !Reserve(EntrySize(key.size(), value.size())) ) {
+            return false;
         }
-        _order.push_back(key);
+        it = _backend.emplace(key, Entry{value, _order.end(), expires}).first;
+        it->second.order = _order.insert(_order.end(), &it->first);
+    } else {
+        // Move entry to the back and exclude it from accounting, so it is evicted the last
+        _order.splice(_order.end(), _order, it->second.order);
+        _size -= EntrySize(key.size(), it->second.value.size());
+        if( !Reserve(EntrySize(key.size(), value.size())) ) {
+            _size += EntrySize(key.size(), it->second.value.size());
+            Remove(it);
+            return false;
+        }
+        it->second.value = value;
+        it->second.expires = expires;
     }
-    _backend[key] = value;
+    _size += EntrySize(key.size(), value.size());
     return true;
 }
 
 // See MapBasedGlobalLockImpl.h
 bool MapBasedGlobalLockImpl::PutIfAbsent(const std::string &key, const std::string &value)
+{
+    return PutIfAbsent(key, value, 0);
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::PutIfAbsent(const std::string &key, const std::string &value, uint32_t ttl)
 {
     std::unique_lock<std::mutex> guard(_lock);
-    //if( _backend.find(key) == _backend.end() )
-    if( _backend.count(key) == 0 )
+    if( Lookup(key) == _backend.end() )
     {
-        if( _order.size() + 1 > _max_size ) {
-            _backend.erase(_order.front());
-            _order.pop_front();
-        }
-        _order.push_back(key);
-        _backend[key] = value;
-        return true;
-    //    return Put(key, value);
+        return Store(key, value, ttl);
     }
     return false;
 }
 
 // See MapBasedGlobalLockImpl.h
 bool MapBasedGlobalLockImpl::Set(const std::string &key, const std::string &value)
+{
+    return Set(key, value, 0);
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Set(const std::string &key, const std::string &value, uint32_t ttl)
 {
     std::unique_lock<std::mutex> guard(_lock);
-    if( _backend.find(key) != _backend.end() )
+    if( Lookup(key) != _backend.end() )
     {
-        _backend[key] = value;
-        return true;
+        return Store(key, value, ttl);
     }
     return false;
 }
@@ -55,27 +85,120 @@ bool MapBasedGlobalLockImpl::Set(const std::string &key, const std::string &valu
 // See MapBasedGlobalLockImpl.h
 bool MapBasedGlobalLockImpl::Delete(const std::string &key)
 {
-    if( _backend.find(key) != _backend.end() )
+    std::unique_lock<std::mutex> guard(_lock);
+    auto it = Lookup(key);
+    if( it != _backend.end() )
     {
-        std::unique_lock<std::mutex> guard(_lock);
-        _backend.erase(key);
-        _order.remove(key);
+        Remove(it);
         return true;
     }
     return false;
 }
 
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Modify(const std::string &key, const Modifier &modify)
+{
+    std::unique_lock<std::mutex> guard(_lock);
+
+    // Time is taken before the lookup, so live entry expires after it and keeps non zero ttl
+    uint32_t now = TimerWheel::Now();
+    auto it = Lookup(key);
+    if( it == _backend.end() )
+    {
+        return false;
+    }
+
+    std::string value = it->second.value;
+    uint32_t ttl = it->second.expires != 0 ? it->second.expires - now : 0;
+    switch( modify(value, ttl) )
+    {
+    case Action::kStore:
+        return Store(key, value, ttl);
+    case Action::kRemove:
+        Remove(it);
+        return true;
+    default:
+        return true;
+    }
+}
+
 // See MapBasedGlobalLockImpl.h
 bool MapBasedGlobalLockImpl::Get(const std::string &key, std::string &value) const
 {
     std::unique_lock<std::mutex> guard(*const_cast<std::mutex *>(&_lock));
-    if( _backend.find(key) != _backend.end() )
+    auto it = _backend.find(key);
+    if( it != _backend.end() && (it->second.expires == 0 || it->second.expires > TimerWheel::Now()) )
     {
-        value = _backend.at(key);
+        value = it->second.value;
         return true;
     }
     return false;
 }
 
+// Values are copied, as map owns its strings, but lock is taken once for all keys
+// See MapBasedGlobalLockImpl.h
+size_t MapBasedGlobalLockImpl::MultiGet(const std::vector<std::string> &keys, std::vector<Value> &values) const
+{
+    values.clear();
+    values.resize(keys.size());
+
+    size_t found = 0;
+    uint32_t now = TimerWheel::Now();
+    std::unique_lock<std::mutex> guard(*const_cast<std::mutex *>(&_lock));
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        auto it = _backend.find(keys[i]);
+        if( it != _backend.end() && (it->second.expires == 0 || it->second.expires > now) )
+        {
+            values[i] = Value::Copy(it->second.value);
+            found++;
+        }
+    }
+    return found;
+}
+
+// See MapBasedGlobalLockImpl.h
+void MapBasedGlobalLockImpl::CollectStats(std::vector<std::pair<std::string, std::string>> &stats) const
+{
+    std::unique_lock<std::mutex> guard(*const_cast<std::mutex *>(&_lock));
+    stats.emplace_back("curr_items", std::to_string(_backend.size()));
+    stats.emplace_back("bytes", std::to_string(_size));
+    stats.emplace_back("limit_maxbytes", std::to_string(_max_size));
+    stats.emplace_back("evictions", std::to_string(_evictions));
+}
+
+// See MapBasedGlobalLockImpl.h
+std::map<std::string, MapBasedGlobalLockImpl::Entry>::iterator MapBasedGlobalLockImpl::Lookup(const std::string &key)
+{
+    auto it = _backend.find(key);
+    if( it != _backend.end() && it->second.expires != 0 && it->second.expires <= TimerWheel::Now() )
+    {
+        Remove(it);
+        return _backend.end();
+    }
+    return it;
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Reserve(size_t need)
+{
+    if( need > _max_size ) {
+        return false;
+    }
+    while( _size + need > _max_size ) {
+        Remove(_backend.find(*_order.front()));
+        _evictions++;
+    }
+    return true;
+}
+
+// See MapBasedGlobalLockImpl.h
+void MapBasedGlobalLockImpl::Remove(std::map<std::string, Entry>::iterator it)
+{
+    _size -= EntrySize(it->first.size(), it->second.value.size());
+    _order.erase(it->second.order);
+    _backend.erase(it);
+}
+
 } // namespace Backend
 } // namespace Afina
@@ -13,36 +13,98 @@ namespace Backend {
 
 /**
  * # Map based implementation with global lock
- *
- *
+ * Memory limit is accounted in bytes, each entry costs key and value size plus estimated
+ * overhead of map and list nodes. Expiration is checked lazily on access only, expired entries
+ * not accessed anymore are pushed out by eviction
  */
 class MapBasedGlobalLockImpl : public Afina::Storage {
 public:
-    MapBasedGlobalLockImpl(size_t max_size = 1024) : _max_size(max_size) {}
+    MapBasedGlobalLockImpl(size_t max_size = 64 * 1024 * 1024) : _max_size(max_size), _size(0), _evictions(0) {}
     ~MapBasedGlobalLockImpl() {}
 
     // Implements Afina::Storage interface
     bool Put(const std::string &key, const std::string &value) override;
 
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, const std::string &value, uint32_t ttl) override;
+
     // Implements Afina::Storage interface
     bool PutIfAbsent(const std::string &key, const std::string &value) override;
 
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value, uint32_t ttl) override;
+
     // Implements Afina::Storage interface
     bool Set(const std::string &key, const std::string &value) override;
 
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value, uint32_t ttl) override;
+
     // Implements Afina::Storage interface
     bool Delete(const std::string &key) override;
 
+    // Implements Afina::Storage interface
+    bool Modify(const std::string &key, const Modifier &modify) override;
+
     // Implements Afina::Storage interface
     bool Get(const std::string &key, std::string &value) const override;
 
+    // Implements Afina::Storage interface
+    size_t MultiGet(const std::vector<std::string> &keys, std::vector<Value> &values) const override;
+
+    // Implements Afina::Storage interface
+    void CollectStats(std::vector<std::pair<std::string, std::string>> &stats) const override;
+
+    /**
+     * Number of bytes accounted for the entry with given key and value sizes
+     */
+    static size_t EntrySize(size_t key_size, size_t value_size) {
+        // map node with key and value strings, list node pointing back to the key
+        return key_size + value_size + 2 * sizeof(std::string) + 4 * sizeof(void *) + 3 * sizeof(void *);
+    }
+
 private:
+    // LRU order, most recently inserted keys are at the back. Elements points to the map keys
+    typedef std::list<const std::string *> Order;
+
+    struct Entry {
+        std::string value;
+        Order::iterator order;
+
+        // Time entry expires at, zero if never
+        uint32_t expires;
+    };
+
+    /**
+     * Inserts or updates entry, lock must be held by caller
+     */
+    bool Store(const std::string &key, const std::string &value, uint32_t ttl);
+
+    /**
+     * Finds entry by key, expired entry is removed and reported as absent
+     */
+    std::map<std::string, Entry>::iterator Lookup(const std::string &key);
+
+    /**
+     * Removes oldest entries until given number of bytes fits, returns false if it never could
+     */
+    bool Reserve(size_t need);
+
+    /**
+     * Removes entry pointed by the given iterator
+     */
+    void Remove(std::map<std::string, Entry>::iterator it);
+
     std::mutex _lock;
 
     size_t _max_size;
 
-    std::map<std::string, std::string> _backend;
-    std::list<std::string> _order;
+    size_t _size;
+
+    size_t _evictions;
+
+    std::map<std::string, Entry> _backend;
+    Order _order;
 };
 
 } // namespace Backend
@@ -0,0 +1,480 @@
+#include "RCUHashImpl.h"
+
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include <afina/allocator/Concurrent.h>
+
+#include "Epoch.h"
+#include "SimpleLRU.h"
+
+namespace Afina {
+namespace Backend {
+
+// Expected average entry size, used to choose number of buckets
+static const size_t ExpectedEntrySize = 256;
+
+// Maximum number of entries reclaimed under a stripe lock at once
+static const size_t ReapBatch = 256;
+
+// Entries of all instances share the same allocator: node could be released by a value handle after the
+// storage is gone, and blocks freed by one storage are reused by others. Allocator is never destroyed,
+// so that it outlives threads that flush their magazines on exit
+static Allocator::Concurrent &Memory() {
+    static Allocator::Concurrent *memory = new Allocator::Concurrent();
+    return *memory;
+}
+
+// Expiration time for the entry with given ttl, zero if entry never expires
+static uint32_t Deadline(uint32_t ttl) { return ttl > 0 ? TimerWheel::Now() + ttl : 0; }
+
+// See RCUHashImpl.h
+RCUHashImpl::RCUHashImpl(size_t max_size, size_t n_stripes) : _reaper([this] { return Expire(ReapBatch); }) {
+    if (n_stripes == 0 || (n_stripes & (n_stripes - 1)) != 0) {
+        throw std::invalid_argument("Number of stripes must be a power of 2");
+    }
+
+    // Table is never resized, so it is sized to hold expected number of entries right away
+    size_t n_buckets = n_stripes;
+    while (n_buckets < max_size / ExpectedEntrySize) {
+        n_buckets <<= 1;
+    }
+
+    _buckets_mask = n_buckets - 1;
+    _buckets.reset(new std::atomic<Node *>[n_buckets]);
+    for (size_t i = 0; i < n_buckets; i++) {
+        _buckets[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    _stripes_mask = n_stripes - 1;
+    _stripes.reserve(n_stripes);
+    for (size_t i = 0; i < n_stripes; i++) {
+        _stripes.emplace_back(new Stripe(max_size / n_stripes));
+    }
+}
+
+// Storage must not be accessed concurrently with destruction, so table references are dropped right away
+// See RCUHashImpl.h
+RCUHashImpl::~RCUHashImpl() {
+    _reaper.Stop();
+    for (auto &stripe : _stripes) {
+        Node *node = stripe->head;
+        while (node != nullptr) {
+            Node *older = node->older;
+            node->Unref();
+            node = older;
+        }
+    }
+}
+
+// See RCUHashImpl.h
+void RCUHashImpl::Start() { _reaper.Start(); }
+
+// See RCUHashImpl.h
+void RCUHashImpl::Stop() { _reaper.Stop(); }
+
+// See RCUHashImpl.h
+bool RCUHashImpl::Put(const std::string &key, const std::string &value) { return Put(key, value, 0); }
+
+// See RCUHashImpl.h
+bool RCUHashImpl::Put(const std::string &key, const std::string &value, uint32_t ttl) {
+    size_t hash = HashKey(key.data(), key.size());
+    Stripe &stripe = StripeFor(hash);
+    std::unique_lock<std::mutex> guard(stripe.lock);
+
+    std::atomic<Node *> *link = FindLive(stripe, key, hash);
+    if (link->load(std::memory_order_relaxed) != nullptr) {
+        return Replace(stripe, link, value, ttl);
+    }
+    return Insert(stripe, key, value, hash, ttl);
+}
+
+// See RCUHashImpl.h
+bool RCUHashImpl::PutIfAbsent(const std::string &key, const std::string &value) {
+    return PutIfAbsent(key, value, 0);
+}
+
+// See RCUHashImpl.h
+bool RCUHashImpl::PutIfAbsent(const std::string &key, const std::string &value, uint32_t ttl) {
+    size_t hash = HashKey(key.data(), key.size());
+    Stripe &stripe = StripeFor(hash);
+    std::unique_lock<std::mutex> guard(stripe.lock);
+
+    std::atomic<Node *> *link = FindLive(stripe, key, hash);
+    if (link->load(std::memory_order_relaxed) != nullptr) {
+        return false;
+    }
+    return Insert(stripe, key, value, hash, ttl);
+}
+
+// See RCUHashImpl.h
+bool RCUHashImpl::Set(const std::string &key, const std::string &value) { return Set(key, value, 0); }
+
+// See RCUHashImpl.h
+bool RCUHashImpl::Set(const std::string &key, const std::string &value, uint32_t ttl) {
+    size_t hash = HashKey(key.data(), key.size());
+    Stripe &stripe = StripeFor(hash);
+    std::unique_lock<std::mutex> guard(stripe.lock);
+
+    std::atomic<Node *> *link = FindLive(stripe, key, hash);
+    if (link->load(std::memory_order_relaxed) == nullptr) {
+        return false;
+    }
+    return Replace(stripe, link, value, ttl);
+}
+
+// See RCUHashImpl.h
+bool RCUHashImpl::Delete(const std::string &key) {
+    size_t hash = HashKey(key.data(), key.size());
+    Stripe &stripe = StripeFor(hash);
+    std::unique_lock<std::mutex> guard(stripe.lock);
+
+    std::atomic<Node *> *link = FindLive(stripe, key, hash);
+    if (link->load(std::memory_order_relaxed) == nullptr) {
+        return false;
+    }
+
+    Remove(stripe, link);
+    return true;
+}
+
+// Readers keep seeing the old entry until modified one replaces it
+// See RCUHashImpl.h
+bool RCUHashImpl::Modify(const std::string &key, const Modifier &modify) {
+    size_t hash = HashKey(key.data(), key.size());
+    Stripe &stripe = StripeFor(hash);
+    std::unique_lock<std::mutex> guard(stripe.lock);
+
+    // Time is taken before the lookup, so live entry expires after it and keeps non zero ttl
+    uint32_t now = TimerWheel::Now();
+    std::atomic<Node *> *link = FindLive(stripe, key, hash);
+    Node *node = link->load(std::memory_order_relaxed);
+    if (node == nullptr) {
+        return false;
+    }
+
+    std::string value(node->value(), node->value_size);
+    uint32_t ttl = node->expires != 0 ? node->expires - now : 0;
+    switch (modify(value, ttl)) {
+    case Action::kStore:
+        return Replace(stripe, link, value, ttl);
+    case Action::kRemove:
+        Remove(stripe, link);
+        return true;
+    default:
+        return true;
+    }
+}
+
+// See RCUHashImpl.h
+bool RCUHashImpl::Get(const std::string &key, std::string &value) const {
+    Epoch::Guard guard;
+    Node *node = Find(key, HashKey(key.data(), key.size()));
+    if (node == nullptr) {
+        return false;
+    }
+
+    value.assign(node->value(), node->value_size);
+    return true;
+}
+
+// Reference is taken inside of read section, so entry can't be reclaimed meanwhile. Once
+// section is over entry lives as long as handle does, even if it gets replaced
+// See RCUHashImpl.h
+bool RCUHashImpl::GetValue(const std::string &key, Value &value) const {
+    Epoch::Guard guard;
+    Node *node = Find(key, HashKey(key.data(), key.size()));
+    if (node == nullptr) {
+        return false;
+    }
+
+    value = Value(node, node->value(), node->value_size);
+    return true;
+}
+
+// Whole batch is looked up in one read section. Buckets of all keys are prefetched while keys are
+// hashed, so chains are mostly in cache once lookups start
+// See RCUHashImpl.h
+size_t RCUHashImpl::MultiGet(const std::vector<std::string> &keys, std::vector<Value> &values) const {
+    values.clear();
+    values.resize(keys.size());
+
+    std::vector<size_t> hashes(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+        hashes[i] = HashKey(keys[i].data(), keys[i].size());
+        __builtin_prefetch(&BucketFor(hashes[i]));
+    }
+
+    size_t found = 0;
+    Epoch::Guard guard;
+    for (size_t i = 0; i < keys.size(); i++) {
+        Node *node = Find(keys[i], hashes[i]);
+        if (node != nullptr) {
+            values[i] = Value(node, node->value(), node->value_size);
+            found++;
+        }
+    }
+    return found;
+}
+
+// See RCUHashImpl.h
+void RCUHashImpl::CollectStats(std::vector<std::pair<std::string, std::string>> &stats) const {
+    size_t count = 0, size = 0, max_size = 0, evictions = 0, expirations = 0;
+    for (auto &stripe : _stripes) {
+        std::unique_lock<std::mutex> guard(stripe->lock);
+        count += stripe->count;
+        size += stripe->size;
+        max_size += stripe->max_size;
+        evictions += stripe->evictions;
+        expirations += stripe->expirations;
+    }
+
+    stats.emplace_back("curr_items", std::to_string(count));
+    stats.emplace_back("bytes", std::to_string(size));
+    stats.emplace_back("limit_maxbytes", std::to_string(max_size));
+    stats.emplace_back("evictions", std::to_string(evictions));
+    stats.emplace_back("expired", std::to_string(expirations));
+    stats.emplace_back("hash_buckets", std::to_string(_buckets_mask + 1));
+    stats.emplace_back("epoch_pending", std::to_string(Epoch::Pending()));
+}
+
+// See RCUHashImpl.h
+bool RCUHashImpl::Expire(size_t limit) {
+    bool more = false;
+    for (auto &stripe : _stripes) {
+        std::unique_lock<std::mutex> guard(stripe->lock);
+        more |= Expire(*stripe, limit) == limit;
+    }
+    return more;
+}
+
+// Bucket array is preallocated, each entry is charged for one bucket
+// See RCUHashImpl.h
+size_t RCUHashImpl::EntrySize(size_t key_size, size_t value_size) {
+    return sizeof(Node) + sizeof(std::atomic<Node *>) + key_size + value_size;
+}
+
+// See RCUHashImpl.h
+RCUHashImpl::Node *RCUHashImpl::Allocate(const char *key, size_t key_size, const std::string &value, size_t hash,
+                                         uint32_t expires) {
+    void *memory = Memory().Alloc(sizeof(Node) + key_size + value.size());
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    Node *node = new (memory) Node;
+    node->next.store(nullptr, std::memory_order_relaxed);
+    node->referenced.store(false, std::memory_order_relaxed);
+    node->older = nullptr;
+    node->newer = nullptr;
+    node->hash = hash;
+    node->key_size = key_size;
+    node->value_size = value.size();
+    node->expires = expires;
+    std::memcpy(node->key(), key, key_size);
+    std::memcpy(node->value(), value.data(), value.size());
+    return node;
+}
+
+// See RCUHashImpl.h
+void RCUHashImpl::Reclaim(void *node) { static_cast<Node *>(node)->Unref(); }
+
+// See RCUHashImpl.h
+void RCUHashImpl::Node::Release() {
+    size_t size = sizeof(Node) + key_size + value_size;
+    this->~Node();
+    Memory().Free(this, size);
+}
+
+// Read path: no locks and no writes to shared memory except of the referenced bit, which is
+// written only once per eviction cycle to not bounce cache line between readers
+// See RCUHashImpl.h
+RCUHashImpl::Node *RCUHashImpl::Find(const std::string &key, size_t hash) const {
+    Node *node = BucketFor(hash).load(std::memory_order_acquire);
+    for (; node != nullptr; node = node->next.load(std::memory_order_acquire)) {
+        if (node->hash == hash && node->key_size == key.size() &&
+            std::memcmp(node->key(), key.data(), key.size()) == 0) {
+            break;
+        }
+    }
+
+    if (node == nullptr || node->Expired(TimerWheel::Now())) {
+        return nullptr;
+    }
+
+    if (!node->referenced.load(std::memory_order_relaxed)) {
+        node->referenced.store(true, std::memory_order_relaxed);
+    }
+    return node;
+}
+
+// See RCUHashImpl.h
+std::atomic<RCUHashImpl::Node *> *RCUHashImpl::FindLink(const char *key, size_t key_size, size_t hash) const {
+    std::atomic<Node *> *link = &BucketFor(hash);
+    for (Node *node = link->load(std::memory_order_relaxed); node != nullptr;
+         node = link->load(std::memory_order_relaxed)) {
+        if (node->hash == hash && node->key_size == key_size && std::memcmp(node->key(), key, key_size) == 0) {
+            break;
+        }
+        link = &node->next;
+    }
+    return link;
+}
+
+// See RCUHashImpl.h
+std::atomic<RCUHashImpl::Node *> *RCUHashImpl::FindLive(Stripe &stripe, const std::string &key, size_t hash) {
+    std::atomic<Node *> *link = FindLink(key.data(), key.size(), hash);
+    Node *node = link->load(std::memory_order_relaxed);
+    if (node != nullptr && node->Expired(TimerWheel::Now())) {
+        Remove(stripe, link);
+        stripe.expirations++;
+    }
+    return link;
+}
+
+// See RCUHashImpl.h
+void RCUHashImpl::Link(Stripe &stripe, Node *node) {
+    node->newer = nullptr;
+    node->older = stripe.head;
+    if (stripe.head != nullptr) {
+        stripe.head->newer = node;
+    } else {
+        stripe.tail = node;
+    }
+    stripe.head = node;
+}
+
+// See RCUHashImpl.h
+void RCUHashImpl::Unlink(Stripe &stripe, Node *node) {
+    if (node->newer != nullptr) {
+        node->newer->older = node->older;
+    } else {
+        stripe.head = node->older;
+    }
+
+    if (node->older != nullptr) {
+        node->older->newer = node->newer;
+    } else {
+        stripe.tail = node->newer;
+    }
+}
+
+// Evict entries until there is enough room for the given number of bytes. Expired entries are reclaimed
+// first, then entries referenced since the last pass of the hand get second chance. Returns false if
+// request could never fit into the stripe
+// See RCUHashImpl.h
+bool RCUHashImpl::Reserve(Stripe &stripe, size_t need, Node *exclude) {
+    if (need > stripe.max_size) {
+        return false;
+    }
+
+    while (stripe.size + need > stripe.max_size && Expire(stripe, 1) > 0) {
+    }
+
+    while (stripe.size + need > stripe.max_size) {
+        Node *victim = stripe.tail;
+        if (victim == exclude || victim->referenced.load(std::memory_order_relaxed)) {
+            victim->referenced.store(false, std::memory_order_relaxed);
+            Unlink(stripe, victim);
+            Link(stripe, victim);
+            continue;
+        }
+
+        Remove(stripe, FindLink(victim->key(), victim->key_size, victim->hash));
+        stripe.evictions++;
+    }
+    return true;
+}
+
+// See RCUHashImpl.h
+bool RCUHashImpl::Insert(Stripe &stripe, const std::string &key, const std::string &value, size_t hash,
+                         uint32_t ttl) {
+    if (!Reserve(stripe, EntrySize(key.size(), value.size()), nullptr)) {
+        return false;
+    }
+
+    // Entry must be fully initialized before it becomes reachable, release store guarantees that
+    Node *node = Allocate(key.data(), key.size(), value, hash, Deadline(ttl));
+    std::atomic<Node *> &bucket = BucketFor(hash);
+    node->next.store(bucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    bucket.store(node, std::memory_order_release);
+    Link(stripe, node);
+    if (node->expires != 0) {
+        stripe.timers.Schedule(node, node->expires);
+    }
+
+    stripe.size += EntrySize(key.size(), value.size());
+    stripe.count++;
+    return true;
+}
+
+// See RCUHashImpl.h
+bool RCUHashImpl::Replace(Stripe &stripe, std::atomic<Node *> *link, const std::string &value, uint32_t ttl) {
+    Node *old = link->load(std::memory_order_relaxed);
+
+    // Old entry is excluded from accounting and expiration while making room, eviction could unlink
+    // its chain neighbours, so link must be looked up again afterwards
+    if (old->Scheduled()) {
+        stripe.timers.Cancel(old);
+    }
+    stripe.size -= EntrySize(old->key_size, old->value_size);
+    bool fits = Reserve(stripe, EntrySize(old->key_size, value.size()), old);
+    stripe.size += EntrySize(old->key_size, old->value_size);
+    link = FindLink(old->key(), old->key_size, old->hash);
+
+    if (!fits) {
+        Remove(stripe, link);
+        return false;
+    }
+
+    Node *node = Allocate(old->key(), old->key_size, value, old->hash, Deadline(ttl));
+    node->next.store(old->next.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    link->store(node, std::memory_order_release);
+
+    Unlink(stripe, old);
+    Link(stripe, node);
+    if (node->expires != 0) {
+        stripe.timers.Schedule(node, node->expires);
+    }
+    stripe.size += EntrySize(node->key_size, node->value_size);
+    stripe.size -= EntrySize(old->key_size, old->value_size);
+
+    Epoch::Retire(old, &RCUHashImpl::Reclaim);
+    return true;
+}
+
+// See RCUHashImpl.h
+void RCUHashImpl::Remove(Stripe &stripe, std::atomic<Node *> *link) {
+    Node *node = link->load(std::memory_order_relaxed);
+    link->store(node->next.load(std::memory_order_relaxed), std::memory_order_release);
+    Unlink(stripe, node);
+    if (node->Scheduled()) {
+        stripe.timers.Cancel(node);
+    }
+
+    stripe.size -= EntrySize(node->key_size, node->value_size);
+    stripe.count--;
+
+    Epoch::Retire(node, &RCUHashImpl::Reclaim);
+}
+
+// See RCUHashImpl.h
+size_t RCUHashImpl::Expire(Stripe &stripe, size_t limit) {
+    uint32_t now = TimerWheel::Now();
+
+    size_t removed = 0;
+    for (; removed < limit; removed++) {
+        Node *node = static_cast<Node *>(stripe.timers.Pop(now));
+        if (node == nullptr) {
+            break;
+        }
+
+        Remove(stripe, FindLink(node->key(), node->key_size, node->hash));
+        stripe.expirations++;
+    }
+    return removed;
+}
+
+} // namespace Backend
+} // namespace Afina
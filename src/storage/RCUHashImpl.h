@@ -0,0 +1,206 @@
+#ifndef AFINA_STORAGE_RCU_HASH_IMPL_H
+#define AFINA_STORAGE_RCU_HASH_IMPL_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <afina/Storage.h>
+
+#include "Reaper.h"
+#include "TimerWheel.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Hash table with lock free reads
+ * Readers never take a lock: buckets are chains of immutable entries linked by atomic pointers,
+ * writers publish new entries with a single atomic store and unlinked entries are reclaimed through
+ * epoch based reclamation, see Epoch.h.
+ *
+ * Writers are serialized per stripe. Each stripe owns a part of buckets together with its share of
+ * memory limit. As readers can't reorder entries, eviction uses CLOCK approximation of LRU: Get only
+ * marks entry as referenced and eviction gives referenced entries second chance.
+ *
+ * Expiration time is a part of immutable entry, readers just skip expired entries. Each stripe has its
+ * own timer wheel, expired entries are reclaimed by writers when found, before eviction and in
+ * background by batches of bounded size.
+ *
+ * Entries are allocated from the thread caching allocator, so writers of different stripes and the threads
+ * reclaiming retired entries don't contend on the heap
+ */
+class RCUHashImpl : public Afina::Storage {
+public:
+    RCUHashImpl(size_t max_size = 64 * 1024 * 1024, size_t n_stripes = 16);
+    ~RCUHashImpl();
+
+    // Implements Afina::Storage interface
+    void Start() override;
+
+    // Implements Afina::Storage interface
+    void Stop() override;
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, const std::string &value, uint32_t ttl) override;
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value, uint32_t ttl) override;
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value, uint32_t ttl) override;
+
+    // Implements Afina::Storage interface
+    bool Delete(const std::string &key) override;
+
+    // Implements Afina::Storage interface
+    bool Modify(const std::string &key, const Modifier &modify) override;
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value) const override;
+
+    // Implements Afina::Storage interface
+    bool GetValue(const std::string &key, Value &value) const override;
+
+    // Implements Afina::Storage interface
+    size_t MultiGet(const std::vector<std::string> &keys, std::vector<Value> &values) const override;
+
+    // Implements Afina::Storage interface
+    void CollectStats(std::vector<std::pair<std::string, std::string>> &stats) const override;
+
+    /**
+     * Removes up to given number of expired entries from every stripe, returns true if some stripe
+     * has more of them
+     */
+    bool Expire(size_t limit);
+
+    /**
+     * Number of bytes accounted for the entry with given key and value sizes
+     */
+    static size_t EntrySize(size_t key_size, size_t value_size);
+
+private:
+    RCUHashImpl(const RCUHashImpl &);            // = delete;
+    RCUHashImpl &operator=(const RCUHashImpl &); // = delete;
+
+    /**
+     * Entry is immutable once published, update replaces it by the new one. Key and value bytes
+     * follows right after the header. Table holds one reference and drops it once unlinked entry
+     * is reclaimed, readers could take their own references while inside of read section. Timer is
+     * accessed by writers only
+     */
+    struct Node : public Value::Holder, public TimerWheel::Timer {
+        // Next entry in the bucket chain, the only link readers follow
+        std::atomic<Node *> next;
+
+        // Set by readers, cleared by eviction hand
+        std::atomic<bool> referenced;
+
+        // Eviction order inside of stripe, accessed by writers only
+        Node *older;
+        Node *newer;
+
+        size_t hash;
+        uint32_t key_size;
+        uint32_t value_size;
+
+        // Time entry expires at, zero if never
+        uint32_t expires;
+
+        char *key() { return reinterpret_cast<char *>(this + 1); }
+        char *value() { return key() + key_size; }
+
+        bool Expired(uint32_t now) const { return expires != 0 && expires <= now; }
+
+    protected:
+        void Release() override;
+    };
+
+    /**
+     * Set of buckets sharing the same writer lock and memory budget
+     */
+    struct Stripe {
+        std::mutex lock;
+
+        size_t max_size;
+        size_t size;
+        size_t count;
+        size_t evictions;
+        size_t expirations;
+
+        // Eviction order, newest entries are inserted at the head, hand moves from the tail
+        Node *head;
+        Node *tail;
+
+        // Entries with ttl
+        TimerWheel timers;
+
+        Stripe(size_t max_size)
+            : max_size(max_size), size(0), count(0), evictions(0), expirations(0), head(nullptr), tail(nullptr) {}
+    };
+
+    static Node *Allocate(const char *key, size_t key_size, const std::string &value, size_t hash,
+                          uint32_t expires);
+
+    // Epoch reclamation callback, drops reference held by the table
+    static void Reclaim(void *node);
+
+    // Stripe is chosen by the low bits of bucket index, so all entries of a bucket share the same stripe
+    Stripe &StripeFor(size_t hash) const { return *_stripes[hash & _stripes_mask]; }
+    std::atomic<Node *> &BucketFor(size_t hash) const { return _buckets[hash & _buckets_mask]; }
+
+    /**
+     * Lookup entry by key, must be called from inside of read section
+     */
+    Node *Find(const std::string &key, size_t hash) const;
+
+    /**
+     * Returns link pointing to the entry with given key or to the end of chain if there is no such entry.
+     * Stripe lock must be held
+     */
+    std::atomic<Node *> *FindLink(const char *key, size_t key_size, size_t hash) const;
+
+    /**
+     * Same as FindLink, but expired entry found is removed and reported as absent
+     */
+    std::atomic<Node *> *FindLive(Stripe &stripe, const std::string &key, size_t hash);
+
+    // Writer side helpers, stripe lock must be held
+    void Link(Stripe &stripe, Node *node);
+    void Unlink(Stripe &stripe, Node *node);
+    bool Reserve(Stripe &stripe, size_t need, Node *exclude);
+    bool Insert(Stripe &stripe, const std::string &key, const std::string &value, size_t hash, uint32_t ttl);
+    bool Replace(Stripe &stripe, std::atomic<Node *> *link, const std::string &value, uint32_t ttl);
+    void Remove(Stripe &stripe, std::atomic<Node *> *link);
+    size_t Expire(Stripe &stripe, size_t limit);
+
+    // Mask to find bucket by hash, number of buckets is a power of 2
+    size_t _buckets_mask;
+
+    // Mask to find stripe by hash, number of stripes is a power of 2 and never exceeds number of buckets
+    size_t _stripes_mask;
+
+    std::unique_ptr<std::atomic<Node *>[]> _buckets;
+
+    // Each stripe allocated separately, so that hot locks don't share cache lines
+    std::vector<std::unique_ptr<Stripe>> _stripes;
+
+    Reaper _reaper;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_RCU_HASH_IMPL_H
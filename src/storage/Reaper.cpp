@@ -0,0 +1,52 @@
+#include "Reaper.h"
+
+namespace Afina {
+namespace Backend {
+
+// See Reaper.h
+Reaper::Reaper(std::function<bool()> reap, std::chrono::milliseconds interval)
+    : _reap(reap), _interval(interval), _running(false) {}
+
+// See Reaper.h
+Reaper::~Reaper() { Stop(); }
+
+// See Reaper.h
+void Reaper::Start() {
+    std::unique_lock<std::mutex> guard(_lock);
+    if (_running) {
+        return;
+    }
+
+    _running = true;
+    _thread = std::thread(&Reaper::Run, this);
+}
+
+// See Reaper.h
+void Reaper::Stop() {
+    {
+        std::unique_lock<std::mutex> guard(_lock);
+        _running = false;
+    }
+    _stop_requested.notify_all();
+
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+// See Reaper.h
+void Reaper::Run() {
+    std::unique_lock<std::mutex> guard(_lock);
+    while (_running) {
+        guard.unlock();
+        bool more = _reap();
+        guard.lock();
+
+        if (!more) {
+            _stop_requested.wait_for(guard, _interval, [this] { return !_running; });
+        }
+    }
+}
+
+} // namespace Backend
+} // namespace Afina
@@ -0,0 +1,53 @@
+#ifndef AFINA_STORAGE_REAPER_H
+#define AFINA_STORAGE_REAPER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Background expiration
+ * Thread that periodically calls given function to reclaim expired entries. Function is expected to
+ * do a bounded amount of work and return true if there is more to do, in that case it is called again
+ * right away. So storage locks are held only for short periods and workers are never stalled by a scan
+ */
+class Reaper {
+public:
+    Reaper(std::function<bool()> reap, std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+    ~Reaper();
+
+    /**
+     * Starts background thread, does nothing if it is running already
+     */
+    void Start();
+
+    /**
+     * Stops background thread and waits until it exits
+     */
+    void Stop();
+
+private:
+    Reaper(const Reaper &);            // = delete;
+    Reaper &operator=(const Reaper &); // = delete;
+
+    void Run();
+
+    std::function<bool()> _reap;
+    std::chrono::milliseconds _interval;
+
+    std::mutex _lock;
+    std::condition_variable _stop_requested;
+    bool _running;
+
+    std::thread _thread;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_REAPER_H
@@ -0,0 +1,625 @@
+#include "SimpleLRU.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace Afina {
+namespace Backend {
+
+// Initial number of slots in the hash index
+static const size_t IndexInitialCapacity = 16;
+
+// How far from the LRU tail entries of the required size class are looked for
+static const size_t RebalanceDepth = 64;
+
+// Number of keys each stage of batched lookup goes ahead of the next one
+static const size_t PrefetchDistance = 4;
+
+// Slabs are sized so that storage holds a few dozens of them
+static size_t SlabSizeFor(size_t limit) {
+    size_t slab_size = 16 * 1024;
+    while (slab_size < 1024 * 1024 && slab_size * 64 <= limit) {
+        slab_size <<= 1;
+    }
+    return slab_size;
+}
+
+// See SimpleLRU.h
+size_t HashKey(const char *key, size_t size) {
+    // FNV-1a followed by murmur3 finalizer, so that low bits used for slot position are well mixed
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(key[i]);
+        hash *= 1099511628211ULL;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return static_cast<size_t>(hash);
+}
+
+// See SimpleLRU.h
+SimpleLRU::SimpleLRU(size_t max_size, size_t memory_quota)
+    : _max_size(max_size), _size(0), _evictions(0), _expirations(0), _count(0), _lru_head(nullptr), _lru_tail(nullptr),
+      _index(IndexInitialCapacity, Slot{0, nullptr}),
+      _slabs(SlabSizeFor(std::max(max_size, memory_quota)), memory_quota), _memory(_slabs), _buried(nullptr),
+      _hold_buried(false) {}
+
+// See SimpleLRU.h
+SimpleLRU::~SimpleLRU() {
+    Node *node = _lru_head;
+    while (node != nullptr) {
+        Node *next = node->next;
+        node->Unref();
+        node = next;
+    }
+    FreeBuried();
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::Put(const std::string &key, const std::string &value) { return SimpleLRU::Put(key, value, 0); }
+
+// See SimpleLRU.h
+bool SimpleLRU::Put(const std::string &key, const std::string &value, uint32_t ttl) {
+    size_t hash = HashKey(key.data(), key.size());
+    size_t pos = FindLive(key, hash);
+    if (_index[pos].node != nullptr) {
+        return Update(pos, value, ttl);
+    }
+    return Insert(key, value, hash, ttl);
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::PutIfAbsent(const std::string &key, const std::string &value) {
+    return SimpleLRU::PutIfAbsent(key, value, 0);
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::PutIfAbsent(const std::string &key, const std::string &value, uint32_t ttl) {
+    size_t hash = HashKey(key.data(), key.size());
+    size_t pos = FindLive(key, hash);
+    if (_index[pos].node != nullptr) {
+        return false;
+    }
+    return Insert(key, value, hash, ttl);
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::Set(const std::string &key, const std::string &value) { return SimpleLRU::Set(key, value, 0); }
+
+// See SimpleLRU.h
+bool SimpleLRU::Set(const std::string &key, const std::string &value, uint32_t ttl) {
+    size_t hash = HashKey(key.data(), key.size());
+    size_t pos = FindLive(key, hash);
+    if (_index[pos].node == nullptr) {
+        return false;
+    }
+    return Update(pos, value, ttl);
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::Delete(const std::string &key) {
+    size_t hash = HashKey(key.data(), key.size());
+    size_t pos = FindLive(key, hash);
+    if (_index[pos].node == nullptr) {
+        return false;
+    }
+
+    Remove(pos);
+    return true;
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::Modify(const std::string &key, const Modifier &modify) {
+    // Time is taken before the lookup, so live entry has its deadline after it and keeps non zero ttl
+    uint32_t now = TimerWheel::Now();
+    size_t hash = HashKey(key.data(), key.size());
+    size_t pos = FindLive(key, hash);
+    Node *node = _index[pos].node;
+    if (node == nullptr) {
+        return false;
+    }
+
+    std::string value(node->value(), node->value_size);
+    uint32_t ttl = node->Scheduled() ? node->deadline - now : 0;
+    switch (modify(value, ttl)) {
+    case Action::kStore:
+        return Update(pos, value, ttl);
+    case Action::kRemove:
+        Remove(pos);
+        return true;
+    default:
+        return true;
+    }
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::Get(const std::string &key, std::string &value) const {
+    size_t hash = HashKey(key.data(), key.size());
+    size_t pos = FindSlot(key.data(), key.size(), hash);
+    Node *node = _index[pos].node;
+    if (node == nullptr || node->Expired(TimerWheel::Now())) {
+        return false;
+    }
+
+    Unlink(node);
+    LinkFront(node);
+    value.assign(node->value(), node->value_size);
+    return true;
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::GetValue(const std::string &key, Value &value) const {
+    size_t hash = HashKey(key.data(), key.size());
+    size_t pos = FindSlot(key.data(), key.size(), hash);
+    Node *node = _index[pos].node;
+    if (node == nullptr || node->Expired(TimerWheel::Now())) {
+        return false;
+    }
+
+    Unlink(node);
+    LinkFront(node);
+    value = Value(node, node->value(), node->value_size);
+    return true;
+}
+
+// See SimpleLRU.h
+size_t SimpleLRU::MultiGet(const std::vector<std::string> &keys, std::vector<Value> &values) const {
+    values.clear();
+    values.resize(keys.size());
+
+    std::vector<size_t> hashes(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+        hashes[i] = HashKey(keys[i].data(), keys[i].size());
+    }
+    return GetValues(keys.data(), hashes.data(), nullptr, keys.size(), values.data());
+}
+
+// Lookup is pipelined in three stages: home slot of the key is prefetched, then the entry it points to
+// if hashes match, and only then the key is probed. Each stage works PrefetchDistance keys ahead of the
+// next one
+// See SimpleLRU.h
+size_t SimpleLRU::GetValues(const std::string *keys, const size_t *hashes, const uint32_t *indexes, size_t count,
+                            Value *values) const {
+    auto at = [indexes](size_t i) -> size_t { return indexes != nullptr ? indexes[i] : i; };
+    size_t mask = _index.size() - 1;
+    uint32_t now = TimerWheel::Now();
+
+    size_t found = 0;
+    for (size_t i = 0; i < count + 2 * PrefetchDistance; i++) {
+        if (i < count) {
+            __builtin_prefetch(&_index[hashes[at(i)] & mask]);
+        }
+
+        if (i >= PrefetchDistance && i < count + PrefetchDistance) {
+            size_t hash = hashes[at(i - PrefetchDistance)];
+            const Slot &slot = _index[hash & mask];
+            if (slot.node != nullptr && slot.hash == hash) {
+                __builtin_prefetch(slot.node);
+                __builtin_prefetch(slot.node->key());
+            }
+        }
+
+        if (i >= 2 * PrefetchDistance) {
+            size_t k = at(i - 2 * PrefetchDistance);
+            Node *node = _index[FindSlot(keys[k].data(), keys[k].size(), hashes[k])].node;
+            if (node == nullptr || node->Expired(now)) {
+                continue;
+            }
+
+            Unlink(node);
+            LinkFront(node);
+            values[k] = Value(node, node->value(), node->value_size);
+            found++;
+        }
+    }
+    return found;
+}
+
+// See SimpleLRU.h
+void SimpleLRU::CollectStats(std::vector<std::pair<std::string, std::string>> &stats) const {
+    stats.emplace_back("curr_items", std::to_string(_count));
+    stats.emplace_back("bytes", std::to_string(_size));
+    stats.emplace_back("limit_maxbytes", std::to_string(_max_size));
+    stats.emplace_back("evictions", std::to_string(_evictions));
+    stats.emplace_back("expired", std::to_string(_expirations));
+
+    std::vector<Allocator::SlabAllocator::ClassStats> slabs;
+    _memory.CollectStats(slabs);
+    AppendSlabStats(slabs, _slabs.Total(), stats);
+}
+
+// See SimpleLRU.h
+void SimpleLRU::AppendSlabStats(const std::vector<Allocator::SlabAllocator::ClassStats> &slabs, size_t memory,
+                                std::vector<std::pair<std::string, std::string>> &stats) {
+    stats.emplace_back("total_malloced", std::to_string(memory));
+    for (size_t i = 0; i < slabs.size(); i++) {
+        if (slabs[i].slabs == 0) {
+            continue;
+        }
+
+        std::string prefix = std::to_string(i) + ":";
+        stats.emplace_back(prefix + "chunk_size", std::to_string(slabs[i].size));
+        stats.emplace_back(prefix + "total_slabs", std::to_string(slabs[i].slabs));
+        stats.emplace_back(prefix + "used_chunks", std::to_string(slabs[i].used));
+        stats.emplace_back(prefix + "free_chunks", std::to_string(slabs[i].free));
+    }
+}
+
+// See SimpleLRU.h
+size_t SimpleLRU::Expire(size_t limit) {
+    uint32_t now = TimerWheel::Now();
+
+    size_t removed = 0;
+    for (; removed < limit; removed++) {
+        Node *node = static_cast<Node *>(_timers.Pop(now));
+        if (node == nullptr) {
+            break;
+        }
+
+        Remove(FindSlot(node->key(), node->key_size, node->hash));
+        _expirations++;
+    }
+    return removed;
+}
+
+// Index load factor is kept between 0.35 and 0.7, so each entry is charged for two slots
+// See SimpleLRU.h
+size_t SimpleLRU::EntrySize(size_t key_size, size_t value_size) {
+    return sizeof(Node) + 2 * sizeof(Slot) + key_size + value_size;
+}
+
+// Returns either position of slot holding the key or position of the empty slot where key
+// should be inserted. Table always has at least one empty slot so loop terminates
+// See SimpleLRU.h
+size_t SimpleLRU::FindSlot(const char *key, size_t size, size_t hash) const {
+    size_t mask = _index.size() - 1;
+    for (size_t pos = hash & mask;; pos = (pos + 1) & mask) {
+        const Slot &slot = _index[pos];
+        if (slot.node == nullptr) {
+            return pos;
+        }
+        if (slot.hash == hash && slot.node->key_size == size && std::memcmp(slot.node->key(), key, size) == 0) {
+            return pos;
+        }
+    }
+}
+
+// Same as FindSlot, but expired entry found is removed and reported as absent
+// See SimpleLRU.h
+size_t SimpleLRU::FindLive(const std::string &key, size_t hash) {
+    size_t pos = FindSlot(key.data(), key.size(), hash);
+    Node *node = _index[pos].node;
+    if (node != nullptr && node->Expired(TimerWheel::Now())) {
+        Remove(pos);
+        _expirations++;
+        pos = FindSlot(key.data(), key.size(), hash);
+    }
+    return pos;
+}
+
+// See SimpleLRU.h
+void SimpleLRU::InsertSlot(Node *node) {
+    size_t mask = _index.size() - 1;
+    size_t pos = node->hash & mask;
+    while (_index[pos].node != nullptr) {
+        pos = (pos + 1) & mask;
+    }
+    _index[pos].hash = node->hash;
+    _index[pos].node = node;
+}
+
+// Backward shift deletion: entries that follows erased slot in the same probe sequence are moved
+// back, so the table never contains tombstones and lookups stay short
+// See SimpleLRU.h
+void SimpleLRU::EraseSlot(size_t pos) {
+    size_t mask = _index.size() - 1;
+    size_t hole = pos;
+    for (size_t next = (hole + 1) & mask; _index[next].node != nullptr; next = (next + 1) & mask) {
+        size_t ideal = _index[next].hash & mask;
+
+        // Entry could be moved into the hole only if its ideal position is not in (hole, next]
+        bool stays = (hole <= next) ? (hole < ideal && ideal <= next) : (hole < ideal || ideal <= next);
+        if (!stays) {
+            _index[hole] = _index[next];
+            hole = next;
+        }
+    }
+    _index[hole].node = nullptr;
+    _index[hole].hash = 0;
+}
+
+// See SimpleLRU.h
+void SimpleLRU::Rehash(size_t capacity) {
+    std::vector<Slot> old(capacity, Slot{0, nullptr});
+    old.swap(_index);
+    for (const Slot &slot : old) {
+        if (slot.node != nullptr) {
+            InsertSlot(slot.node);
+        }
+    }
+}
+
+// See SimpleLRU.h
+void SimpleLRU::LinkFront(Node *node) const {
+    node->prev = nullptr;
+    node->next = _lru_head;
+    if (_lru_head != nullptr) {
+        _lru_head->prev = node;
+    } else {
+        _lru_tail = node;
+    }
+    _lru_head = node;
+}
+
+// See SimpleLRU.h
+void SimpleLRU::Unlink(Node *node) const {
+    if (node->prev != nullptr) {
+        node->prev->next = node->next;
+    } else {
+        _lru_head = node->next;
+    }
+
+    if (node->next != nullptr) {
+        node->next->prev = node->prev;
+    } else {
+        _lru_tail = node->prev;
+    }
+}
+
+// Returns nullptr if there is no memory for the entry even after rebalancing
+// See SimpleLRU.h
+SimpleLRU::Node *SimpleLRU::Allocate(const char *key, size_t key_size, const std::string &value, size_t hash,
+                                     Node *exclude) {
+    size_t size = sizeof(Node) + key_size + value.size();
+    void *memory = Obtain(size, exclude);
+    if (memory == nullptr) {
+        return nullptr;
+    }
+
+    // Whole block given by the size class is used, so the value could grow in place
+    Node *node = new (memory) Node;
+    node->prev = nullptr;
+    node->next = nullptr;
+    node->hash = hash;
+    node->key_size = key_size;
+    node->value_size = value.size();
+    node->capacity = _memory.RealSize(size) - sizeof(Node) - key_size;
+    node->owner = this;
+    std::memcpy(node->key(), key, key_size);
+    std::memcpy(node->value(), value.data(), value.size());
+    return node;
+}
+
+// See SimpleLRU.h
+void *SimpleLRU::Obtain(size_t size, Node *exclude) {
+    while (true) {
+        FreeBuried();
+
+        void *memory = _memory.Alloc(size);
+        if (memory != nullptr || !Rebalance(size, exclude)) {
+            return memory;
+        }
+    }
+}
+
+// Frees some memory to fit block of the given size, returns false if there is nothing to free
+// See SimpleLRU.h
+bool SimpleLRU::Rebalance(size_t size, Node *exclude) {
+    // Evicting entry of the same class frees exactly the block needed
+    size_t target = _memory.ClassOf(size);
+    Node *victim = _lru_tail;
+    for (size_t i = 0; i < RebalanceDepth && victim != nullptr; i++, victim = victim->prev) {
+        if (victim != exclude && _memory.ClassOf(BlockSize(victim)) == target) {
+            Evict(victim);
+            return true;
+        }
+    }
+
+    // Otherwise slab is moved from the class wasting the most of memory: its sparsest slab is
+    // released by evicting everything it holds
+    size_t donor = _memory.Classes(), wasted = 0;
+    for (size_t i = 0; i < _memory.Classes(); i++) {
+        const Allocator::Mempool &pool = _memory.Pool(i);
+        if (i != target && pool.Available() * pool.ObjectSize() > wasted) {
+            donor = i;
+            wasted = pool.Available() * pool.ObjectSize();
+        }
+    }
+
+    if (donor < _memory.Classes()) {
+        Allocator::Mempool &pool = _memory.Pool(donor);
+        std::vector<void *> objects;
+        FreeBuried();
+        pool.Objects(pool.Sparsest(), objects);
+
+        // Entries already removed but pinned by value handles are left in place. Handles could be
+        // dropped by other threads meanwhile, so blocks buried are freed only after the walk
+        bool freed = false;
+        _hold_buried = true;
+        for (void *object : objects) {
+            Node *node = static_cast<Node *>(object);
+            if (node != exclude && Evict(node)) {
+                freed = true;
+            }
+        }
+        _hold_buried = false;
+        FreeBuried();
+
+        if (freed) {
+            return true;
+        }
+    }
+
+    // Nothing better to do, just free some memory
+    victim = _lru_tail;
+    if (victim == exclude && victim != nullptr) {
+        victim = victim->prev;
+    }
+    if (victim == nullptr) {
+        return false;
+    }
+
+    Evict(victim);
+    return true;
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::Evict(Node *node) {
+    size_t pos = FindSlot(node->key(), node->key_size, node->hash);
+    if (_index[pos].node != node) {
+        return false;
+    }
+
+    Remove(pos);
+    _evictions++;
+    return true;
+}
+
+// See SimpleLRU.h
+void SimpleLRU::Bury(Node *node) {
+    Node *head = _buried.load(std::memory_order_relaxed);
+    do {
+        node->next = head;
+    } while (!_buried.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+}
+
+// See SimpleLRU.h
+void SimpleLRU::FreeBuried() {
+    if (_hold_buried || _buried.load(std::memory_order_relaxed) == nullptr) {
+        return;
+    }
+
+    Node *node = _buried.exchange(nullptr, std::memory_order_acquire);
+    while (node != nullptr) {
+        Node *next = node->next;
+        size_t size = BlockSize(node);
+        node->~Node();
+        _memory.Free(node, size);
+        node = next;
+    }
+}
+
+// Evict least recently used entries until there is enough room for the given number of bytes. Expired
+// entries are reclaimed first, so live ones are evicted only if there is no other way.
+// Returns false if request could never fit into the storage
+// See SimpleLRU.h
+bool SimpleLRU::Reserve(size_t need) {
+    if (need > _max_size) {
+        return false;
+    }
+
+    while (_size + need > _max_size && Expire(1) > 0) {
+    }
+
+    while (_size + need > _max_size) {
+        Node *victim = _lru_tail;
+        Remove(FindSlot(victim->key(), victim->key_size, victim->hash));
+        _evictions++;
+    }
+    return true;
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::Insert(const std::string &key, const std::string &value, size_t hash, uint32_t ttl) {
+    if (!Reserve(EntrySize(key.size(), value.size()))) {
+        return false;
+    }
+
+    // Keep load factor below 0.7 to have short probe sequences
+    if ((_count + 1) * 10 > _index.size() * 7) {
+        Rehash(_index.size() * 2);
+    }
+
+    Node *node = Allocate(key.data(), key.size(), value, hash, nullptr);
+    if (node == nullptr) {
+        return false;
+    }
+    InsertSlot(node);
+    LinkFront(node);
+    Schedule(node, ttl);
+
+    _size += EntrySize(key.size(), value.size());
+    _count++;
+    return true;
+}
+
+// See SimpleLRU.h
+bool SimpleLRU::Update(size_t pos, const std::string &value, uint32_t ttl) {
+    Node *node = _index[pos].node;
+
+    // Entry is moved to the front and excluded from accounting, so Reserve evicts everything
+    // else before it could reach the entry itself. Its timer is cancelled for the same reason, ttl
+    // gets replaced anyway. Eviction could shift index slots, so position must be looked up again
+    if (node->Scheduled()) {
+        _timers.Cancel(node);
+    }
+    Unlink(node);
+    LinkFront(node);
+    _size -= EntrySize(node->key_size, node->value_size);
+
+    Node *replace = node;
+    if (Reserve(EntrySize(node->key_size, value.size()))) {
+        // Bytes could be overwritten in place only if nobody holds a handle to them, otherwise
+        // entry is replaced by the new one at the same place
+        if (value.size() > node->capacity || !node->Unique()) {
+            replace = Allocate(node->key(), node->key_size, value, node->hash, node);
+        }
+    } else {
+        replace = nullptr;
+    }
+
+    if (replace == nullptr) {
+        _size += EntrySize(node->key_size, node->value_size);
+        Remove(FindSlot(node->key(), node->key_size, node->hash));
+        return false;
+    }
+
+    if (replace == node) {
+        std::memcpy(node->value(), value.data(), value.size());
+        node->value_size = value.size();
+    } else {
+        pos = FindSlot(node->key(), node->key_size, node->hash);
+        _index[pos].node = replace;
+
+        Unlink(node);
+        LinkFront(replace);
+        node->Unref();
+        FreeBuried();
+        node = replace;
+    }
+
+    _size += EntrySize(node->key_size, node->value_size);
+    Schedule(node, ttl);
+    return true;
+}
+
+// See SimpleLRU.h
+void SimpleLRU::Remove(size_t pos) {
+    Node *node = _index[pos].node;
+    EraseSlot(pos);
+    Unlink(node);
+    if (node->Scheduled()) {
+        _timers.Cancel(node);
+    }
+
+    _size -= EntrySize(node->key_size, node->value_size);
+    _count--;
+    node->Unref();
+    FreeBuried();
+}
+
+// See SimpleLRU.h
+void SimpleLRU::Schedule(Node *node, uint32_t ttl) {
+    if (ttl > 0) {
+        _timers.Schedule(node, TimerWheel::Now() + ttl);
+    }
+}
+
+// See SimpleLRU.h
+void SimpleLRU::Node::Release() { owner->Bury(this); }
+
+} // namespace Backend
+} // namespace Afina
@@ -0,0 +1,260 @@
+#ifndef AFINA_STORAGE_SIMPLE_LRU_H
+#define AFINA_STORAGE_SIMPLE_LRU_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <afina/Storage.h>
+#include <afina/allocator/Slab.h>
+
+#include "TimerWheel.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * Hash function used by all LRU based storages, both to index entries and to choose shard
+ */
+size_t HashKey(const char *key, size_t size);
+
+/**
+ * # Map based implementation
+ * That is NOT thread safe implementation!!
+ *
+ * Every entry is a single memory block that holds intrusive LRU links together with key and value
+ * bytes. Entries are indexed by open addressed hash table with linear probing, so Get, Put, Delete
+ * and promotion are all O(1). Memory limit is accounted in bytes, each entry costs its key and
+ * value size plus entry header and its share of the hash index.
+ *
+ * Entries with ttl are scheduled in the timer wheel. Expired entries are never visible to readers,
+ * writers remove them once found and Expire reclaims them in batches of bounded size.
+ *
+ * Entry blocks are taken from the slab allocator. If memory quota is set and new block doesn't fit
+ * into it, least recently used entries of the same size class are evicted. If there are no such
+ * entries near the LRU tail, the sparsest slab of another class is released by evicting everything
+ * it holds, so memory moves between classes as workload changes. Value handles must not outlive
+ * the storage
+ */
+class SimpleLRU : public Afina::Storage {
+public:
+    /**
+     * @param max_size maximum number of bytes accounted for entries, see EntrySize
+     * @param memory_quota maximum number of bytes allocator could take from the system, zero if unlimited
+     */
+    SimpleLRU(size_t max_size = 1024, size_t memory_quota = 0);
+    ~SimpleLRU();
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, const std::string &value, uint32_t ttl) override;
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value, uint32_t ttl) override;
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value, uint32_t ttl) override;
+
+    // Implements Afina::Storage interface
+    bool Delete(const std::string &key) override;
+
+    // Implements Afina::Storage interface
+    bool Modify(const std::string &key, const Modifier &modify) override;
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value) const override;
+
+    // Implements Afina::Storage interface
+    bool GetValue(const std::string &key, Value &value) const override;
+
+    // Implements Afina::Storage interface
+    size_t MultiGet(const std::vector<std::string> &keys, std::vector<Value> &values) const override;
+
+    /**
+     * Looks up keys with already computed hashes, see MultiGet. Key, hash and value are taken by each of
+     * the given indexes, or all of them in order if indexes is nullptr. Index slots and entries are
+     * prefetched few keys ahead of the probed one, so cache misses of different keys overlap
+     *
+     * @return number of keys found
+     */
+    size_t GetValues(const std::string *keys, const size_t *hashes, const uint32_t *indexes, size_t count,
+                     Value *values) const;
+
+    // Implements Afina::Storage interface
+    void CollectStats(std::vector<std::pair<std::string, std::string>> &stats) const override;
+
+    /**
+     * Removes up to given number of expired entries, returns number of removed ones
+     */
+    size_t Expire(size_t limit);
+
+    /**
+     * Number of entries in the storage
+     */
+    size_t Count() const { return _count; }
+
+    /**
+     * Number of bytes accounted for all entries
+     */
+    size_t Size() const { return _size; }
+
+    /**
+     * Maximum number of bytes storage could hold
+     */
+    size_t MaxSize() const { return _max_size; }
+
+    /**
+     * Number of entries removed to free space for the new ones
+     */
+    size_t Evictions() const { return _evictions; }
+
+    /**
+     * Number of expired entries removed
+     */
+    size_t Expirations() const { return _expirations; }
+
+    /**
+     * Number of bytes taken from the system for entries
+     */
+    size_t Memory() const { return _slabs.Total(); }
+
+    /**
+     * Adds per size class usage of the allocator to the output
+     */
+    void CollectSlabStats(std::vector<Allocator::SlabAllocator::ClassStats> &stats) const {
+        _memory.CollectStats(stats);
+    }
+
+    /**
+     * Appends per size class usage in memcached "stats slabs" format, classes without slabs are skipped
+     */
+    static void AppendSlabStats(const std::vector<Allocator::SlabAllocator::ClassStats> &slabs, size_t memory,
+                                std::vector<std::pair<std::string, std::string>> &stats);
+
+    /**
+     * Number of bytes accounted for the entry with given key and value sizes
+     */
+    static size_t EntrySize(size_t key_size, size_t value_size);
+
+private:
+    SimpleLRU(const SimpleLRU &);            // = delete;
+    SimpleLRU &operator=(const SimpleLRU &); // = delete;
+
+    /**
+     * Header of the entry memory block, key and value bytes follows right after it. Storage holds
+     * one reference, block is freed once storage and all value handles dropped theirs. Timer is
+     * scheduled only for entries with ttl
+     */
+    struct Node : public Value::Holder, public TimerWheel::Timer {
+        // Neighbours in LRU order, head is the most recently used entry
+        Node *prev;
+        Node *next;
+
+        // Cached hash of the key
+        size_t hash;
+
+        uint32_t key_size;
+        uint32_t value_size;
+
+        // Number of bytes available for value in this block
+        uint32_t capacity;
+
+        // Storage that owns the block, it must be freed back there
+        SimpleLRU *owner;
+
+        char *key() { return reinterpret_cast<char *>(this + 1); }
+        char *value() { return key() + key_size; }
+
+        bool Expired(uint32_t now) const { return Scheduled() && deadline <= now; }
+
+    protected:
+        void Release() override;
+    };
+
+    /**
+     * Cell of the hash index. Hash copy allows to skip most of mismatches without touching node memory
+     */
+    struct Slot {
+        size_t hash;
+        Node *node;
+    };
+
+    // Index helpers
+    size_t FindSlot(const char *key, size_t size, size_t hash) const;
+    size_t FindLive(const std::string &key, size_t hash);
+    void InsertSlot(Node *node);
+    void EraseSlot(size_t pos);
+    void Rehash(size_t capacity);
+
+    // LRU list helpers
+    void LinkFront(Node *node) const;
+    void Unlink(Node *node) const;
+
+    // Memory management. Blocks released by value handles are pushed to the lock free list by any
+    // thread and actually freed by writers
+    void *Obtain(size_t size, Node *exclude);
+    bool Rebalance(size_t size, Node *exclude);
+    bool Evict(Node *node);
+    void Bury(Node *node);
+    void FreeBuried();
+    static size_t BlockSize(const Node *node) { return sizeof(Node) + node->key_size + node->capacity; }
+
+    // Entries management
+    Node *Allocate(const char *key, size_t key_size, const std::string &value, size_t hash, Node *exclude);
+    bool Reserve(size_t need);
+    bool Insert(const std::string &key, const std::string &value, size_t hash, uint32_t ttl);
+    bool Update(size_t pos, const std::string &value, uint32_t ttl);
+    void Remove(size_t pos);
+    void Schedule(Node *node, uint32_t ttl);
+
+    // Maximum number of bytes could be stored in this cache.
+    // i.e all EntrySize(key, value) must be less the _max_size
+    size_t _max_size;
+
+    // Number of bytes used by all entries
+    size_t _size;
+
+    // Number of entries evicted
+    size_t _evictions;
+
+    // Number of expired entries removed
+    size_t _expirations;
+
+    // Number of entries
+    size_t _count;
+
+    // LRU order, Get is logically const but changes order of entries
+    mutable Node *_lru_head;
+    mutable Node *_lru_tail;
+
+    // Hash index, capacity is always power of 2
+    std::vector<Slot> _index;
+
+    // Deadlines of entries with ttl
+    TimerWheel _timers;
+
+    // Entries memory, allocator must be destroyed before the cache it takes slabs from
+    Allocator::SlabCache _slabs;
+    Allocator::SlabAllocator _memory;
+
+    // Blocks released outside of storage lock, waiting to be freed
+    std::atomic<Node *> _buried;
+
+    // Set while blocks of a slab are walked, none of them could be freed until walk is over
+    bool _hold_buried;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_SIMPLE_LRU_H
@@ -0,0 +1,191 @@
+#include "StripedLockImpl.h"
+
+#include <stdexcept>
+
+namespace Afina {
+namespace Backend {
+
+// Maximum number of entries reclaimed under a shard lock at once
+static const size_t ReapBatch = 256;
+
+// See StripedLockImpl.h
+StripedLockImpl::StripedLockImpl(size_t max_size, size_t n_shards, size_t memory_quota)
+    : _reaper([this] { return Reap(); }) {
+    if (n_shards == 0 || (n_shards & (n_shards - 1)) != 0) {
+        throw std::invalid_argument("Number of shards must be a power of 2");
+    }
+
+    _mask = n_shards - 1;
+    _shards.reserve(n_shards);
+    for (size_t i = 0; i < n_shards; i++) {
+        _shards.emplace_back(new Shard(max_size / n_shards, memory_quota / n_shards));
+    }
+}
+
+// See StripedLockImpl.h
+StripedLockImpl::~StripedLockImpl() { _reaper.Stop(); }
+
+// See StripedLockImpl.h
+void StripedLockImpl::Start() { _reaper.Start(); }
+
+// See StripedLockImpl.h
+void StripedLockImpl::Stop() { _reaper.Stop(); }
+
+// See StripedLockImpl.h
+bool StripedLockImpl::Put(const std::string &key, const std::string &value) {
+    Shard &shard = ShardFor(key);
+    std::unique_lock<std::mutex> guard(shard.lock);
+    return shard.storage.Put(key, value);
+}
+
+// See StripedLockImpl.h
+bool StripedLockImpl::Put(const std::string &key, const std::string &value, uint32_t ttl) {
+    Shard &shard = ShardFor(key);
+    std::unique_lock<std::mutex> guard(shard.lock);
+    return shard.storage.Put(key, value, ttl);
+}
+
+// See StripedLockImpl.h
+bool StripedLockImpl::PutIfAbsent(const std::string &key, const std::string &value) {
+    Shard &shard = ShardFor(key);
+    std::unique_lock<std::mutex> guard(shard.lock);
+    return shard.storage.PutIfAbsent(key, value);
+}
+
+// See StripedLockImpl.h
+bool StripedLockImpl::PutIfAbsent(const std::string &key, const std::string &value, uint32_t ttl) {
+    Shard &shard = ShardFor(key);
+    std::unique_lock<std::mutex> guard(shard.lock);
+    return shard.storage.PutIfAbsent(key, value, ttl);
+}
+
+// See StripedLockImpl.h
+bool StripedLockImpl::Set(const std::string &key, const std::string &value) {
+    Shard &shard = ShardFor(key);
+    std::unique_lock<std::mutex> guard(shard.lock);
+    return shard.storage.Set(key, value);
+}
+
+// See StripedLockImpl.h
+bool StripedLockImpl::Set(const std::string &key, const std::string &value, uint32_t ttl) {
+    Shard &shard = ShardFor(key);
+    std::unique_lock<std::mutex> guard(shard.lock);
+    return shard.storage.Set(key, value, ttl);
+}
+
+// See StripedLockImpl.h
+bool StripedLockImpl::Delete(const std::string &key) {
+    Shard &shard = ShardFor(key);
+    std::unique_lock<std::mutex> guard(shard.lock);
+    return shard.storage.Delete(key);
+}
+
+// See StripedLockImpl.h
+bool StripedLockImpl::Modify(const std::string &key, const Modifier &modify) {
+    Shard &shard = ShardFor(key);
+    std::unique_lock<std::mutex> guard(shard.lock);
+    return shard.storage.Modify(key, modify);
+}
+
+// See StripedLockImpl.h
+bool StripedLockImpl::Get(const std::string &key, std::string &value) const {
+    Shard &shard = ShardFor(key);
+    std::unique_lock<std::mutex> guard(shard.lock);
+    return shard.storage.Get(key, value);
+}
+
+// See StripedLockImpl.h
+bool StripedLockImpl::GetValue(const std::string &key, Value &value) const {
+    Shard &shard = ShardFor(key);
+    std::unique_lock<std::mutex> guard(shard.lock);
+    return shard.storage.GetValue(key, value);
+}
+
+// Keys are hashed and grouped by shard before any lock is taken, then every shard that has some of
+// the keys is locked once to look all of them up
+// See StripedLockImpl.h
+size_t StripedLockImpl::MultiGet(const std::vector<std::string> &keys, std::vector<Value> &values) const {
+    values.clear();
+    values.resize(keys.size());
+
+    // Counting sort of key indexes by shard, group of shard i starts at offsets[i]
+    std::vector<size_t> hashes(keys.size());
+    std::vector<uint32_t> shards(keys.size());
+    std::vector<size_t> offsets(_shards.size() + 1, 0);
+    for (size_t i = 0; i < keys.size(); i++) {
+        hashes[i] = HashKey(keys[i].data(), keys[i].size());
+        shards[i] = ShardIndex(hashes[i]);
+        offsets[shards[i] + 1]++;
+    }
+    for (size_t i = 0; i < _shards.size(); i++) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    std::vector<uint32_t> indexes(keys.size());
+    std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < keys.size(); i++) {
+        indexes[next[shards[i]]++] = i;
+    }
+
+    size_t found = 0;
+    for (size_t i = 0; i < _shards.size(); i++) {
+        size_t count = offsets[i + 1] - offsets[i];
+        if (count == 0) {
+            continue;
+        }
+
+        Shard &shard = *_shards[i];
+        std::unique_lock<std::mutex> guard(shard.lock);
+        found += shard.storage.GetValues(keys.data(), hashes.data(), indexes.data() + offsets[i], count, values.data());
+    }
+    return found;
+}
+
+// See StripedLockImpl.h
+void StripedLockImpl::CollectStats(std::vector<std::pair<std::string, std::string>> &stats) const {
+    size_t count = 0, size = 0, max_size = 0, evictions = 0, expirations = 0, memory = 0;
+    std::vector<Allocator::SlabAllocator::ClassStats> slabs;
+    for (auto &shard : _shards) {
+        std::unique_lock<std::mutex> guard(shard->lock);
+        count += shard->storage.Count();
+        size += shard->storage.Size();
+        max_size += shard->storage.MaxSize();
+        evictions += shard->storage.Evictions();
+        expirations += shard->storage.Expirations();
+        memory += shard->storage.Memory();
+        shard->storage.CollectSlabStats(slabs);
+    }
+
+    stats.emplace_back("curr_items", std::to_string(count));
+    stats.emplace_back("bytes", std::to_string(size));
+    stats.emplace_back("limit_maxbytes", std::to_string(max_size));
+    stats.emplace_back("evictions", std::to_string(evictions));
+    stats.emplace_back("expired", std::to_string(expirations));
+    stats.emplace_back("shards", std::to_string(_shards.size()));
+    SimpleLRU::AppendSlabStats(slabs, memory, stats);
+}
+
+// See StripedLockImpl.h
+StripedLockImpl::Shard &StripedLockImpl::ShardFor(const std::string &key) const {
+    return *_shards[ShardIndex(HashKey(key.data(), key.size()))];
+}
+
+// See StripedLockImpl.h
+size_t StripedLockImpl::ShardIndex(size_t hash) const {
+    // Shard index is taken from the high bits, so it doesn't correlate with the slot
+    // that the same key gets inside of shard's hash index
+    return (hash >> (sizeof(size_t) * 4)) & _mask;
+}
+
+// See StripedLockImpl.h
+bool StripedLockImpl::Reap() {
+    bool more = false;
+    for (auto &shard : _shards) {
+        std::unique_lock<std::mutex> guard(shard->lock);
+        more |= shard->storage.Expire(ReapBatch) == ReapBatch;
+    }
+    return more;
+}
+
+} // namespace Backend
+} // namespace Afina
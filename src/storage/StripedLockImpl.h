@@ -0,0 +1,108 @@
+#ifndef AFINA_STORAGE_STRIPED_LOCK_IMPL_H
+#define AFINA_STORAGE_STRIPED_LOCK_IMPL_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <afina/Storage.h>
+
+#include "Reaper.h"
+#include "SimpleLRU.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Hash partitioned implementation with lock per partition
+ * Keys are distributed across fixed number of shards by hash. Each shard has its own lock,
+ * LRU order and memory budget, so operations on different shards never contend with each
+ * other. Memory limit is accounted in bytes the same way as SimpleLRU does and split evenly
+ * between shards, as well as memory quota of shard allocators.
+ *
+ * Expired entries are reclaimed in background shard by shard, each shard lock is held only
+ * for a bounded batch
+ */
+class StripedLockImpl : public Afina::Storage {
+public:
+    StripedLockImpl(size_t max_size = 64 * 1024 * 1024, size_t n_shards = 16, size_t memory_quota = 0);
+    ~StripedLockImpl();
+
+    // Implements Afina::Storage interface
+    void Start() override;
+
+    // Implements Afina::Storage interface
+    void Stop() override;
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, const std::string &value, uint32_t ttl) override;
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value, uint32_t ttl) override;
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value, uint32_t ttl) override;
+
+    // Implements Afina::Storage interface
+    bool Delete(const std::string &key) override;
+
+    // Implements Afina::Storage interface
+    bool Modify(const std::string &key, const Modifier &modify) override;
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value) const override;
+
+    // Implements Afina::Storage interface
+    bool GetValue(const std::string &key, Value &value) const override;
+
+    // Implements Afina::Storage interface
+    size_t MultiGet(const std::vector<std::string> &keys, std::vector<Value> &values) const override;
+
+    // Implements Afina::Storage interface
+    void CollectStats(std::vector<std::pair<std::string, std::string>> &stats) const override;
+
+private:
+    /**
+     * Independent part of the storage
+     */
+    struct Shard {
+        // Protects storage below
+        std::mutex lock;
+
+        SimpleLRU storage;
+
+        Shard(size_t max_size, size_t memory_quota) : storage(max_size, memory_quota) {}
+    };
+
+    Shard &ShardFor(const std::string &key) const;
+
+    size_t ShardIndex(size_t hash) const;
+
+    /**
+     * Reclaims one batch of expired entries in every shard, returns true if some shard has more
+     */
+    bool Reap();
+
+    // Mask used to find shard index from the key hash, number of shards is always a power of 2
+    size_t _mask;
+
+    // Each shard allocated separately, so that hot locks don't share cache lines
+    std::vector<std::unique_ptr<Shard>> _shards;
+
+    Reaper _reaper;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_STRIPED_LOCK_IMPL_H
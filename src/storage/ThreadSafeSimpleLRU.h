@@ -0,0 +1,128 @@
+#ifndef AFINA_STORAGE_THREAD_SAFE_SIMPLE_LRU_H
+#define AFINA_STORAGE_THREAD_SAFE_SIMPLE_LRU_H
+
+#include <mutex>
+#include <string>
+
+#include "Reaper.h"
+#include "SimpleLRU.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # SimpleLRU thread safe version
+ * Every operation is serialized on a single global lock. Once started, expired entries are reclaimed
+ * in background by small batches, each one under the lock
+ */
+class ThreadSafeSimpleLRU : public SimpleLRU {
+public:
+    ThreadSafeSimpleLRU(size_t max_size = 1024, size_t memory_quota = 0)
+        : SimpleLRU(max_size, memory_quota), _reaper([this] { return Reap(); }) {}
+    ~ThreadSafeSimpleLRU() { _reaper.Stop(); }
+
+    // see Storage.h
+    void Start() override { _reaper.Start(); }
+
+    // see Storage.h
+    void Stop() override { _reaper.Stop(); }
+
+    // see SimpleLRU.h
+    bool Put(const std::string &key, const std::string &value) override {
+        std::unique_lock<std::mutex> guard(_lock);
+        return SimpleLRU::Put(key, value);
+    }
+
+    // see SimpleLRU.h
+    bool Put(const std::string &key, const std::string &value, uint32_t ttl) override {
+        std::unique_lock<std::mutex> guard(_lock);
+        return SimpleLRU::Put(key, value, ttl);
+    }
+
+    // see SimpleLRU.h
+    bool PutIfAbsent(const std::string &key, const std::string &value) override {
+        std::unique_lock<std::mutex> guard(_lock);
+        return SimpleLRU::PutIfAbsent(key, value);
+    }
+
+    // see SimpleLRU.h
+    bool PutIfAbsent(const std::string &key, const std::string &value, uint32_t ttl) override {
+        std::unique_lock<std::mutex> guard(_lock);
+        return SimpleLRU::PutIfAbsent(key, value, ttl);
+    }
+
+    // see SimpleLRU.h
+    bool Set(const std::string &key, const std::string &value) override {
+        std::unique_lock<std::mutex> guard(_lock);
+        return SimpleLRU::Set(key, value);
+    }
+
+    // see SimpleLRU.h
+    bool Set(const std::string &key, const std::string &value, uint32_t ttl) override {
+        std::unique_lock<std::mutex> guard(_lock);
+        return SimpleLRU::Set(key, value, ttl);
+    }
+
+    // see SimpleLRU.h
+    bool Delete(const std::string &key) override {
+        std::unique_lock<std::mutex> guard(_lock);
+        return SimpleLRU::Delete(key);
+    }
+
+    // see SimpleLRU.h
+    bool Modify(const std::string &key, const Modifier &modify) override {
+        std::unique_lock<std::mutex> guard(_lock);
+        return SimpleLRU::Modify(key, modify);
+    }
+
+    // see SimpleLRU.h
+    bool Get(const std::string &key, std::string &value) const override {
+        std::unique_lock<std::mutex> guard(_lock);
+        return SimpleLRU::Get(key, value);
+    }
+
+    // see SimpleLRU.h
+    bool GetValue(const std::string &key, Value &value) const override {
+        std::unique_lock<std::mutex> guard(_lock);
+        return SimpleLRU::GetValue(key, value);
+    }
+
+    // Keys are hashed before lock is taken, whole batch is looked up under it at once
+    // see SimpleLRU.h
+    size_t MultiGet(const std::vector<std::string> &keys, std::vector<Value> &values) const override {
+        values.clear();
+        values.resize(keys.size());
+
+        std::vector<size_t> hashes(keys.size());
+        for (size_t i = 0; i < keys.size(); i++) {
+            hashes[i] = HashKey(keys[i].data(), keys[i].size());
+        }
+
+        std::unique_lock<std::mutex> guard(_lock);
+        return SimpleLRU::GetValues(keys.data(), hashes.data(), nullptr, keys.size(), values.data());
+    }
+
+    // see SimpleLRU.h
+    void CollectStats(std::vector<std::pair<std::string, std::string>> &stats) const override {
+        std::unique_lock<std::mutex> guard(_lock);
+        SimpleLRU::CollectStats(stats);
+    }
+
+private:
+    // Maximum number of entries reclaimed under the lock at once
+    static const size_t ReapBatch = 256;
+
+    bool Reap() {
+        std::unique_lock<std::mutex> guard(_lock);
+        return Expire(ReapBatch) == ReapBatch;
+    }
+
+    mutable std::mutex _lock;
+
+    Reaper _reaper;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_THREAD_SAFE_SIMPLE_LRU_H
@@ -0,0 +1,139 @@
+#include "TimerWheel.h"
+
+#include <chrono>
+
+namespace Afina {
+namespace Backend {
+
+namespace {
+
+void Link(TimerWheel::Timer *head, TimerWheel::Timer *timer) {
+    timer->wheel_prev = head->wheel_prev;
+    timer->wheel_next = head;
+    head->wheel_prev->wheel_next = timer;
+    head->wheel_prev = timer;
+}
+
+void Unlink(TimerWheel::Timer *timer) {
+    timer->wheel_prev->wheel_next = timer->wheel_next;
+    timer->wheel_next->wheel_prev = timer->wheel_prev;
+    timer->wheel_prev = nullptr;
+    timer->wheel_next = nullptr;
+}
+
+} // namespace
+
+// See TimerWheel.h
+TimerWheel::TimerWheel() : _now(Now()), _count(0) {
+    for (size_t level = 0; level < Levels; level++) {
+        for (size_t slot = 0; slot < Slots; slot++) {
+            _slots[level][slot].wheel_prev = &_slots[level][slot];
+            _slots[level][slot].wheel_next = &_slots[level][slot];
+        }
+    }
+}
+
+// See TimerWheel.h
+void TimerWheel::Schedule(Timer *timer, uint32_t deadline) {
+    timer->deadline = deadline;
+    Place(timer);
+    _count++;
+}
+
+// See TimerWheel.h
+void TimerWheel::Cancel(Timer *timer) {
+    Unlink(timer);
+    _count--;
+}
+
+// See TimerWheel.h
+TimerWheel::Timer *TimerWheel::Pop(uint32_t now) {
+    while (true) {
+        // Nothing to cascade, time could jump right away
+        if (_count == 0) {
+            if (now > _now) {
+                _now = now;
+            }
+            return nullptr;
+        }
+
+        Timer *head = &_slots[0][_now & (Slots - 1)];
+        if (head->wheel_next != head) {
+            if (_now > now) {
+                return nullptr;
+            }
+
+            Timer *timer = head->wheel_next;
+            Unlink(timer);
+            _count--;
+            return timer;
+        }
+
+        if (_now >= now) {
+            return nullptr;
+        }
+
+        _now++;
+        if ((_now & (Slots - 1)) == 0) {
+            Cascade(1);
+        }
+    }
+}
+
+// Timer goes to the lowest level which range covers its deadline. Slot is chosen by the deadline
+// bits, so timer is cascaded down not later than its deadline comes. Expired timers are put into
+// the current slot to be popped right away
+// See TimerWheel.h
+void TimerWheel::Place(Timer *timer) {
+    uint32_t at = timer->deadline > _now ? timer->deadline : _now;
+    uint32_t delta = at - _now;
+
+    size_t level = 0;
+    while (level + 1 < Levels && delta >= (uint32_t(1) << (SlotBits * (level + 1)))) {
+        level++;
+    }
+
+    // Deadline is too far, timer gets re-placed once reaches end of the wheel range
+    uint32_t range = uint32_t(1) << (SlotBits * Levels);
+    if (delta >= range) {
+        at = _now + range - 1;
+    }
+
+    size_t slot = (at >> (SlotBits * level)) & (Slots - 1);
+    Link(&_slots[level][slot], timer);
+}
+
+// See TimerWheel.h
+void TimerWheel::Cascade(size_t level) {
+    size_t slot = (_now >> (SlotBits * level)) & (Slots - 1);
+    if (slot == 0 && level + 1 < Levels) {
+        Cascade(level + 1);
+    }
+
+    // Slot is detached first, so timers re-placed into it again are not visited twice
+    Timer *head = &_slots[level][slot];
+    if (head->wheel_next == head) {
+        return;
+    }
+
+    Timer *timer = head->wheel_next;
+    head->wheel_prev->wheel_next = nullptr;
+    head->wheel_prev = head;
+    head->wheel_next = head;
+
+    while (timer != nullptr) {
+        Timer *next = timer->wheel_next;
+        Place(timer);
+        timer = next;
+    }
+}
+
+// See TimerWheel.h
+uint32_t TimerWheel::Now() {
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    auto passed = std::chrono::steady_clock::now() - start;
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(passed).count()) + 1;
+}
+
+} // namespace Backend
+} // namespace Afina
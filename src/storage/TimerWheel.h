@@ -0,0 +1,89 @@
+#ifndef AFINA_STORAGE_TIMER_WHEEL_H
+#define AFINA_STORAGE_TIMER_WHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Hierarchical timer wheel
+ * Keeps intrusive timers ordered by deadline with O(1) schedule and cancel. Wheel consists of several
+ * levels of slots, each level covers range of time 64 times wider than previous one. Timers from upper
+ * levels are cascaded down once wheel time reaches their slot, so expired timers are always found in the
+ * current slot of the lowest level and could be taken out one by one, without any scan.
+ *
+ * Time is measured in seconds. That is NOT thread safe implementation!!
+ */
+class TimerWheel {
+public:
+    /**
+     * Timer embedded into the object to be expired
+     */
+    struct Timer {
+        // Neighbours in the slot list, named so that objects could embed timer by inheritance
+        Timer *wheel_prev;
+        Timer *wheel_next;
+
+        // Time the timer expires at
+        uint32_t deadline;
+
+        Timer() : wheel_prev(nullptr), wheel_next(nullptr), deadline(0) {}
+
+        bool Scheduled() const { return wheel_next != nullptr; }
+    };
+
+    TimerWheel();
+    ~TimerWheel() {}
+
+    /**
+     * Adds timer that expires at the given time. Timer must not be scheduled already
+     */
+    void Schedule(Timer *timer, uint32_t deadline);
+
+    /**
+     * Removes scheduled timer from the wheel
+     */
+    void Cancel(Timer *timer);
+
+    /**
+     * Returns one of timers expired by the given time and removes it from the wheel, or nullptr if there
+     * is no such timers. Cost of the call is proportional to the time passed since the previous one
+     */
+    Timer *Pop(uint32_t now);
+
+    /**
+     * Number of scheduled timers
+     */
+    size_t Count() const { return _count; }
+
+    /**
+     * Coarse monotonic clock used as wheel time, never returns zero
+     */
+    static uint32_t Now();
+
+private:
+    TimerWheel(const TimerWheel &);            // = delete;
+    TimerWheel &operator=(const TimerWheel &); // = delete;
+
+    static const size_t Levels = 4;
+    static const size_t SlotBits = 6;
+    static const size_t Slots = 1 << SlotBits;
+
+    void Place(Timer *timer);
+    void Cascade(size_t level);
+
+    // Time up to which all timers are already processed
+    uint32_t _now;
+
+    size_t _count;
+
+    // Heads of circular timer lists
+    Timer _slots[Levels][Slots];
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_TIMER_WHEEL_H
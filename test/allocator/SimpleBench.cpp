@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include <afina/allocator/Error.h>
+#include <afina/allocator/Pointer.h>
+#include <afina/allocator/Simple.h>
+
+using namespace std;
+using namespace Afina::Allocator;
+
+// Not a test: measures Simple allocator throughput under different fragmentation patterns,
+// run it manually to compare implementations
+static char buf[4 * 1024 * 1024];
+
+// Number of blocks kept alive by each pattern
+static const size_t Live = 8192;
+
+static void Run(const char *name, function<void(Simple &, size_t &)> pattern) {
+    Simple a(buf, sizeof(buf));
+
+    size_t ops = 0;
+    bool failed = false;
+    auto start = chrono::steady_clock::now();
+    try {
+        pattern(a, ops);
+    } catch (AllocError &) {
+        failed = true;
+    }
+    auto passed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+
+    printf("%-8s %10zu ops %10.1f ns/op%s\n", name, ops, passed * 1000.0 / max<size_t>(ops, 1),
+           failed ? " (out of memory)" : "");
+}
+
+// Allocate and free blocks of the same size in LIFO order
+static void Lifo(Simple &a, size_t &ops) {
+    vector<Pointer> ptrs;
+    for (int round = 0; round < 16; round++) {
+        for (size_t i = 0; i < Live; i++) {
+            ptrs.push_back(a.alloc(128));
+            ops++;
+        }
+        while (!ptrs.empty()) {
+            a.free(ptrs.back());
+            ptrs.pop_back();
+            ops++;
+        }
+    }
+}
+
+// Free every other block and fill the holes with blocks of different size
+static void Holes(Simple &a, size_t &ops) {
+    vector<Pointer> ptrs;
+    for (size_t i = 0; i < Live; i++) {
+        ptrs.push_back(a.alloc(128));
+        ops++;
+    }
+
+    for (int round = 0; round < 16; round++) {
+        size_t size = round % 2 == 0 ? 64 : 128;
+        for (size_t i = round % 2; i < ptrs.size(); i += 2) {
+            a.free(ptrs[i]);
+            ptrs[i] = a.alloc(size);
+            ops += 2;
+        }
+    }
+
+    for (Pointer &p : ptrs) {
+        a.free(p);
+        ops++;
+    }
+}
+
+// Random sizes freed in random order, out of memory errors are counted as operations too
+static void Random(Simple &a, size_t &ops) {
+    mt19937 gen(42);
+    uniform_int_distribution<size_t> sizes(16, 512);
+
+    vector<Pointer> ptrs;
+    for (int i = 0; i < 200000; i++) {
+        if (ptrs.size() < Live && (ptrs.empty() || gen() % 3 != 0)) {
+            try {
+                ptrs.push_back(a.alloc(sizes(gen)));
+            } catch (AllocError &) {
+            }
+        } else {
+            size_t victim = gen() % ptrs.size();
+            swap(ptrs[victim], ptrs.back());
+            a.free(ptrs.back());
+            ptrs.pop_back();
+        }
+        ops++;
+    }
+
+    for (Pointer &p : ptrs) {
+        a.free(p);
+        ops++;
+    }
+}
+
+int main() {
+    Run("lifo", Lifo);
+    Run("holes", Holes);
+    Run("random", Random);
+    return 0;
+}
@@ -322,3 +322,49 @@ TEST(SimpleTest, ReallocGrow) {
     a.free(p);
     a.free(p2);
 }
+
+TEST(SimpleTest, DefragIncremental) {
+    Simple a(buf, sizeof(buf));
+
+    vector<Pointer> ptrs;
+    int size = 135;
+
+    ASSERT_TRUE(fillUp(a, size, ptrs));
+    for (size_t i = ptrs.size() - 1; i > 0; i -= 3) {
+        a.free(ptrs[i]);
+        ptrs.erase(ptrs.begin() + i);
+        if (i < 3) {
+            break;
+        }
+    }
+
+    // Each step moves at most one block of this size
+    int steps = 0;
+    while (a.defragStep(size)) {
+        steps++;
+
+        // Allocator stays usable between steps
+        if (steps % 10 == 0) {
+            a.free(ptrs[steps % ptrs.size()]);
+            ptrs[steps % ptrs.size()] = a.alloc(size);
+            writeTo(ptrs[steps % ptrs.size()], size);
+        }
+
+        ASSERT_LT(steps, 10000);
+    }
+    EXPECT_GT(steps, 1);
+
+    for (Pointer &p : ptrs) {
+        EXPECT_TRUE(isDataOk(p, size));
+    }
+
+    // Free space is collected into a single block
+    Pointer big = a.alloc(size * 10);
+    writeTo(big, size * 10);
+    a.free(big);
+
+    for (Pointer &p : ptrs) {
+        EXPECT_TRUE(isDataOk(p, size));
+        a.free(p);
+    }
+}
@@ -0,0 +1,192 @@
+#include "gtest/gtest.h"
+#include <cstring>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <afina/allocator/Concurrent.h>
+#include <afina/allocator/Slab.h>
+
+using namespace std;
+using namespace Afina::Allocator;
+
+TEST(SlabTest, PoolReturnsEmptySlab) {
+    SlabCache cache(16 * 1024);
+    Mempool pool(cache, 100);
+
+    vector<void *> objects;
+    for (int i = 0; i < 1000; i++) {
+        void *p = pool.Alloc();
+        ASSERT_NE(p, nullptr);
+        memset(p, i % 127, 100);
+        objects.push_back(p);
+    }
+
+    set<void *> unique(objects.begin(), objects.end());
+    EXPECT_EQ(unique.size(), objects.size());
+    EXPECT_EQ(pool.Used(), 1000);
+    EXPECT_GT(pool.Slabs(), 1);
+
+    for (size_t i = 0; i < objects.size(); i++) {
+        EXPECT_EQ(pool.SlabOf(objects[i])->pool, &pool);
+        EXPECT_EQ(*static_cast<char *>(objects[i]), char(i % 127));
+        pool.Free(objects[i]);
+    }
+
+    EXPECT_EQ(pool.Used(), 0);
+    EXPECT_EQ(pool.Slabs(), 0);
+    EXPECT_EQ(cache.Used(), 0);
+    EXPECT_GT(cache.Total(), 0);
+
+    cache.Trim();
+    EXPECT_EQ(cache.Total(), 0);
+}
+
+TEST(SlabTest, SparsestSlabObjects) {
+    SlabCache cache(16 * 1024);
+    Mempool pool(cache, 256);
+
+    vector<void *> objects;
+    while (pool.Slabs() < 3 || pool.Available() > 0) {
+        objects.push_back(pool.Alloc());
+    }
+
+    // Leave two objects in the first slab, it becomes the sparsest one
+    Mempool::Slab *first = pool.SlabOf(objects[0]);
+    vector<void *> kept;
+    for (void *p : objects) {
+        if (pool.SlabOf(p) == first && kept.size() < 2) {
+            kept.push_back(p);
+        } else if (pool.SlabOf(p) == first) {
+            pool.Free(p);
+        }
+    }
+
+    EXPECT_EQ(pool.Sparsest(), first);
+
+    vector<void *> live;
+    pool.Objects(first, live);
+    EXPECT_EQ(set<void *>(live.begin(), live.end()), set<void *>(kept.begin(), kept.end()));
+}
+
+TEST(SlabTest, SizeClasses) {
+    SlabCache cache(64 * 1024);
+    SlabAllocator allocator(cache, 64, 1.25);
+
+    EXPECT_EQ(allocator.RealSize(1), 64);
+    EXPECT_EQ(allocator.RealSize(64), 64);
+    EXPECT_EQ(allocator.RealSize(65), 80);
+
+    size_t previous = 0;
+    for (size_t i = 0; i < allocator.Classes(); i++) {
+        size_t size = allocator.Pool(i).ObjectSize();
+        EXPECT_GT(size, previous);
+        EXPECT_EQ(size % 8, 0);
+        EXPECT_EQ(allocator.ClassOf(size), i);
+        previous = size;
+    }
+    EXPECT_EQ(allocator.ClassOf(previous + 1), allocator.Classes());
+
+    void *small = allocator.Alloc(100);
+    void *large = allocator.Alloc(previous + 1);
+    ASSERT_NE(small, nullptr);
+    ASSERT_NE(large, nullptr);
+    EXPECT_EQ(allocator.LargeCount(), 1);
+
+    vector<SlabAllocator::ClassStats> stats;
+    allocator.CollectStats(stats);
+    EXPECT_EQ(stats.size(), allocator.Classes());
+    EXPECT_EQ(stats[allocator.ClassOf(100)].used, 1);
+
+    allocator.Free(small, 100);
+    allocator.Free(large, previous + 1);
+    EXPECT_EQ(allocator.LargeCount(), 0);
+    EXPECT_EQ(cache.Used(), 0);
+}
+
+TEST(SlabTest, Quota) {
+    SlabCache cache(16 * 1024, 4 * 16 * 1024);
+    SlabAllocator allocator(cache);
+
+    size_t count = 0;
+    while (allocator.Alloc(1000) != nullptr) {
+        count++;
+    }
+
+    EXPECT_GT(count, 0);
+    EXPECT_LE(cache.Total(), cache.Quota());
+    EXPECT_EQ(allocator.Alloc(100 * 1024), nullptr);
+}
+
+TEST(SlabTest, ConcurrentCrossThreadFree) {
+    Concurrent allocator(16 * 1024, 0, 8);
+
+    // Blocks allocated by one thread are freed by another one
+    vector<void *> blocks;
+    std::thread producer([&] {
+        for (int i = 0; i < 1000; i++) {
+            void *p = allocator.Alloc(100);
+            ASSERT_NE(p, nullptr);
+            memset(p, i % 127, 100);
+            blocks.push_back(p);
+        }
+    });
+    producer.join();
+
+    set<void *> unique(blocks.begin(), blocks.end());
+    EXPECT_EQ(unique.size(), blocks.size());
+
+    std::thread consumer([&] {
+        for (size_t i = 0; i < blocks.size(); i++) {
+            EXPECT_EQ(*static_cast<char *>(blocks[i]), char(i % 127));
+            allocator.Free(blocks[i], 100);
+        }
+    });
+    consumer.join();
+
+    // Both threads exited, so their magazines are flushed
+    vector<SlabAllocator::ClassStats> stats;
+    allocator.CollectStats(stats);
+    for (auto &s : stats) {
+        EXPECT_EQ(s.used, 0);
+    }
+}
+
+TEST(SlabTest, ConcurrentStress) {
+    Concurrent allocator(64 * 1024);
+
+    vector<std::thread> workers;
+    for (int t = 0; t < 4; t++) {
+        workers.emplace_back([&allocator, t] {
+            vector<pair<char *, size_t>> live;
+            for (int i = 0; i < 20000; i++) {
+                size_t size = 16 + (i * 7919 + t) % 2000;
+                if (live.size() < 100 || i % 2 == 0) {
+                    char *p = static_cast<char *>(allocator.Alloc(size));
+                    ASSERT_NE(p, nullptr);
+                    memset(p, t, size);
+                    live.emplace_back(p, size);
+                } else {
+                    auto block = live[i % live.size()];
+                    live[i % live.size()] = live.back();
+                    live.pop_back();
+                    ASSERT_EQ(block.first[0], char(t));
+                    ASSERT_EQ(block.first[block.second - 1], char(t));
+                    allocator.Free(block.first, block.second);
+                }
+            }
+            for (auto &block : live) {
+                allocator.Free(block.first, block.second);
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    vector<SlabAllocator::ClassStats> stats;
+    allocator.CollectStats(stats);
+    for (auto &s : stats) {
+        EXPECT_EQ(s.used, 0);
+    }
+}
@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include <afina/Executor.h>
+#include <afina/executor/Task.h>
+
+using namespace std;
+using namespace Afina;
+
+// Not a test: measures cost of task submission and latency between submit and start, run it manually
+// to compare executor modes and task types
+
+// Every heap allocation made by the process is counted, so allocations on the submit path are visible
+static atomic<size_t> allocations(0);
+
+void *operator new(size_t size) {
+    allocations++;
+    void *p = malloc(size);
+    if (p == nullptr) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+static const size_t Count = 200000;
+
+// Payload resembling the uv server tasks: a couple of pointers and an index
+struct Payload {
+    atomic<size_t> *counter;
+    void *context;
+    size_t index;
+};
+
+// Create, move and run tasks of the given type without any executor
+template <typename T> static void Wrap(const char *name) {
+    atomic<size_t> counter(0);
+    Payload payload{&counter, nullptr, 0};
+
+    size_t before = allocations.load();
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < Count; i++) {
+        payload.index = i;
+        T task([payload]() { (*payload.counter)++; });
+        T moved(std::move(task));
+        moved();
+    }
+    auto passed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+
+    printf("%-24s %8.1f ns/op %6.2f allocs/op\n", name, double(passed) / Count,
+           double(allocations.load() - before) / Count);
+}
+
+// Submit tasks from outside of the pool, each records how long it waited for a thread
+static void Submit(const char *name, Executor::Mode mode) {
+    Executor executor("bench", 2, mode);
+    atomic<size_t> done(0);
+    vector<int64_t> waits(Count);
+
+    // Warm up so that queues reach their working size
+    for (size_t i = 0; i < 1000; i++) {
+        executor.Execute([&done]() { done++; });
+    }
+    while (done.load() < 1000) {
+        this_thread::yield();
+    }
+    done.store(0);
+
+    size_t before = allocations.load();
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < Count; i++) {
+        auto submitted = chrono::steady_clock::now();
+        int64_t *wait = &waits[i];
+        while (!executor.Execute([&done, submitted, wait]() {
+            *wait = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - submitted).count();
+            done++;
+        })) {
+            this_thread::yield();
+        }
+
+        // Keep the queue short so latency isn't dominated by the backlog
+        while (done.load() + 64 < i) {
+            this_thread::yield();
+        }
+    }
+    size_t submit_allocations = allocations.load() - before;
+    while (done.load() < Count) {
+        this_thread::yield();
+    }
+    auto passed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    executor.Stop(true);
+
+    sort(waits.begin(), waits.end());
+    printf("%-24s %8.1f ns/op %6.2f allocs/op  wait p50 %8lld ns  p99 %8lld ns\n", name, double(passed) / Count,
+           double(submit_allocations) / Count, (long long)waits[Count / 2], (long long)waits[Count * 99 / 100]);
+}
+
+int main() {
+    Wrap<function<void()>>("std::function");
+    Wrap<Task>("Task");
+    Submit("submit shared", Executor::Mode::kSharedQueue);
+    Submit("submit stealing", Executor::Mode::kWorkStealing);
+    return 0;
+}
@@ -0,0 +1,419 @@
+#include "gtest/gtest.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <afina/Executor.h>
+#include <afina/executor/Histogram.h>
+#include <afina/executor/Task.h>
+#include <executor/Deque.h>
+
+using namespace Afina;
+using namespace std;
+
+TEST(TaskTest, InlineAndHeap) {
+    int calls = 0;
+    Task small([&calls]() { calls++; });
+    small();
+
+    // Capture larger than the inline buffer goes to the heap, moving it just moves the pointer
+    char big[Task::InlineSize * 2] = {1};
+    Task large([&calls, big]() { calls += big[0]; });
+    Task moved(std::move(large));
+    EXPECT_FALSE(large);
+    ASSERT_TRUE(moved);
+    moved();
+    EXPECT_EQ(2, calls);
+}
+
+TEST(TaskTest, MoveOnlyCapture) {
+    std::shared_ptr<int> alive = std::make_shared<int>(0);
+    std::unique_ptr<std::shared_ptr<int>> owned(new std::shared_ptr<int>(alive));
+    auto func = [](std::unique_ptr<std::shared_ptr<int>> &p) { (**p)++; };
+    Task task(std::bind(func, std::move(owned)));
+
+    Task other;
+    other = std::move(task);
+    other();
+    EXPECT_EQ(1, *alive);
+    EXPECT_EQ(2, alive.use_count());
+
+    // Captured state is destroyed with the task
+    other.Reset();
+    EXPECT_EQ(1, alive.use_count());
+}
+
+TEST(TaskQueueTest, FifoAcrossGrowth) {
+    TaskQueue queue(4);
+    std::vector<int> order;
+    int next = 0;
+
+    // Interleave pushes and pops so that head wraps around before buffer grows
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < round + 3; i++) {
+            int value = next++;
+            queue.Push(Task([&order, value]() { order.push_back(value); }));
+        }
+        for (int i = 0; i < 2; i++) {
+            queue.Pop()();
+        }
+    }
+    while (!queue.Empty()) {
+        queue.Pop()();
+    }
+
+    ASSERT_EQ(next, order.size());
+    for (int i = 0; i < next; i++) {
+        EXPECT_EQ(i, order[i]);
+    }
+}
+
+TEST(HistogramTest, BucketBounds) {
+    // Every value fits into its bucket and buckets follow each other without gaps
+    uint64_t values[] = {0, 1, 15, 16, 17, 31, 32, 1000, 123456789, uint64_t(-1)};
+    for (uint64_t value : values) {
+        size_t bucket = Histogram::BucketOf(value);
+        ASSERT_LT(bucket, Histogram::Buckets);
+        EXPECT_LE(value, Histogram::UpperBound(bucket)) << value;
+        if (bucket > 0) {
+            EXPECT_GT(value, Histogram::UpperBound(bucket - 1)) << value;
+        }
+    }
+    EXPECT_EQ(Histogram::Buckets - 1, Histogram::BucketOf(uint64_t(-1)));
+}
+
+TEST(HistogramTest, Percentiles) {
+    Histogram histogram;
+    EXPECT_EQ(0, histogram.Percentile(50));
+
+    for (uint64_t i = 1; i <= 10000; i++) {
+        histogram.Record(i * 1000);
+    }
+    EXPECT_EQ(10000, histogram.Count());
+    EXPECT_EQ(10000000, histogram.Max());
+
+    // Reported value is the upper bound of the bucket, so it is off by at most 1/SubBuckets
+    uint64_t p50 = histogram.Percentile(50);
+    uint64_t p99 = histogram.Percentile(99);
+    EXPECT_GE(p50, 5000000);
+    EXPECT_LE(p50, 5000000 + 5000000 / Histogram::SubBuckets);
+    EXPECT_GE(p99, 9900000);
+    EXPECT_LE(p99, 10000000);
+    EXPECT_EQ(10000000, histogram.Percentile(100));
+}
+
+TEST(HistogramTest, ConcurrentRecord) {
+    Histogram histogram;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&histogram, t]() {
+            for (uint64_t i = 0; i < 10000; i++) {
+                histogram.Record(i + t);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    EXPECT_EQ(40000, histogram.Count());
+    EXPECT_EQ(10002, histogram.Max());
+    EXPECT_EQ(histogram.Max(), histogram.Percentile(100));
+}
+
+TEST(DequeTest, OwnerIsLifoThiefIsFifo) {
+    WorkStealingDeque<size_t> deque(2);
+    for (size_t i = 0; i < 100; i++) {
+        deque.Push(i);
+    }
+    EXPECT_EQ(100, deque.Size());
+
+    size_t item;
+    ASSERT_TRUE(deque.Steal(item));
+    EXPECT_EQ(0, item);
+    ASSERT_TRUE(deque.Pop(item));
+    EXPECT_EQ(99, item);
+    EXPECT_EQ(98, deque.Size());
+}
+
+TEST(DequeTest, ConcurrentSteal) {
+    const size_t count = 100000;
+    WorkStealingDeque<size_t> deque;
+    std::atomic<bool> done(false);
+    std::vector<std::atomic<int>> seen(count);
+    for (auto &s : seen) {
+        s.store(0);
+    }
+
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < 3; t++) {
+        thieves.emplace_back([&deque, &done, &seen]() {
+            size_t item;
+            while (!done.load()) {
+                if (deque.Steal(item)) {
+                    seen[item]++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // Owner pushes and pops concurrently with thieves, every item must be taken exactly once
+    size_t item;
+    for (size_t i = 0; i < count; i++) {
+        deque.Push(i);
+        if (i % 3 == 0 && deque.Pop(item)) {
+            seen[item]++;
+        }
+    }
+    while (deque.Pop(item)) {
+        seen[item]++;
+    }
+    while (deque.Size() > 0) {
+        std::this_thread::yield();
+    }
+    done.store(true);
+    for (auto &t : thieves) {
+        t.join();
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        ASSERT_EQ(1, seen[i].load()) << i;
+    }
+}
+
+class ExecutorTest : public ::testing::TestWithParam<Executor::Mode> {};
+
+TEST_P(ExecutorTest, AllTasksComplete) {
+    Executor executor("test", 4, GetParam());
+    std::atomic<size_t> counter(0);
+    for (int i = 0; i < 10000; i++) {
+        ASSERT_TRUE(executor.Execute([&counter]() { counter++; }));
+    }
+
+    executor.Stop(true);
+    EXPECT_EQ(10000, counter.load());
+    EXPECT_FALSE(executor.Execute([&counter]() { counter++; }));
+}
+
+TEST_P(ExecutorTest, NestedSubmit) {
+    Executor executor("test", 4, GetParam());
+    std::atomic<size_t> counter(0);
+    std::atomic<size_t> spawned(0);
+
+    // Every task spawns more tasks from the pool thread
+    for (int i = 0; i < 10; i++) {
+        executor.Execute([&executor, &counter, &spawned]() {
+            for (int j = 0; j < 100; j++) {
+                if (executor.Execute([&counter]() { counter++; })) {
+                    spawned++;
+                }
+            }
+        });
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while ((spawned.load() < 1000 || counter.load() < spawned.load()) && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    executor.Stop(true);
+    EXPECT_EQ(1000, spawned.load());
+    EXPECT_EQ(1000, counter.load());
+}
+
+TEST_P(ExecutorTest, ParkedThreadsWakeUp) {
+    Executor executor("test", 2, GetParam());
+
+    // Let threads park, then submit work again
+    for (int round = 0; round < 3; round++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        std::atomic<int> counter(0);
+        for (int i = 0; i < 10; i++) {
+            executor.Execute([&counter]() { counter++; });
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (counter.load() < 10 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ASSERT_EQ(10, counter.load());
+    }
+    executor.Stop(true);
+}
+
+TEST_P(ExecutorTest, GrowsAndShrinks) {
+    Executor executor("test", 1, 4, 0, std::chrono::milliseconds(50), GetParam());
+    EXPECT_EQ(1, executor.Threads());
+
+    // Blocked tasks keep threads busy, so every new one needs a thread of its own
+    std::mutex lock;
+    std::condition_variable cv;
+    bool release = false;
+    std::atomic<int> started(0);
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(executor.Execute([&]() {
+            started++;
+            std::unique_lock<std::mutex> guard(lock);
+            cv.wait(guard, [&release]() { return release; });
+        }));
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (started.load() < 4 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(4, started.load());
+    EXPECT_EQ(4, executor.Threads());
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        release = true;
+    }
+    cv.notify_all();
+
+    // Threads above low watermark retire after idle timeout
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (executor.Threads() > 1 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(1, executor.Threads());
+    executor.Stop(true);
+    EXPECT_EQ(0, executor.Threads());
+}
+
+TEST_P(ExecutorTest, RejectsWhenQueueIsFull) {
+    Executor executor("test", 1, 1, 2, std::chrono::milliseconds(50), GetParam());
+
+    std::mutex lock;
+    std::condition_variable cv;
+    bool release = false;
+    std::atomic<int> started(0);
+    std::atomic<int> counter(0);
+    ASSERT_TRUE(executor.Execute([&]() {
+        started++;
+        std::unique_lock<std::mutex> guard(lock);
+        cv.wait(guard, [&release]() { return release; });
+    }));
+    while (started.load() < 1) {
+        std::this_thread::yield();
+    }
+
+    // The only thread is blocked, so tasks stay in the queue
+    EXPECT_TRUE(executor.Execute([&counter]() { counter++; }));
+    EXPECT_TRUE(executor.Execute([&counter]() { counter++; }));
+    EXPECT_FALSE(executor.Execute([&counter]() { counter++; }));
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        release = true;
+    }
+    cv.notify_all();
+    executor.Stop(true);
+    EXPECT_EQ(2, counter.load());
+}
+
+TEST_P(ExecutorTest, StopWithoutAwait) {
+    std::mutex lock;
+    std::condition_variable cv;
+    bool release = false;
+    std::atomic<int> started(0);
+
+    Executor executor("test", 1, GetParam());
+    ASSERT_TRUE(executor.Execute([&]() {
+        started++;
+        std::unique_lock<std::mutex> guard(lock);
+        cv.wait(guard, [&release]() { return release; });
+    }));
+    while (started.load() < 1) {
+        std::this_thread::yield();
+    }
+
+    // Stop returns while the task is still running, destructor waits for it
+    executor.Stop();
+    EXPECT_FALSE(executor.Execute([]() {}));
+    EXPECT_EQ(1, executor.Threads());
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        release = true;
+    }
+    cv.notify_all();
+}
+
+TEST_P(ExecutorTest, Metrics) {
+    Executor executor("test", 1, 1, 1, std::chrono::milliseconds(50), GetParam());
+
+    std::atomic<int> done(0);
+    for (int i = 0; i < 5; i++) {
+        while (!executor.Execute([&done]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            done++;
+        })) {
+            std::this_thread::yield();
+        }
+    }
+    executor.Stop(true);
+
+    Executor::Metrics metrics;
+    executor.GetMetrics(metrics);
+    EXPECT_EQ(5, done.load());
+    EXPECT_EQ(5, metrics.completed);
+    EXPECT_GT(metrics.rejected, 0);
+    EXPECT_EQ(0, metrics.queue_depth);
+    EXPECT_EQ(0, metrics.busy_threads);
+    EXPECT_GE(metrics.busy_time, 10000000);
+    EXPECT_GE(metrics.thread_time, metrics.busy_time);
+
+    // The single thread was busy, so tasks had to wait in the queue for the previous ones
+    EXPECT_EQ(5, executor.RunTime().Count());
+    EXPECT_GE(executor.RunTime().Percentile(50), 2000000);
+    EXPECT_GE(executor.WaitTime().Max(), 1000000);
+
+    std::vector<std::pair<std::string, std::string>> stats;
+    executor.CollectStats(stats);
+    bool found = false;
+    for (auto &stat : stats) {
+        if (stat.first == "executor_completed") {
+            EXPECT_EQ("5", stat.second);
+            found = true;
+        }
+    }
+    EXPECT_TRUE(found);
+}
+
+TEST(ExecutorWorkStealingTest, TasksAreStolen) {
+    Executor executor("test", 4, Executor::Mode::kWorkStealing);
+    std::mutex lock;
+    std::set<std::thread::id> threads;
+    std::atomic<int> counter(0);
+
+    // All subtasks land in the deque of a single thread, the others could get them only by stealing
+    executor.Execute([&]() {
+        for (int i = 0; i < 200; i++) {
+            executor.Execute([&]() {
+                std::this_thread::sleep_for(std::chrono::microseconds(500));
+                std::lock_guard<std::mutex> guard(lock);
+                threads.insert(std::this_thread::get_id());
+                counter++;
+            });
+        }
+    });
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (counter.load() < 200 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    executor.Stop(true);
+
+    EXPECT_EQ(200, counter.load());
+    EXPECT_GT(threads.size(), 1);
+}
+
+INSTANTIATE_TEST_CASE_P(Modes, ExecutorTest,
+                        ::testing::Values(Executor::Mode::kSharedQueue, Executor::Mode::kWorkStealing));
@@ -0,0 +1,273 @@
+#include "gtest/gtest.h"
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <network/nonblocking/Connection.h>
+#include <network/nonblocking/SPSCQueue.h>
+#include <network/nonblocking/ServerImpl.h>
+#include <network/nonblocking/Worker.h>
+#include <storage/MapBasedGlobalLockImpl.h>
+
+using namespace Afina::Network::NonBlocking;
+using namespace std;
+
+// Reads everything available from the non blocking socket
+static std::string ReadAll(int fd) {
+    std::string result;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        result.append(buf, n);
+    }
+    return result;
+}
+
+class ConnectionTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds));
+        storage = std::make_shared<Afina::Backend::MapBasedGlobalLockImpl>();
+    }
+
+    void TearDown() override { close(fds[1]); }
+
+    void Send(const std::string &data) { ASSERT_EQ(ssize_t(data.size()), write(fds[1], data.data(), data.size())); }
+
+    int fds[2];
+    std::shared_ptr<Afina::Storage> storage;
+};
+
+TEST_F(ConnectionTest, Pipelined) {
+    Connection conn(fds[0], storage);
+    Send("set foo 0 0 3\r\nbar\r\nget foo\r\n");
+
+    EXPECT_TRUE(conn.Resume());
+    EXPECT_EQ("STORED\r\nVALUE foo 0 3\r\nbar\r\nEND\r\n", ReadAll(fds[1]));
+    EXPECT_FALSE(conn.Done());
+}
+
+TEST_F(ConnectionTest, SplitAtAnyByte) {
+    Connection conn(fds[0], storage);
+    std::string request = "set foo 0 0 5\r\nhello\r\nget foo\r\n";
+    for (char c : request) {
+        Send(std::string(1, c));
+        EXPECT_TRUE(conn.Resume());
+    }
+    EXPECT_EQ("STORED\r\nVALUE foo 0 5\r\nhello\r\nEND\r\n", ReadAll(fds[1]));
+}
+
+TEST_F(ConnectionTest, ProtocolError) {
+    Connection conn(fds[0], storage);
+    Send("set foo 0 0 3\r\nbarXYget foo\r\n");
+
+    EXPECT_TRUE(conn.Resume());
+    EXPECT_TRUE(conn.Done());
+
+    // Command with broken trailer is not executed, nothing after it is parsed
+    std::string out = ReadAll(fds[1]);
+    EXPECT_EQ(0, out.find("CLIENT_ERROR")) << out;
+    EXPECT_EQ(std::string::npos, out.find("STORED"));
+}
+
+TEST_F(ConnectionTest, FlushOnPeerClose) {
+    Connection conn(fds[0], storage);
+    Send("set foo 0 0 3\r\nbar\r\n");
+    shutdown(fds[1], SHUT_WR);
+
+    EXPECT_TRUE(conn.Resume());
+    EXPECT_TRUE(conn.Done());
+    EXPECT_EQ("STORED\r\n", ReadAll(fds[1]));
+}
+
+TEST_F(ConnectionTest, Backpressure) {
+    Connection conn(fds[0], storage);
+    std::string value(32 * 1024, 'x');
+    Send("set foo 0 0 " + std::to_string(value.size()) + "\r\n" + value + "\r\n");
+    EXPECT_TRUE(conn.Resume());
+    EXPECT_EQ("STORED\r\n", ReadAll(fds[1]));
+
+    // Peer doesn't read, so connection must stop at the watermark instead of buffering everything
+    std::string gets;
+    for (int i = 0; i < 1024; i++) {
+        gets += "get foo\r\n";
+    }
+    Send(gets);
+    EXPECT_TRUE(conn.Resume());
+    EXPECT_LE(conn.Pending(), Connection::OutputHighWatermark + value.size() + 64);
+
+    size_t received = 0;
+    while (received < 1024 * (value.size() + 26)) {
+        std::string out = ReadAll(fds[1]);
+        received += out.size();
+        EXPECT_TRUE(conn.Resume());
+        if (out.empty() && conn.Pending() == 0) {
+            break;
+        }
+    }
+    EXPECT_EQ(1024 * (value.size() + 26), received);
+    EXPECT_EQ(0, conn.Pending());
+}
+
+TEST(SPSCQueueTest, Ordered) {
+    SPSCQueue<size_t> queue(100);
+    EXPECT_EQ(128, queue.Capacity());
+
+    const size_t count = 100000;
+    std::thread producer([&queue, count]() {
+        for (size_t i = 0; i < count; i++) {
+            while (!queue.Push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    size_t expected = 0;
+    while (expected < count) {
+        size_t value;
+        if (queue.Pop(value)) {
+            ASSERT_EQ(expected, value);
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+
+    size_t value;
+    EXPECT_FALSE(queue.Pop(value));
+}
+
+TEST(WorkerTest, SpreadsConnections) {
+    int server_socket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    ASSERT_NE(-1, server_socket);
+
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    ASSERT_EQ(0, bind(server_socket, (struct sockaddr *)&addr, sizeof(addr)));
+    ASSERT_EQ(0, listen(server_socket, 128));
+    ASSERT_EQ(0, getsockname(server_socket, (struct sockaddr *)&addr, &addr_len));
+
+    std::shared_ptr<Afina::Storage> storage = std::make_shared<Afina::Backend::MapBasedGlobalLockImpl>();
+    std::vector<Worker> workers;
+    workers.reserve(2);
+    workers.emplace_back(storage, 0, &workers);
+    workers.emplace_back(storage, 1, &workers);
+
+    // Nobody connects to the second listener, so every connection the second worker gets is handed over
+    int idle_socket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    struct sockaddr_in idle_addr = addr;
+    idle_addr.sin_port = 0;
+    ASSERT_EQ(0, bind(idle_socket, (struct sockaddr *)&idle_addr, sizeof(idle_addr)));
+    ASSERT_EQ(0, listen(idle_socket, 128));
+
+    workers[0].Start(server_socket);
+    workers[1].Start(idle_socket);
+
+    std::vector<int> clients;
+    for (int i = 0; i < 8; i++) {
+        int client = socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_EQ(0, connect(client, (struct sockaddr *)&addr, sizeof(addr)));
+        clients.push_back(client);
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (workers[0].GetLoad().connections + workers[1].GetLoad().connections < clients.size() &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(4, workers[0].GetLoad().connections);
+    EXPECT_EQ(4, workers[1].GetLoad().connections);
+
+    // Handed over connections are served as usual
+    for (size_t i = 0; i < clients.size(); i++) {
+        std::string key = "key" + std::to_string(i);
+        std::string request = "set " + key + " 0 0 1\r\nx\r\nget " + key + "\r\n";
+        ASSERT_EQ(ssize_t(request.size()), write(clients[i], request.data(), request.size()));
+
+        std::string expected = "STORED\r\nVALUE " + key + " 0 1\r\nx\r\nEND\r\n";
+        std::string response;
+        char buf[256];
+        while (response.size() < expected.size()) {
+            ssize_t n = read(clients[i], buf, sizeof(buf));
+            ASSERT_GT(n, 0);
+            response.append(buf, n);
+        }
+        EXPECT_EQ(expected, response);
+        close(clients[i]);
+    }
+
+    workers[0].Stop();
+    workers[1].Stop();
+    workers[0].Join();
+    workers[1].Join();
+    close(server_socket);
+    close(idle_socket);
+}
+
+// Every worker gets its own SO_REUSEPORT listener on the same port and serves connections from it
+TEST(ServerTest, ReusePort) {
+    // Free port is found by binding to the ephemeral one
+    int probe = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    ASSERT_EQ(0, bind(probe, (struct sockaddr *)&addr, sizeof(addr)));
+    ASSERT_EQ(0, getsockname(probe, (struct sockaddr *)&addr, &addr_len));
+    close(probe);
+
+    std::shared_ptr<Afina::Storage> storage = std::make_shared<Afina::Backend::MapBasedGlobalLockImpl>();
+    ServerImpl server(storage, true, 16);
+    server.Start(ntohs(addr.sin_port), 2);
+
+    std::vector<int> clients;
+    for (int i = 0; i < 16; i++) {
+        int client = socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_EQ(0, connect(client, (struct sockaddr *)&addr, sizeof(addr)));
+        clients.push_back(client);
+    }
+
+    std::vector<uint32_t> connections;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    do {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        connections = server.Connections();
+    } while (connections[0] + connections[1] < clients.size() && std::chrono::steady_clock::now() < deadline);
+    ASSERT_EQ(clients.size(), connections[0] + connections[1]);
+    EXPECT_GT(connections[0], 0);
+    EXPECT_GT(connections[1], 0);
+
+    for (size_t i = 0; i < clients.size(); i++) {
+        std::string key = "key" + std::to_string(i);
+        std::string request = "set " + key + " 0 0 1\r\nx\r\nget " + key + "\r\n";
+        ASSERT_EQ(ssize_t(request.size()), write(clients[i], request.data(), request.size()));
+
+        std::string expected = "STORED\r\nVALUE " + key + " 0 1\r\nx\r\nEND\r\n";
+        std::string response;
+        char buf[256];
+        while (response.size() < expected.size()) {
+            ssize_t n = read(clients[i], buf, sizeof(buf));
+            ASSERT_GT(n, 0);
+            response.append(buf, n);
+        }
+        EXPECT_EQ(expected, response);
+        close(clients[i]);
+    }
+
+    server.Stop();
+    server.Join();
+}
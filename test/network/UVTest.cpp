@@ -0,0 +1,92 @@
+#include "gtest/gtest.h"
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <afina/Executor.h>
+#include <network/uv/Worker.h>
+#include <storage/MapBasedGlobalLockImpl.h>
+
+using namespace Afina::Network::UV;
+
+// Reads from the blocking socket until given number of bytes received or peer closes connection
+static std::string ReadExactly(int fd, size_t size) {
+    std::string result;
+    char buf[4096];
+    while (result.size() < size) {
+        ssize_t n = read(fd, buf, std::min(sizeof(buf), size - result.size()));
+        if (n <= 0) {
+            break;
+        }
+        result.append(buf, n);
+    }
+    return result;
+}
+
+// Pipelined commands come back in order whatever batches they were executed in, commands with noreply
+// take their place in the batch but add nothing to the output. Connections and tasks of closed clients
+// are taken by the next ones instead of allocating new
+TEST(UVWorkerTest, PipelineAndReuse) {
+    // Free port is found by binding to the ephemeral one
+    int probe = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    ASSERT_EQ(0, bind(probe, (struct sockaddr *)&addr, sizeof(addr)));
+    ASSERT_EQ(0, getsockname(probe, (struct sockaddr *)&addr, &addr_len));
+    close(probe);
+
+    struct sockaddr_storage address;
+    std::memset(&address, 0, sizeof(address));
+    std::memcpy(&address, &addr, sizeof(addr));
+
+    std::shared_ptr<Afina::Storage> storage = std::make_shared<Afina::Backend::MapBasedGlobalLockImpl>();
+    Afina::Executor executor("uv-test", 2);
+    Worker worker(storage, &executor);
+    worker.Start(address);
+
+    const int Clients = 20;
+    for (int i = 0; i < Clients; i++) {
+        int client = socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_EQ(0, connect(client, (struct sockaddr *)&addr, sizeof(addr)));
+
+        std::string n = std::to_string(i);
+        std::string request = "set a" + n + " 0 0 1 noreply\r\n1\r\n"
+                              "set b" + n + " 0 0 2\r\n22\r\n"
+                              "append a" + n + " 0 0 1 noreply\r\n3\r\n"
+                              "get a" + n + " b" + n + "\r\n"
+                              "incr c" + n + " 1 noreply\r\n"
+                              "delete a" + n + " noreply\r\n"
+                              "get a" + n + "\r\n"
+                              "delete b" + n + "\r\n";
+        // Split so that commands arrive in several reads and are executed in several batches
+        size_t half = request.size() / 2;
+        ASSERT_EQ(ssize_t(half), write(client, request.data(), half));
+        ASSERT_EQ(ssize_t(request.size() - half), write(client, request.data() + half, request.size() - half));
+
+        std::string expected = "STORED\r\n"
+                               "VALUE a" + n + " 0 2\r\n13\r\nVALUE b" + n + " 0 2\r\n22\r\nEND\r\n"
+                               "END\r\n"
+                               "DELETED\r\n";
+        EXPECT_EQ(expected, ReadExactly(client, expected.size()));
+        close(client);
+    }
+
+    worker.Stop();
+    worker.Join();
+    executor.Stop(true);
+
+    // Next client could be accepted before previous one is seen closed, so at most two connections are
+    // ever allocated, and tasks of no more than two pipelines
+    EXPECT_GE(worker.PooledConnections(), 1);
+    EXPECT_LE(worker.PooledConnections(), 2);
+    EXPECT_GE(worker.PooledTasks(), 1);
+    EXPECT_LE(worker.PooledTasks(), 2 * 8);
+}
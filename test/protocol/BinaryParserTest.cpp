@@ -0,0 +1,225 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <afina/execute/Command.h>
+#include <afina/execute/Response.h>
+
+#include <protocol/BinaryParser.h>
+#include <protocol/Framing.h>
+#include <storage/SimpleLRU.h>
+
+using namespace Afina;
+typedef Protocol::BinaryParser::Opcode Opcode;
+typedef Protocol::BinaryParser::Status Status;
+
+static std::string Number(uint64_t value, size_t bytes) {
+    std::string out;
+    for (size_t i = bytes; i > 0; i--) {
+        out.push_back(char((value >> (8 * (i - 1))) & 0xff));
+    }
+    return out;
+}
+
+static uint64_t Number(const std::string &data, size_t offset, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        value = (value << 8) | (unsigned char)data[offset + i];
+    }
+    return value;
+}
+
+static std::string Request(Opcode opcode, const std::string &extras, const std::string &key,
+                           const std::string &value = "", uint64_t cas = 0) {
+    std::string out;
+    out.push_back(char(Protocol::BinaryParser::RequestMagic));
+    out.push_back(char(opcode));
+    out += Number(key.size(), 2);
+    out.push_back(char(extras.size()));
+    out.push_back(0);
+    out += Number(0, 2);
+    out += Number(extras.size() + key.size() + value.size(), 4);
+    out += Number(0xdeadbeef, 4);
+    out += Number(cas, 8);
+    return out + extras + key + value;
+}
+
+// Decoded response
+struct Reply {
+    Opcode opcode;
+    Status status;
+    uint64_t cas;
+    std::string extras, key, value;
+};
+
+static std::vector<Reply> Decode(const std::string &data) {
+    std::vector<Reply> replies;
+    for (size_t pos = 0; pos < data.size();) {
+        EXPECT_EQ(Protocol::BinaryParser::ResponseMagic, (unsigned char)data[pos]);
+        EXPECT_EQ(0xdeadbeef, Number(data, pos + 12, 4));
+
+        Reply reply;
+        reply.opcode = Opcode(data[pos + 1]);
+        reply.status = Status(Number(data, pos + 6, 2));
+        reply.cas = Number(data, pos + 16, 8);
+        size_t key_size = Number(data, pos + 2, 2);
+        size_t extras_size = (unsigned char)data[pos + 4];
+        size_t body_size = Number(data, pos + 8, 4);
+
+        pos += Protocol::BinaryParser::HeaderSize;
+        reply.extras = data.substr(pos, extras_size);
+        reply.key = data.substr(pos + extras_size, key_size);
+        reply.value = data.substr(pos + extras_size + key_size, body_size - extras_size - key_size);
+        pos += body_size;
+        replies.push_back(reply);
+    }
+    return replies;
+}
+
+// Frames the whole stream and executes every command, returns all responses
+static std::string Pipeline(Storage &storage, const std::string &input) {
+    Protocol::Framer framer;
+    Execute::Response response;
+    for (size_t pos = 0; pos < input.size();) {
+        size_t consumed = 0;
+        bool ready = framer.Feed(input.data() + pos, input.size() - pos, consumed);
+        pos += consumed;
+        if (ready) {
+            framer.Command()->Execute(storage, framer.Body(), response);
+            framer.Reset();
+        }
+    }
+    EXPECT_TRUE(framer.Binary());
+    return response.ToString();
+}
+
+static const std::string SetExtras = Number(0, 4) + Number(0, 4);
+
+// Stream split at any byte gives the same commands
+TEST(BinaryParserTest, SplitAnywhere) {
+    std::string input = Request(Opcode::kSet, SetExtras, "key", "value") + Request(Opcode::kGetQ, "", "key") +
+                        Request(Opcode::kNoop, "", "") + Request(Opcode::kAppend, "", "key", "!");
+    for (size_t split = 0; split <= input.size(); split++) {
+        Protocol::Framer framer;
+        std::vector<std::string> bodies;
+
+        std::string head = input.substr(0, split);
+        std::string tail = input.substr(split);
+        for (const std::string *part : {&head, &tail}) {
+            size_t offset = 0;
+            while (offset < part->size()) {
+                size_t consumed = 0;
+                bool ready = framer.Feed(part->data() + offset, part->size() - offset, consumed);
+                offset += consumed;
+                if (ready) {
+                    ASSERT_FALSE(framer.Command() == nullptr);
+                    bodies.push_back(framer.Body());
+                    framer.Reset();
+                }
+            }
+        }
+
+        ASSERT_TRUE(framer.Binary());
+        ASSERT_EQ(std::vector<std::string>({"value", "", "", "!"}), bodies) << split;
+    }
+}
+
+TEST(BinaryParserTest, Storage) {
+    Backend::SimpleLRU storage(1024 * 1024);
+    std::string input = Request(Opcode::kSet, SetExtras, "key", "value") + Request(Opcode::kGet, "", "key") +
+                        Request(Opcode::kGetK, "", "key") + Request(Opcode::kAdd, SetExtras, "key", "x") +
+                        Request(Opcode::kReplace, SetExtras, "nokey", "x") + Request(Opcode::kPrepend, "", "key", "<") +
+                        Request(Opcode::kGet, "", "nokey") + Request(Opcode::kDelete, "", "key") +
+                        Request(Opcode::kDelete, "", "key");
+
+    std::vector<Reply> replies = Decode(Pipeline(storage, input));
+    ASSERT_EQ(9, replies.size());
+
+    EXPECT_EQ(Status::kOk, replies[0].status);
+    EXPECT_NE(0, replies[0].cas);
+
+    EXPECT_EQ(Opcode::kGet, replies[1].opcode);
+    EXPECT_EQ(Status::kOk, replies[1].status);
+    EXPECT_EQ(Number(0, 4), replies[1].extras);
+    EXPECT_EQ("", replies[1].key);
+    EXPECT_EQ("value", replies[1].value);
+    EXPECT_EQ(replies[0].cas, replies[1].cas);
+
+    EXPECT_EQ("key", replies[2].key);
+    EXPECT_EQ("value", replies[2].value);
+
+    EXPECT_EQ(Status::kKeyExists, replies[3].status);
+    EXPECT_EQ(Status::kKeyNotFound, replies[4].status);
+    EXPECT_EQ(Status::kOk, replies[5].status);
+    EXPECT_EQ(Status::kKeyNotFound, replies[6].status);
+    EXPECT_EQ(Status::kOk, replies[7].status);
+    EXPECT_EQ(Status::kKeyNotFound, replies[8].status);
+}
+
+// Quiet commands respond only on failure, GETQ only on hit, so NOOP response tells that all of them are done
+TEST(BinaryParserTest, Quiet) {
+    Backend::SimpleLRU storage(1024 * 1024);
+    std::string input = Request(Opcode::kSetQ, SetExtras, "a", "1") + Request(Opcode::kGetQ, "", "b") +
+                        Request(Opcode::kAddQ, SetExtras, "a", "2") + Request(Opcode::kGetKQ, "", "a") +
+                        Request(Opcode::kDeleteQ, "", "a") + Request(Opcode::kNoop, "", "");
+
+    std::vector<Reply> replies = Decode(Pipeline(storage, input));
+    ASSERT_EQ(3, replies.size());
+    EXPECT_EQ(Opcode::kAddQ, replies[0].opcode);
+    EXPECT_EQ(Status::kKeyExists, replies[0].status);
+    EXPECT_EQ(Opcode::kGetKQ, replies[1].opcode);
+    EXPECT_EQ("a", replies[1].key);
+    EXPECT_EQ("1", replies[1].value);
+    EXPECT_EQ(Opcode::kNoop, replies[2].opcode);
+}
+
+TEST(BinaryParserTest, ArithmeticAndCas) {
+    Backend::SimpleLRU storage(1024 * 1024);
+    std::string no_initial = Number(1, 8) + Number(0, 8) + Number(0xffffffff, 4);
+    std::string initial = Number(3, 8) + Number(10, 8) + Number(0, 4);
+    std::string input = Request(Opcode::kIncrement, no_initial, "n") + Request(Opcode::kIncrement, initial, "n") +
+                        Request(Opcode::kDecrement, initial, "n") + Request(Opcode::kSet, SetExtras, "s", "abc") +
+                        Request(Opcode::kIncrement, no_initial, "s");
+
+    std::vector<Reply> replies = Decode(Pipeline(storage, input));
+    ASSERT_EQ(5, replies.size());
+    EXPECT_EQ(Status::kKeyNotFound, replies[0].status);
+    EXPECT_EQ(Number(10, 8), replies[1].value);
+    EXPECT_EQ(Number(7, 8), replies[2].value);
+    EXPECT_EQ(Status::kNonNumeric, replies[4].status);
+
+    // Set with cas succeeds only if value wasn't changed since it was fetched
+    uint64_t cas = replies[3].cas;
+    input = Request(Opcode::kSet, SetExtras, "s", "def", cas + 1) + Request(Opcode::kSet, SetExtras, "s", "def", cas) +
+            Request(Opcode::kSet, SetExtras, "s", "ghi", cas);
+    replies = Decode(Pipeline(storage, input));
+    ASSERT_EQ(3, replies.size());
+    EXPECT_EQ(Status::kKeyExists, replies[0].status);
+    EXPECT_EQ(Status::kOk, replies[1].status);
+    EXPECT_EQ(Status::kKeyExists, replies[2].status);
+}
+
+// Malformed request is answered with error, stream stays in sync as value size is known
+TEST(BinaryParserTest, Errors) {
+    Backend::SimpleLRU storage(1024 * 1024);
+    std::string input = Request(Opcode::kSet, "", "key", "value") + Request(Opcode(0x7f), "", "key", "value") +
+                        Request(Opcode::kGet, "", "") + Request(Opcode::kNoop, "", "");
+
+    std::vector<Reply> replies = Decode(Pipeline(storage, input));
+    ASSERT_EQ(4, replies.size());
+    EXPECT_EQ(Status::kInvalidArguments, replies[0].status);
+    EXPECT_EQ(Status::kUnknownCommand, replies[1].status);
+    EXPECT_EQ(Status::kInvalidArguments, replies[2].status);
+    EXPECT_EQ(Status::kOk, replies[3].status);
+
+    // Text command can't follow binary one
+    Protocol::Framer framer;
+    input = Request(Opcode::kNoop, "", "") + "get key\r\n";
+    size_t consumed = 0;
+    ASSERT_TRUE(framer.Feed(input.data(), input.size(), consumed));
+    framer.Reset();
+    ASSERT_THROW(framer.Feed(input.data() + consumed, input.size() - consumed, consumed), std::runtime_error);
+}
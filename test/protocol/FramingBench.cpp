@@ -0,0 +1,97 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <protocol/Framing.h>
+
+using namespace std;
+using namespace Afina;
+
+// Not a test: measures how fast command lines are found in a pipelined input and how fast the whole
+// stream is framed into commands, run it manually to compare scan implementations
+
+static const size_t Rounds = 200;
+
+static const char *FindLineEndMemchr(const char *begin, const char *end) {
+    return static_cast<const char *>(memchr(begin, '\n', end - begin));
+}
+
+// Stream of pipelined commands like the ones clients send, with values of the given size
+static string MakeInput(size_t value_size) {
+    string value(value_size, 'v');
+    string input;
+    for (size_t i = 0; input.size() < 1024 * 1024; i++) {
+        string key = "key_" + to_string(i);
+        input += "set " + key + " 0 0 " + to_string(value_size) + "\r\n" + value + "\r\n";
+        input += "get " + key + " key_" + to_string(i / 2) + "\r\n";
+    }
+    return input;
+}
+
+// Splits the whole input into lines, so values are scanned as well as headers
+static void Scan(const char *name, const char *(*find)(const char *, const char *), const string &input) {
+    size_t lines = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t round = 0; round < Rounds; round++) {
+        const char *pos = input.data();
+        const char *end = pos + input.size();
+        while (const char *eol = find(pos, end)) {
+            pos = eol + 1;
+            lines++;
+        }
+    }
+    auto passed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    printf("%-12s %8.2f GB/s %8.1f ns/line\n", name, double(input.size()) * Rounds / passed, double(passed) / lines);
+}
+
+// Frames the stream read into the ring buffer in socket sized pieces, as servers do
+static void Frame(const string &input) {
+    Protocol::RingBuffer ring(64 * 1024);
+    Protocol::Framer framer;
+
+    size_t commands = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t round = 0; round < Rounds; round++) {
+        size_t offset = 0;
+        while (offset < input.size()) {
+            size_t free = 0;
+            char *space = ring.WriteSpace(free);
+            size_t size = min(min(free, size_t(16 * 1024)), input.size() - offset);
+            memcpy(space, input.data() + offset, size);
+            ring.Produce(size);
+            offset += size;
+
+            while (!ring.Empty()) {
+                size_t available = 0, consumed = 0;
+                const char *data = ring.ReadSpace(available);
+                bool ready = framer.Feed(data, available, consumed);
+                ring.Consume(consumed);
+                if (ready) {
+                    framer.Reset();
+                    commands++;
+                }
+            }
+        }
+    }
+    auto passed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    printf("%-12s %8.2f GB/s %8.1f ns/command\n", "framer", double(input.size()) * Rounds / passed,
+           double(passed) / commands);
+}
+
+int main() {
+    for (size_t value_size : {8, 100, 1000}) {
+        string input = MakeInput(value_size);
+        printf("value size %zu\n", value_size);
+        Scan("bytes", &Protocol::FindLineEndBytes, input);
+        Scan("memchr", &FindLineEndMemchr, input);
+        if (Protocol::FindLineEndSSE2 != nullptr) {
+            Scan("sse2", Protocol::FindLineEndSSE2, input);
+        }
+        if (Protocol::FindLineEndAVX2 != nullptr) {
+            Scan("avx2", Protocol::FindLineEndAVX2, input);
+        }
+        Frame(input);
+    }
+    return 0;
+}
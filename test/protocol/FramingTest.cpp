@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <afina/execute/Command.h>
+#include <afina/execute/Set.h>
+
+#include <protocol/Framing.h>
+
+using namespace Afina;
+
+// Vector implementations must agree with the byte loop wherever the line end is and however input is aligned
+TEST(FramingTest, FindLineEnd) {
+    std::vector<const char *(*)(const char *, const char *)> impls = {&Protocol::FindLineEnd};
+    if (Protocol::FindLineEndSSE2 != nullptr) {
+        impls.push_back(Protocol::FindLineEndSSE2);
+    }
+    if (Protocol::FindLineEndAVX2 != nullptr) {
+        impls.push_back(Protocol::FindLineEndAVX2);
+    }
+
+    std::string buffer(160, 'a');
+    for (size_t offset = 0; offset < 32; offset++) {
+        for (size_t size = 0; offset + size <= 128; size++) {
+            for (size_t eol = 0; eol <= size; eol++) {
+                std::string input = buffer;
+                if (eol < size) {
+                    input[offset + eol] = '\n';
+                }
+                // Newline right past the end must not be seen
+                input[offset + size] = '\n';
+
+                const char *begin = input.data() + offset;
+                const char *end = begin + size;
+                const char *expected = Protocol::FindLineEndBytes(begin, end);
+                ASSERT_EQ(eol < size ? begin + eol : nullptr, expected);
+                for (auto impl : impls) {
+                    ASSERT_EQ(expected, impl(begin, end)) << offset << " " << size << " " << eol;
+                }
+            }
+        }
+    }
+}
+
+TEST(FramingTest, RingBufferWrapsAround) {
+    Protocol::RingBuffer ring(10);
+    ASSERT_EQ(16, ring.Capacity());
+    ASSERT_TRUE(ring.Empty());
+
+    size_t size = 0;
+    char *space = ring.WriteSpace(size);
+    ASSERT_EQ(16, size);
+    memcpy(space, "0123456789abcd", 14);
+    ring.Produce(14);
+
+    const char *data = ring.ReadSpace(size);
+    ASSERT_EQ(14, size);
+    ASSERT_EQ("0123456789", std::string(data, 10));
+    ring.Consume(10);
+
+    // Free space is split by the end of the buffer, data follows it
+    space = ring.WriteSpace(size);
+    ASSERT_EQ(2, size);
+    memcpy(space, "ef", 2);
+    ring.Produce(2);
+    space = ring.WriteSpace(size);
+    ASSERT_EQ(10, size);
+    memcpy(space, "ghij", 4);
+    ring.Produce(4);
+    ASSERT_EQ(10, ring.Size());
+
+    data = ring.ReadSpace(size);
+    ASSERT_EQ("abcdef", std::string(data, size));
+    ring.Consume(size);
+    data = ring.ReadSpace(size);
+    ASSERT_EQ("ghij", std::string(data, size));
+    ring.Consume(size);
+    ASSERT_TRUE(ring.Empty());
+
+    ASSERT_THROW(ring.Consume(1), std::logic_error);
+
+    // Empty buffer starts over from the beginning
+    ring.WriteSpace(size);
+    ASSERT_EQ(16, size);
+}
+
+// Pipelined stream split at any byte gives the same commands
+TEST(FramingTest, SplitAnywhere) {
+    std::string input = "set foo 0 0 6\r\nfooval\r\nget foo bar\r\nset bar 1 0 0\r\n\r\nget bar\r\n";
+    for (size_t split = 0; split <= input.size(); split++) {
+        Protocol::Framer framer;
+        std::vector<std::string> names, bodies;
+
+        size_t pos = 0;
+        std::string head = input.substr(0, split);
+        std::string tail = input.substr(split);
+        for (const std::string *part : {&head, &tail}) {
+            size_t offset = 0;
+            while (offset < part->size()) {
+                size_t consumed = 0;
+                bool ready = framer.Feed(part->data() + offset, part->size() - offset, consumed);
+                offset += consumed;
+                if (ready) {
+                    ASSERT_FALSE(framer.Command() == nullptr);
+                    names.push_back(dynamic_cast<Execute::Set *>(framer.Command().get()) != nullptr ? "set" : "get");
+                    bodies.push_back(framer.Body());
+                    framer.Reset();
+                }
+            }
+            pos += offset;
+        }
+
+        ASSERT_EQ(input.size(), pos);
+        ASSERT_EQ(std::vector<std::string>({"set", "get", "set", "get"}), names) << split;
+        ASSERT_EQ(std::vector<std::string>({"fooval", "", "", ""}), bodies) << split;
+    }
+}
+
+// Empty data block still has its trailer, which must not be taken as the next command
+TEST(FramingTest, EmptyBody) {
+    Protocol::Framer framer;
+    std::string input = "set foo 0 0 0\r\n\r\n";
+
+    size_t consumed = 0;
+    ASSERT_TRUE(framer.Feed(input.data(), input.size(), consumed));
+    ASSERT_EQ(input.size(), consumed);
+    ASSERT_EQ("", framer.Body());
+
+    framer.Reset();
+    input = "set foo 0 0 1\r\nab\r\n";
+    ASSERT_THROW(framer.Feed(input.data(), input.size(), consumed), std::runtime_error);
+}
@@ -1,12 +1,20 @@
 #include <gtest/gtest.h>
 
+#include <climits>
+#include <cstring>
 #include <memory>
 #include <string>
 
 #include <afina/execute/Add.h>
+#include <afina/execute/Cas.h>
+#include <afina/execute/Decr.h>
+#include <afina/execute/Delete.h>
 #include <afina/execute/Get.h>
+#include <afina/execute/Incr.h>
+#include <afina/execute/Prepend.h>
 #include <afina/execute/Set.h>
 #include <afina/execute/Stats.h>
+#include <afina/execute/Touch.h>
 
 #include <protocol/Parser.h>
 
@@ -98,3 +106,160 @@ TEST(MemcachedParserTest, Stats) {
     Execute::Stats *tmp = reinterpret_cast<Execute::Stats *>(cmd.get());
 	ASSERT_FALSE(tmp == nullptr);
 }
+
+// Keys point right into the input when the whole line is there
+TEST(MemcachedParserTest, KeysReferToInput) {
+    Protocol::Parser parser;
+    const char input[] = "get  a bb   ccc\r\nget next\r\n";
+
+    size_t consumed = 0;
+    ASSERT_TRUE(parser.Parse(input, sizeof(input) - 1, consumed));
+    ASSERT_EQ(17, consumed);
+    ASSERT_TRUE(parser.Id() == Protocol::Parser::CommandId::kGet);
+
+    const std::vector<Protocol::Parser::Span> &keys = parser.Keys();
+    ASSERT_EQ(3, keys.size());
+    EXPECT_EQ(input + 5, keys[0].data);
+    EXPECT_EQ("bb", keys[1].str());
+    EXPECT_EQ("ccc", keys[2].str());
+}
+
+// Line split at any byte is collected inside of the parser
+TEST(MemcachedParserTest, SplitLine) {
+    std::string input = "set key 4294967295 -2147483648 123456\r\n";
+    for (size_t split = 1; split < input.size(); split++) {
+        Protocol::Parser parser;
+        std::string head = input.substr(0, split);
+        std::string tail = input.substr(split);
+
+        size_t consumed = 0;
+        ASSERT_FALSE(parser.Parse(head.data(), head.size(), consumed));
+        ASSERT_EQ(head.size(), consumed);
+        ASSERT_TRUE(parser.Parse(tail.data(), tail.size(), consumed));
+        ASSERT_EQ(tail.size(), consumed);
+
+        // Buffers parsed from could be gone already
+        head.assign(head.size(), 'x');
+        tail.assign(tail.size(), 'x');
+
+        uint32_t value_size;
+        std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
+        ASSERT_FALSE(cmd == nullptr);
+        ASSERT_EQ(123456, value_size);
+
+        Execute::Set *tmp = reinterpret_cast<Execute::Set *>(cmd.get());
+        ASSERT_EQ("key", tmp->key());
+        ASSERT_EQ(4294967295u, tmp->flags());
+        ASSERT_EQ(INT32_MIN, tmp->expire());
+    }
+}
+
+// Every command of the text protocol, each one is followed by a data block if it expects one
+TEST(MemcachedParserTest, AllCommands) {
+    std::string input = "gets a b\r\n"
+                        "prepend k 1 2 3\r\nabc\r\n"
+                        "cas k 1 -2 0 18446744073709551615 noreply\r\n\r\n"
+                        "delete k noreply\r\n"
+                        "incr k 18446744073709551615\r\n"
+                        "decr k 1 noreply\r\n"
+                        "touch k 100\r\n";
+
+    std::vector<std::unique_ptr<Execute::Command>> cmds;
+    std::vector<uint32_t> sizes;
+    size_t pos = 0;
+    Protocol::Parser parser;
+    while (pos < input.size()) {
+        size_t consumed = 0;
+        ASSERT_TRUE(parser.Parse(input.data() + pos, input.size() - pos, consumed));
+        pos += consumed;
+
+        uint32_t body_size = 0;
+        cmds.push_back(parser.Build(body_size));
+        sizes.push_back(body_size);
+        if (parser.ExpectsBody()) {
+            pos += body_size + 2;
+        }
+        parser.Reset();
+    }
+    ASSERT_EQ(7, cmds.size());
+
+    Execute::Get *get = dynamic_cast<Execute::Get *>(cmds[0].get());
+    ASSERT_TRUE(get != nullptr);
+    ASSERT_TRUE(get->cas());
+    ASSERT_EQ(std::vector<std::string>({"a", "b"}), get->keys());
+
+    Execute::Prepend *prepend = dynamic_cast<Execute::Prepend *>(cmds[1].get());
+    ASSERT_TRUE(prepend != nullptr);
+    ASSERT_EQ(1, prepend->flags());
+    ASSERT_EQ(2, prepend->expire());
+    ASSERT_EQ(3, sizes[1]);
+    ASSERT_FALSE(prepend->noreply());
+
+    Execute::Cas *cas = dynamic_cast<Execute::Cas *>(cmds[2].get());
+    ASSERT_TRUE(cas != nullptr);
+    ASSERT_EQ(-2, cas->expire());
+    ASSERT_EQ(UINT64_MAX, cas->unique());
+    ASSERT_EQ(0, sizes[2]);
+    ASSERT_TRUE(cas->noreply());
+
+    Execute::Delete *del = dynamic_cast<Execute::Delete *>(cmds[3].get());
+    ASSERT_TRUE(del != nullptr);
+    ASSERT_EQ("k", del->key());
+    ASSERT_TRUE(del->noreply());
+
+    Execute::Incr *incr = dynamic_cast<Execute::Incr *>(cmds[4].get());
+    ASSERT_TRUE(incr != nullptr);
+    ASSERT_EQ(UINT64_MAX, incr->delta());
+    ASSERT_FALSE(incr->noreply());
+
+    Execute::Decr *decr = dynamic_cast<Execute::Decr *>(cmds[5].get());
+    ASSERT_TRUE(decr != nullptr);
+    ASSERT_EQ(1, decr->delta());
+    ASSERT_TRUE(decr->noreply());
+
+    Execute::Touch *touch = dynamic_cast<Execute::Touch *>(cmds[6].get());
+    ASSERT_TRUE(touch != nullptr);
+    ASSERT_EQ(100, touch->expire());
+}
+
+TEST(MemcachedParserTest, Lookup) {
+    const char *names[] = {"get", "gets",   "set",  "add",  "replace", "append", "prepend",
+                           "cas", "delete", "incr", "decr", "touch",   "stats"};
+    for (const char *name : names) {
+        Protocol::Parser::CommandId id = Protocol::Parser::Lookup(name, strlen(name));
+        ASSERT_TRUE(id != Protocol::Parser::CommandId::kUnknown) << name;
+    }
+
+    ASSERT_TRUE(Protocol::Parser::Lookup("gat", 3) == Protocol::Parser::CommandId::kUnknown);
+    ASSERT_TRUE(Protocol::Parser::Lookup("sets", 4) == Protocol::Parser::CommandId::kUnknown);
+    ASSERT_TRUE(Protocol::Parser::Lookup("version", 7) == Protocol::Parser::CommandId::kUnknown);
+    ASSERT_TRUE(Protocol::Parser::Lookup("g", 1) == Protocol::Parser::CommandId::kUnknown);
+    ASSERT_TRUE(Protocol::Parser::Lookup("", 0) == Protocol::Parser::CommandId::kUnknown);
+}
+
+TEST(MemcachedParserTest, Errors) {
+    const char *inputs[] = {
+        "foo bar\r\n",
+        "\r\n",
+        "get\r\n",
+        "get key\n",
+        "set key 0 0\r\n",
+        "set key x 0 1\r\n",
+        "set key 0 0 4294967296\r\n",
+        "cas key 0 0 1\r\n",
+        "delete\r\n",
+        "incr key\r\n",
+        "incr key 18446744073709551616\r\n",
+        "touch key\r\n",
+    };
+    for (const char *input : inputs) {
+        Protocol::Parser parser;
+        size_t consumed = 0;
+        ASSERT_THROW(parser.Parse(input, strlen(input), consumed), std::runtime_error) << input;
+    }
+
+    Protocol::Parser parser;
+    std::string garbage(128 * 1024, 'a');
+    size_t consumed = 0;
+    ASSERT_THROW(parser.Parse(garbage.data(), garbage.size(), consumed), std::runtime_error);
+}
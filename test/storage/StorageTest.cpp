@@ -1,14 +1,33 @@
 #include "gtest/gtest.h"
+#include <atomic>
 #include <iostream>
+#include <list>
+#include <map>
+#include <random>
 #include <set>
+#include <thread>
 #include <vector>
 
+#include <storage/Epoch.h>
 #include <storage/MapBasedGlobalLockImpl.h>
+#include <storage/RCUHashImpl.h>
+#include <storage/SimpleLRU.h>
+#include <storage/StripedLockImpl.h>
+#include <storage/ThreadSafeSimpleLRU.h>
+#include <storage/TimerWheel.h>
 #include <afina/execute/Get.h>
 #include <afina/execute/Set.h>
 #include <afina/execute/Add.h>
 #include <afina/execute/Append.h>
 #include <afina/execute/Delete.h>
+#include <afina/execute/Stats.h>
+#include <afina/execute/Response.h>
+#include <afina/execute/Replace.h>
+#include <afina/execute/Prepend.h>
+#include <afina/execute/Incr.h>
+#include <afina/execute/Decr.h>
+#include <afina/execute/Touch.h>
+#include <afina/execute/Cas.h>
 
 using namespace Afina::Backend;
 using namespace Afina::Execute;
@@ -51,7 +70,7 @@ TEST(StorageTest, PutIfAbsent) {
 }
 
 TEST(StorageTest, BigTest) {
-    MapBasedGlobalLockImpl storage(100000);
+    MapBasedGlobalLockImpl storage(100000 * MapBasedGlobalLockImpl::EntrySize(16, 16));
 
     std::stringstream ss;
 
@@ -84,7 +103,13 @@ TEST(StorageTest, BigTest) {
 }
 
 TEST(StorageTest, MaxTest) {
-    MapBasedGlobalLockImpl storage(1000);
+    // Exactly enough room for the last 1000 entries
+    size_t max_size = 0;
+    for (long i = 100; i < 1100; ++i) {
+        max_size += MapBasedGlobalLockImpl::EntrySize(("Key" + std::to_string(i)).size(),
+                                                      ("Val" + std::to_string(i)).size());
+    }
+    MapBasedGlobalLockImpl storage(max_size);
 
     std::stringstream ss;
 
@@ -124,3 +149,732 @@ TEST(StorageTest, MaxTest) {
         EXPECT_FALSE(storage.Get(key, res));
     }
 }
+
+TEST(StorageTest, StripedPutGetDelete) {
+    StripedLockImpl storage;
+
+    EXPECT_TRUE(storage.Put("KEY1", "val1"));
+    EXPECT_TRUE(storage.Put("KEY2", "val2"));
+    EXPECT_FALSE(storage.PutIfAbsent("KEY1", "val3"));
+    EXPECT_TRUE(storage.Set("KEY2", "val4"));
+    EXPECT_FALSE(storage.Set("KEY3", "val5"));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val1", value);
+    EXPECT_TRUE(storage.Get("KEY2", value));
+    EXPECT_EQ("val4", value);
+
+    EXPECT_TRUE(storage.Delete("KEY1"));
+    EXPECT_FALSE(storage.Delete("KEY1"));
+    EXPECT_FALSE(storage.Get("KEY1", value));
+}
+
+TEST(StorageTest, StripedEvictByBytes) {
+    // Single shard to make eviction order predictable, only 5 entries fits
+    std::string val(18, 'x');
+    StripedLockImpl storage(5 * SimpleLRU::EntrySize(2, val.size()), 1);
+
+    for (int i = 0; i < 10; i++) {
+        EXPECT_TRUE(storage.Put("k" + std::to_string(i), val));
+    }
+
+    std::string res;
+    for (int i = 0; i < 5; i++) {
+        EXPECT_FALSE(storage.Get("k" + std::to_string(i), res));
+    }
+    for (int i = 5; i < 10; i++) {
+        EXPECT_TRUE(storage.Get("k" + std::to_string(i), res));
+    }
+
+    // k5 is the oldest one, but it was accessed before k6, so k6 gets evicted
+    EXPECT_TRUE(storage.Get("k5", res));
+    EXPECT_TRUE(storage.Put("kx", val));
+    EXPECT_TRUE(storage.Get("k5", res));
+    EXPECT_FALSE(storage.Get("k6", res));
+
+    // Value could never fit into the shard
+    EXPECT_FALSE(storage.Put("big", std::string(5 * SimpleLRU::EntrySize(2, val.size()), 'x')));
+
+    std::vector<std::pair<std::string, std::string>> stats;
+    storage.CollectStats(stats);
+    std::map<std::string, std::string> named(stats.begin(), stats.end());
+    EXPECT_EQ("5", named["curr_items"]);
+    EXPECT_EQ(std::to_string(5 * SimpleLRU::EntrySize(2, val.size())), named["bytes"]);
+    EXPECT_EQ("6", named["evictions"]);
+}
+
+TEST(StorageTest, StripedConcurrent) {
+    StripedLockImpl storage(64 * 1024 * 1024, 8);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&storage, t]() {
+            for (int i = 0; i < 10000; i++) {
+                std::string key = "Key" + std::to_string(t) + "_" + std::to_string(i);
+                storage.Put(key, "Val" + std::to_string(i));
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    for (int t = 0; t < 4; t++) {
+        for (int i = 0; i < 10000; i++) {
+            std::string res;
+            EXPECT_TRUE(storage.Get("Key" + std::to_string(t) + "_" + std::to_string(i), res));
+            EXPECT_EQ("Val" + std::to_string(i), res);
+        }
+    }
+}
+
+TEST(StorageTest, LRUPutRefreshesOrder) {
+    SimpleLRU storage(3 * SimpleLRU::EntrySize(2, 8));
+
+    EXPECT_TRUE(storage.Put("k1", "01234567"));
+    EXPECT_TRUE(storage.Put("k2", "01234567"));
+    EXPECT_TRUE(storage.Put("k3", "01234567"));
+
+    // Overwrite makes k1 the most recent one, so k2 gets evicted next
+    EXPECT_TRUE(storage.Put("k1", "76543210"));
+    EXPECT_TRUE(storage.Put("k4", "01234567"));
+
+    std::string res;
+    EXPECT_FALSE(storage.Get("k2", res));
+    EXPECT_TRUE(storage.Get("k1", res));
+    EXPECT_EQ("76543210", res);
+    EXPECT_TRUE(storage.Get("k3", res));
+    EXPECT_TRUE(storage.Get("k4", res));
+    EXPECT_EQ(3, storage.Count());
+    EXPECT_EQ(3 * SimpleLRU::EntrySize(2, 8), storage.Size());
+}
+
+TEST(StorageTest, LRUGrowValue) {
+    SimpleLRU storage(SimpleLRU::EntrySize(2, 1) + SimpleLRU::EntrySize(2, 90));
+
+    EXPECT_TRUE(storage.Put("k1", "v"));
+    EXPECT_TRUE(storage.Put("k2", "v"));
+    EXPECT_TRUE(storage.Set("k1", std::string(90, 'x')));
+
+    std::string res;
+    EXPECT_TRUE(storage.Get("k1", res));
+    EXPECT_EQ(std::string(90, 'x'), res);
+    EXPECT_TRUE(storage.Get("k2", res));
+
+    // Growing further requires to evict k2
+    EXPECT_TRUE(storage.Set("k1", std::string(91, 'y')));
+    EXPECT_FALSE(storage.Get("k2", res));
+    EXPECT_TRUE(storage.Get("k1", res));
+    EXPECT_EQ(std::string(91, 'y'), res);
+
+    // Too big value removes the entry
+    EXPECT_FALSE(storage.Set("k1", std::string(storage.MaxSize(), 'z')));
+    EXPECT_FALSE(storage.Get("k1", res));
+    EXPECT_EQ(0, storage.Size());
+}
+
+// Entry points without ttl forward to the ttl ones, that must not lock the wrapper's mutex once again
+TEST(StorageTest, ThreadSafeLRUEntryPoints) {
+    ThreadSafeSimpleLRU storage(1024 * 1024);
+
+    EXPECT_TRUE(storage.Put("KEY1", "val1"));
+    EXPECT_TRUE(storage.PutIfAbsent("KEY2", "val2"));
+    EXPECT_FALSE(storage.PutIfAbsent("KEY1", "val3"));
+    EXPECT_TRUE(storage.Set("KEY1", "val4"));
+    EXPECT_FALSE(storage.Set("KEY3", "val5"));
+    EXPECT_TRUE(storage.Put("KEY3", "val6", 100));
+    EXPECT_TRUE(storage.Set("KEY3", "val7", 100));
+    EXPECT_FALSE(storage.PutIfAbsent("KEY3", "val8", 100));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val4", value);
+    Afina::Value handle;
+    EXPECT_TRUE(storage.GetValue("KEY3", handle));
+    EXPECT_EQ("val7", std::string(handle.data(), handle.size()));
+
+    std::vector<std::pair<std::string, std::string>> stats;
+    storage.CollectStats(stats);
+    EXPECT_FALSE(stats.empty());
+
+    EXPECT_TRUE(storage.Delete("KEY2"));
+    EXPECT_FALSE(storage.Get("KEY2", value));
+}
+
+TEST(StorageTest, LRURandomized) {
+    // Reference model: list keeps LRU order, map points into it
+    const size_t max_size = 100 * SimpleLRU::EntrySize(2, 10);
+    std::list<std::pair<std::string, std::string>> order;
+    std::map<std::string, std::list<std::pair<std::string, std::string>>::iterator> index;
+    size_t size = 0;
+
+    SimpleLRU storage(max_size);
+    std::mt19937 rnd(42);
+    for (int i = 0; i < 100000; i++) {
+        std::string key = "k" + std::to_string(rnd() % 300);
+        int op = rnd() % 3;
+        auto it = index.find(key);
+        if (op == 0) {
+            std::string value(rnd() % 20, 'a' + rnd() % 26);
+            EXPECT_TRUE(storage.Put(key, value));
+            if (it != index.end()) {
+                size -= SimpleLRU::EntrySize(it->second->first.size(), it->second->second.size());
+                order.erase(it->second);
+                index.erase(it);
+            }
+            while (size + SimpleLRU::EntrySize(key.size(), value.size()) > max_size) {
+                size -= SimpleLRU::EntrySize(order.back().first.size(), order.back().second.size());
+                index.erase(order.back().first);
+                order.pop_back();
+            }
+            order.emplace_front(key, value);
+            index[key] = order.begin();
+            size += SimpleLRU::EntrySize(key.size(), value.size());
+        } else if (op == 1) {
+            EXPECT_EQ(it != index.end(), storage.Delete(key));
+            if (it != index.end()) {
+                size -= SimpleLRU::EntrySize(it->second->first.size(), it->second->second.size());
+                order.erase(it->second);
+                index.erase(it);
+            }
+        } else {
+            std::string res;
+            ASSERT_EQ(it != index.end(), storage.Get(key, res));
+            if (it != index.end()) {
+                EXPECT_EQ(it->second->second, res);
+                order.splice(order.begin(), order, it->second);
+            }
+        }
+        ASSERT_EQ(index.size(), storage.Count());
+        ASSERT_EQ(size, storage.Size());
+    }
+}
+
+TEST(StorageTest, LRUSlabRebalance) {
+    // Byte limit is far away, so only allocator quota of 8 slabs makes entries evicted
+    const size_t quota = 256 * 1024;
+    SimpleLRU storage(1024 * 1024, quota);
+
+    std::string small(100, 's'), large(2000, 'l');
+    for (int i = 0; i < 10000; i++) {
+        ASSERT_TRUE(storage.Put("small" + std::to_string(i), small));
+        ASSERT_LE(storage.Memory(), quota);
+    }
+    EXPECT_GT(storage.Evictions(), 0);
+
+    // Workload moves to another size class, it must take slabs from the previous one
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_TRUE(storage.Put("large" + std::to_string(i), large));
+        ASSERT_LE(storage.Memory(), quota);
+    }
+
+    std::string res;
+    for (int i = 990; i < 1000; i++) {
+        EXPECT_TRUE(storage.Get("large" + std::to_string(i), res));
+        EXPECT_EQ(large, res);
+    }
+
+    std::vector<Afina::Allocator::SlabAllocator::ClassStats> slabs;
+    storage.CollectSlabStats(slabs);
+    size_t large_slabs = 0, total_slabs = 0;
+    for (auto &stats : slabs) {
+        if (stats.size >= large.size()) {
+            large_slabs += stats.slabs;
+        }
+        total_slabs += stats.slabs;
+    }
+    EXPECT_GE(large_slabs, total_slabs - 1);
+}
+
+TEST(StorageTest, LRURebalancePinnedValues) {
+    const size_t quota = 256 * 1024;
+    SimpleLRU storage(1024 * 1024, quota);
+
+    // Quota is filled with entries of the small class, some of them are removed but stay pinned by handles
+    std::string small(100, 's'), large(2000, 'l');
+    std::vector<Afina::Value> pinned;
+    for (int i = 0; i < 2000; i++) {
+        std::string key = "small" + std::to_string(i);
+        ASSERT_TRUE(storage.Put(key, small));
+        if (i >= 1000 && i % 4 == 0) {
+            pinned.emplace_back();
+            ASSERT_TRUE(storage.GetValue(key, pinned.back()));
+            storage.Delete(key);
+        }
+    }
+
+    // Handles are dropped while large entries take slabs away from the small class. Slabs are pinned
+    // until then, so puts could fail meanwhile
+    std::atomic<bool> done(false);
+    std::thread releaser([&pinned, &small, &done]() {
+        for (auto &value : pinned) {
+            EXPECT_EQ(small, value.str());
+            value.Reset();
+            std::this_thread::yield();
+        }
+        done = true;
+    });
+
+    for (int i = 0; !done; i++) {
+        storage.Put("large" + std::to_string(i % 1000), large);
+        EXPECT_LE(storage.Memory(), quota);
+    }
+    releaser.join();
+
+    std::string res;
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_TRUE(storage.Put("large" + std::to_string(i), large));
+        ASSERT_LE(storage.Memory(), quota);
+    }
+    EXPECT_TRUE(storage.Get("large999", res));
+    EXPECT_EQ(large, res);
+}
+
+TEST(StorageTest, StatsCommand) {
+    MapBasedGlobalLockImpl storage(1024 * 1024);
+    storage.Put("KEY1", "val1");
+
+    Stats cmd;
+    std::string out;
+    cmd.Execute(storage, "", out);
+
+    std::string expected = "STAT curr_items 1\r\nSTAT bytes " + std::to_string(MapBasedGlobalLockImpl::EntrySize(4, 4)) +
+                           "\r\nSTAT limit_maxbytes 1048576\r\nSTAT evictions 0\r\nEND";
+    EXPECT_EQ(expected, out);
+}
+
+TEST(StorageTest, ValueOutlivesUpdate) {
+    SimpleLRU lru(1024 * 1024);
+    RCUHashImpl rcu(1024 * 1024);
+    MapBasedGlobalLockImpl map(1024 * 1024);
+
+    std::vector<Afina::Storage *> storages = {&lru, &rcu, &map};
+    for (auto storage : storages) {
+        storage->Put("KEY1", "val1");
+
+        Afina::Value value;
+        EXPECT_TRUE(storage->GetValue("KEY1", value));
+        EXPECT_FALSE(storage->GetValue("KEY2", value));
+        EXPECT_EQ("val1", value.str());
+
+        // Same size update must not overwrite bytes pinned by the handle
+        storage->Put("KEY1", "val2");
+        EXPECT_EQ("val1", value.str());
+
+        storage->Delete("KEY1");
+        EXPECT_EQ("val1", value.str());
+    }
+    Epoch::Synchronize();
+}
+
+TEST(StorageTest, GetCommandResponse) {
+    SimpleLRU storage(1024 * 1024);
+    std::string big(1000, 'x');
+    storage.Put("KEY1", "val1");
+    storage.Put("KEY2", big);
+
+    Get cmd({"KEY1", "KEY3", "KEY2"});
+    Response response;
+    cmd.Execute(storage, "", response);
+
+    std::string expected = "VALUE KEY1 0 4\r\nval1\r\nVALUE KEY2 0 1000\r\n" + big + "\r\nEND\r\n";
+    EXPECT_EQ(expected, response.ToString());
+    EXPECT_EQ(expected.size(), response.Size());
+
+    // Big value is referenced in place, small one is copied into text
+    EXPECT_EQ(3, response.Chunks());
+    const char *data;
+    size_t size;
+    response.Chunk(1, data, size);
+    EXPECT_EQ(big.size(), size);
+
+    std::string out;
+    cmd.Execute(storage, "", out);
+    EXPECT_EQ(expected.substr(0, expected.size() - 2), out);
+}
+
+// Batched lookup must agree with lookups one by one in every storage, whatever shards keys fall into
+TEST(StorageTest, MultiGet) {
+    MapBasedGlobalLockImpl map;
+    ThreadSafeSimpleLRU lru(1024 * 1024);
+    StripedLockImpl striped(1024 * 1024);
+    RCUHashImpl rcu(1024 * 1024);
+    for (Afina::Storage *storage : std::vector<Afina::Storage *>{&map, &lru, &striped, &rcu}) {
+        std::vector<std::string> keys;
+        for (int i = 0; i < 100; i++) {
+            keys.push_back("key" + std::to_string(i));
+            if (i % 3 != 0) {
+                storage->Put(keys.back(), "value" + std::to_string(i));
+            }
+        }
+        keys.push_back("key1");
+        keys.push_back("key0");
+
+        std::vector<Afina::Value> values;
+        ASSERT_EQ(67, storage->MultiGet(keys, values));
+        ASSERT_EQ(keys.size(), values.size());
+        for (size_t i = 0; i < keys.size(); i++) {
+            Afina::Value value;
+            ASSERT_EQ(storage->GetValue(keys[i], value), !values[i].empty()) << keys[i];
+            ASSERT_EQ(std::string(value.data(), value.size()), std::string(values[i].data(), values[i].size()));
+        }
+    }
+    Epoch::Synchronize();
+}
+
+TEST(StorageTest, TimerWheelOrder) {
+    TimerWheel wheel;
+    uint32_t start = TimerWheel::Now();
+
+    // Deadlines spread across all levels, some are in the past already
+    uint32_t past = start > 10 ? start - 10 : 0;
+    std::mt19937 rnd(17);
+    std::vector<TimerWheel::Timer> timers(10000);
+    for (auto &timer : timers) {
+        wheel.Schedule(&timer, past + rnd() % 300000);
+    }
+
+    // Every third timer is cancelled
+    for (size_t i = 0; i < timers.size(); i += 3) {
+        wheel.Cancel(&timers[i]);
+    }
+
+    size_t popped = 0;
+    for (uint32_t now = start; now < start + 300500; now += 1 + rnd() % 500) {
+        TimerWheel::Timer *timer;
+        while ((timer = wheel.Pop(now)) != nullptr) {
+            ASSERT_LE(timer->deadline, now);
+            ASSERT_FALSE(timer->Scheduled());
+            popped++;
+        }
+
+        // Nothing expired is left behind
+        for (size_t i = 1; i < timers.size(); i++) {
+            if (i % 3 != 0) {
+                ASSERT_TRUE(timers[i].deadline > now || !timers[i].Scheduled());
+            }
+        }
+    }
+    EXPECT_EQ(timers.size() - (timers.size() + 2) / 3, popped);
+    EXPECT_EQ(0, wheel.Count());
+}
+
+TEST(StorageTest, ExpireByTTL) {
+    SimpleLRU lru(1024 * 1024);
+    RCUHashImpl rcu(1024 * 1024);
+    StripedLockImpl striped(1024 * 1024);
+    MapBasedGlobalLockImpl map(1024 * 1024);
+
+    std::vector<Afina::Storage *> storages = {&lru, &rcu, &striped, &map};
+    for (auto storage : storages) {
+        EXPECT_TRUE(storage->Put("KEY1", "val1", 1));
+        EXPECT_TRUE(storage->PutIfAbsent("KEY2", "val2", 1));
+        EXPECT_TRUE(storage->Put("KEY3", "val3", 1000));
+        EXPECT_TRUE(storage->Put("KEY4", "val4"));
+        EXPECT_TRUE(storage->Put("KEY5", "val5", 1));
+        EXPECT_TRUE(storage->Set("KEY5", "val5"));
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(2100));
+
+    for (auto storage : storages) {
+        std::string value;
+        EXPECT_FALSE(storage->Get("KEY1", value));
+        EXPECT_TRUE(storage->PutIfAbsent("KEY2", "val2"));
+        EXPECT_TRUE(storage->Get("KEY3", value));
+        EXPECT_TRUE(storage->Get("KEY4", value));
+        EXPECT_TRUE(storage->Get("KEY5", value));
+    }
+
+    // KEY1 is reclaimed by timer, KEY2 by PutIfAbsent
+    EXPECT_EQ(1, lru.Expire(100));
+    EXPECT_EQ(4, lru.Count());
+    EXPECT_EQ(2, lru.Expirations());
+    EXPECT_FALSE(rcu.Expire(100));
+}
+
+TEST(StorageTest, ExpiredInsertCommand) {
+    SimpleLRU storage(1024 * 1024);
+
+    std::string out;
+    Afina::Execute::Set set("KEY1", 0, -1);
+    set.Execute(storage, "val1", out);
+    EXPECT_EQ("STORED", out);
+
+    std::string value;
+    EXPECT_FALSE(storage.Get("KEY1", value));
+
+    // Unix time in the past
+    Replace replace("KEY1", 0, 100000000);
+    storage.Put("KEY1", "val1");
+    replace.Execute(storage, "val2", out);
+    EXPECT_EQ("STORED", out);
+    EXPECT_FALSE(storage.Get("KEY1", value));
+    replace.Execute(storage, "val2", out);
+    EXPECT_EQ("NOT_STORED", out);
+
+    // Expired add never touches the storage
+    Add add("KEY1", 0, -1);
+    add.Execute(storage, "val1", out);
+    EXPECT_EQ("STORED", out);
+    EXPECT_FALSE(storage.Get("KEY1", value));
+    storage.Put("KEY1", "val1");
+    add.Execute(storage, "val2", out);
+    EXPECT_EQ("NOT_STORED", out);
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val1", value);
+
+    uint32_t ttl = 0;
+    EXPECT_TRUE(Afina::Execute::Set("KEY1", 0, 100).TimeToLive(ttl));
+    EXPECT_EQ(100, ttl);
+    EXPECT_TRUE(Afina::Execute::Set("KEY1", 0, time(nullptr) + 1000).TimeToLive(ttl));
+    EXPECT_LE(999, ttl);
+}
+
+TEST(StorageTest, UpdateCommands) {
+    SimpleLRU storage(1024 * 1024);
+    std::string out, value;
+
+    Prepend prepend("KEY1", 0, 0);
+    prepend.Execute(storage, "pre", out);
+    EXPECT_EQ("NOT_STORED", out);
+    storage.Put("KEY1", "val1");
+    prepend.Execute(storage, "pre", out);
+    EXPECT_EQ("STORED", out);
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("preval1", value);
+
+    Delete del("KEY1");
+    del.Execute(storage, "", out);
+    EXPECT_EQ("DELETED", out);
+    del.Execute(storage, "", out);
+    EXPECT_EQ("NOT_FOUND", out);
+
+    Touch touch("KEY1", 100);
+    touch.Execute(storage, "", out);
+    EXPECT_EQ("NOT_FOUND", out);
+    storage.Put("KEY1", "val1");
+    touch.Execute(storage, "", out);
+    EXPECT_EQ("TOUCHED", out);
+    Touch("KEY1", -1).Execute(storage, "", out);
+    EXPECT_EQ("TOUCHED", out);
+    EXPECT_FALSE(storage.Get("KEY1", value));
+}
+
+TEST(StorageTest, ArithmeticCommands) {
+    SimpleLRU storage(1024 * 1024);
+    std::string out, value;
+
+    Incr("KEY1", 1).Execute(storage, "", out);
+    EXPECT_EQ("NOT_FOUND", out);
+
+    storage.Put("KEY1", "18446744073709551614");
+    Incr("KEY1", 1).Execute(storage, "", out);
+    EXPECT_EQ("18446744073709551615", out);
+    Incr("KEY1", 2).Execute(storage, "", out);
+    EXPECT_EQ("1", out);
+    Decr("KEY1", 5).Execute(storage, "", out);
+    EXPECT_EQ("0", out);
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("0", value);
+
+    storage.Put("KEY1", "12a");
+    Decr("KEY1", 1).Execute(storage, "", out);
+    EXPECT_EQ(0, out.find("CLIENT_ERROR"));
+    storage.Put("KEY1", "18446744073709551616");
+    Incr("KEY1", 1).Execute(storage, "", out);
+    EXPECT_EQ(0, out.find("CLIENT_ERROR"));
+}
+
+// Read-modify-write commands run under storage lock: concurrent increments are never lost, remaining
+// ttl of the item is kept
+TEST(StorageTest, AtomicModify) {
+    MapBasedGlobalLockImpl map(1024 * 1024);
+    ThreadSafeSimpleLRU lru(1024 * 1024);
+    StripedLockImpl striped(1024 * 1024);
+    RCUHashImpl rcu(1024 * 1024);
+    for (Afina::Storage *storage : std::vector<Afina::Storage *>{&map, &lru, &striped, &rcu}) {
+        storage->Put("counter", "0", 1000);
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([storage]() {
+                std::string out;
+                for (int i = 0; i < 1000; i++) {
+                    Incr("counter", 1).Execute(*storage, "", out);
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+
+        std::string value;
+        EXPECT_TRUE(storage->Get("counter", value));
+        EXPECT_EQ("4000", value);
+
+        uint32_t left = 0;
+        EXPECT_TRUE(storage->Modify("counter", [&left](std::string &value, uint32_t &ttl) {
+            left = ttl;
+            return Afina::Storage::Action::kKeep;
+        }));
+        EXPECT_GT(left, 990);
+        EXPECT_LE(left, 1000);
+
+        EXPECT_TRUE(storage->Modify("counter", [](std::string &value, uint32_t &ttl) {
+            return Afina::Storage::Action::kRemove;
+        }));
+        EXPECT_FALSE(storage->Get("counter", value));
+        EXPECT_FALSE(storage->Modify("counter", [](std::string &value, uint32_t &ttl) {
+            return Afina::Storage::Action::kStore;
+        }));
+    }
+    Epoch::Synchronize();
+}
+
+TEST(StorageTest, ModifyKeepsExpiry) {
+    MapBasedGlobalLockImpl map(1024 * 1024);
+    ThreadSafeSimpleLRU lru(1024 * 1024);
+    StripedLockImpl striped(1024 * 1024);
+    RCUHashImpl rcu(1024 * 1024);
+    std::vector<Afina::Storage *> storages = {&map, &lru, &striped, &rcu};
+    for (auto storage : storages) {
+        EXPECT_TRUE(storage->Put("KEY1", "val1", 1));
+    }
+
+    // Item rewritten right when the clock ticks must not become permanent
+    auto stop = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+    size_t alive = storages.size();
+    while (alive > 0 && std::chrono::steady_clock::now() < stop) {
+        alive = 0;
+        for (auto storage : storages) {
+            alive += storage->Modify("KEY1", [](std::string &value, uint32_t &ttl) {
+                EXPECT_GT(ttl, 0);
+                return Afina::Storage::Action::kStore;
+            });
+        }
+    }
+    EXPECT_EQ(0, alive);
+    Epoch::Synchronize();
+}
+
+TEST(StorageTest, CasCommand) {
+    SimpleLRU storage(1024 * 1024);
+    std::string out, value;
+    storage.Put("KEY1", "val1");
+
+    Response response;
+    Get({"KEY1"}, true).Execute(storage, "", response);
+    uint64_t unique = Cas::Unique("val1", 4);
+    EXPECT_EQ("VALUE KEY1 0 4 " + std::to_string(unique) + "\r\nval1\r\nEND\r\n", response.ToString());
+
+    Cas("KEY2", 0, 0, unique).Execute(storage, "val2", out);
+    EXPECT_EQ("NOT_FOUND", out);
+    Cas("KEY1", 0, 0, unique + 1).Execute(storage, "val2", out);
+    EXPECT_EQ("EXISTS", out);
+    Cas("KEY1", 0, 0, unique).Execute(storage, "val2", out);
+    EXPECT_EQ("STORED", out);
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val2", value);
+
+    // Unique is from the previous value now
+    Cas("KEY1", 0, 0, unique).Execute(storage, "val3", out);
+    EXPECT_EQ("EXISTS", out);
+}
+
+TEST(StorageTest, NoReply) {
+    SimpleLRU storage(1024 * 1024);
+    Afina::Execute::Set set("KEY1", 0, 0);
+    set.noreply(true);
+
+    // Servers run commands through the base class
+    Response response;
+    static_cast<Command &>(set).Execute(storage, "val1", response);
+    EXPECT_TRUE(response.Empty());
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val1", value);
+}
+
+TEST(StorageTest, RCUPutGetDelete) {
+    RCUHashImpl storage;
+
+    EXPECT_TRUE(storage.Put("KEY1", "val1"));
+    EXPECT_TRUE(storage.Put("KEY2", "val2"));
+    EXPECT_FALSE(storage.PutIfAbsent("KEY1", "val3"));
+    EXPECT_TRUE(storage.Set("KEY2", "val4"));
+    EXPECT_FALSE(storage.Set("KEY3", "val5"));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val1", value);
+    EXPECT_TRUE(storage.Get("KEY2", value));
+    EXPECT_EQ("val4", value);
+
+    EXPECT_TRUE(storage.Delete("KEY1"));
+    EXPECT_FALSE(storage.Delete("KEY1"));
+    EXPECT_FALSE(storage.Get("KEY1", value));
+
+    // Replaced and deleted entries are reclaimed once nobody could read them
+    Epoch::Synchronize();
+    EXPECT_EQ(0, Epoch::Pending());
+}
+
+TEST(StorageTest, RCUSecondChance) {
+    // Single stripe to make eviction order predictable, only 4 entries fits
+    RCUHashImpl storage(4 * RCUHashImpl::EntrySize(2, 8), 1);
+    for (int i = 0; i < 4; i++) {
+        EXPECT_TRUE(storage.Put("k" + std::to_string(i), "01234567"));
+    }
+
+    // k0 is the oldest one, but was referenced, so k1 is evicted instead
+    std::string res;
+    EXPECT_TRUE(storage.Get("k0", res));
+    EXPECT_TRUE(storage.Put("k4", "01234567"));
+    EXPECT_TRUE(storage.Get("k0", res));
+    EXPECT_FALSE(storage.Get("k1", res));
+    EXPECT_TRUE(storage.Get("k2", res));
+}
+
+TEST(StorageTest, RCUConcurrentReaders) {
+    RCUHashImpl storage(1024 * 1024, 4);
+    for (int i = 0; i < 100; i++) {
+        storage.Put("Key" + std::to_string(i), "Val" + std::to_string(i) + "_0");
+    }
+
+    // Readers must always see some complete value written for the key, while writers keep
+    // replacing them
+    std::atomic<bool> running(true);
+    std::atomic<long> mismatches(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; t++) {
+        readers.emplace_back([&]() {
+            std::string res;
+            while (running.load()) {
+                for (int i = 0; i < 100; i++) {
+                    std::string prefix = "Val" + std::to_string(i) + "_";
+                    if (!storage.Get("Key" + std::to_string(i), res) || res.compare(0, prefix.size(), prefix) != 0) {
+                        mismatches++;
+                    }
+                }
+            }
+        });
+    }
+
+    for (int round = 1; round < 200; round++) {
+        for (int i = 0; i < 100; i++) {
+            storage.Put("Key" + std::to_string(i), "Val" + std::to_string(i) + "_" + std::to_string(round));
+        }
+    }
+    running.store(false);
+    for (auto &reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_EQ(0, mismatches.load());
+    std::string res;
+    EXPECT_TRUE(storage.Get("Key42", res));
+    EXPECT_EQ("Val42_199", res);
+}